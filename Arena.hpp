@@ -0,0 +1,202 @@
+/*
+ * SerializerCpp
+ * Copyright (c) 2015-2016 Christopher D. Granz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+///////////////////////////////////////////////////////////////////////////////
+/// Bump allocator which hands out memory from a short list of large blocks.
+/// Nothing is freed individually; everything is released at once by Reset()
+/// or the destructor, so only trivially destructible objects belong in here.
+///////////////////////////////////////////////////////////////////////////////
+class Arena
+{
+private:
+	///////////////////////////////////////////////////////////////////////////
+	struct Block
+	{
+		Block* next;  // previously filled block
+		size_t size;  // usable bytes following this header
+		size_t used;  // bytes handed out so far
+	};
+
+	static const size_t MIN_BLOCK_SIZE = 4096;
+	static const size_t MAX_BLOCK_SIZE = (64 << 20);
+
+	Block* m_head;          // block we are currently allocating from
+	size_t m_nextBlockSize; // size of the next block (grows geometrically)
+
+	///////////////////////////////////////////////////////////////////////////
+	static inline unsigned char* BlockData(Block* b)
+	{
+		return reinterpret_cast<unsigned char*>(b) + HeaderSize();
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	static inline size_t HeaderSize()
+	{
+		return ((sizeof(Block) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1));
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	inline void* AllocateSlow(size_t size, size_t align)
+	{
+		auto blockSize = m_nextBlockSize;
+
+		if (blockSize < size + align)
+			blockSize = size + align;
+
+		auto b = static_cast<Block*>(malloc(HeaderSize() + blockSize));
+
+		if (b == nullptr)
+			throw std::bad_alloc();
+
+		b->next = m_head;
+		b->size = blockSize;
+		b->used = 0;
+		m_head = b;
+
+		if (m_nextBlockSize < MAX_BLOCK_SIZE)
+			m_nextBlockSize *= 2;
+
+		return Allocate(size, align);
+	}
+
+public:
+	///////////////////////////////////////////////////////////////////////////
+	inline explicit Arena(size_t initialSize = MIN_BLOCK_SIZE)
+		:
+		m_head(nullptr),
+		m_nextBlockSize(initialSize < MIN_BLOCK_SIZE ? MIN_BLOCK_SIZE : initialSize)
+	{ }
+
+	///////////////////////////////////////////////////////////////////////////
+	Arena(const Arena& rhs) = delete;
+	Arena& operator=(const Arena& rhs) = delete;
+
+	///////////////////////////////////////////////////////////////////////////
+	inline ~Arena()
+	{
+		while (m_head != nullptr)
+		{
+			auto next = m_head->next;
+			free(m_head);
+			m_head = next;
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// Release everything. The most recent (and largest) block is kept around
+	/// so parsing a document of similar size again doesn't touch malloc.
+	///////////////////////////////////////////////////////////////////////////
+	inline void Reset(size_t sizeHint = 0)
+	{
+		if (m_head == nullptr)
+		{
+			if (sizeHint > m_nextBlockSize)
+				m_nextBlockSize = (sizeHint < MAX_BLOCK_SIZE ? sizeHint : MAX_BLOCK_SIZE);
+
+			return;
+		}
+
+		auto b = m_head->next;
+
+		while (b != nullptr)
+		{
+			auto next = b->next;
+			free(b);
+			b = next;
+		}
+
+		m_head->next = nullptr;
+		m_head->used = 0;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// Take over everything other allocated, which lives as long as this
+	/// arena from now on. other is left empty. The blocks go behind the one
+	/// we are allocating from, so their free space isn't used.
+	///////////////////////////////////////////////////////////////////////////
+	inline void Adopt(Arena& other)
+	{
+		assert(&other != this);
+
+		if (other.m_head == nullptr)
+			return;
+
+		if (m_head == nullptr)
+			m_head = other.m_head;
+		else
+		{
+			auto tail = other.m_head;
+
+			while (tail->next != nullptr)
+				tail = tail->next;
+
+			tail->next = m_head->next;
+			m_head->next = other.m_head;
+		}
+
+		other.m_head = nullptr;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	inline void* Allocate(size_t size, size_t align = alignof(std::max_align_t))
+	{
+		assert(align != 0 && (align & (align - 1)) == 0 && "Alignment must be a power of two");
+
+		if (m_head != nullptr)
+		{
+			auto offset = ((m_head->used + align - 1) & ~(align - 1));
+
+			if (offset + size <= m_head->size)
+			{
+				m_head->used = offset + size;
+				return BlockData(m_head) + offset;
+			}
+		}
+
+		return AllocateSlow(size, align);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	template <typename T>
+	inline T* AllocateArray(size_t count)
+	{
+		return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	inline const char* CopyString(const char* str, size_t len)
+	{
+		auto p = static_cast<char*>(Allocate(len + 1, 1));
+		memcpy(p, str, len);
+		p[len] = '\0';
+		return p;
+	}
+};
@@ -22,6 +22,7 @@
 
 #include "Serializer.hpp"
 #include "SerializerJSON.hpp"
+#include "SerializerBinary.hpp"
 
 #include <cstdio>
 #include <vector>
@@ -31,6 +32,9 @@ static const char* g_JSON =
 
 struct Vec3 { float x, y, z; };
 
+struct Particle { std::string name; float mass; std::vector<int32_t> ids; };
+SERIALIZER_FIELDS(Particle, name, mass, ids);
+
 int main()
 {
 	SerializerJSON serializer;
@@ -63,6 +67,46 @@ int main()
 	root->Print();
 	printf("\n\n");
 
+	// the same types through the binary format
+	SerializerBinary binary;
+
+	SERIALIZER_REGISTER_TYPE(binary, Vec3, 0);
+	SERIALIZER_REGISTER_TYPE_MEMBER(binary, Vec3, x, 0);
+	SERIALIZER_REGISTER_TYPE_MEMBER(binary, Vec3, y, 0);
+	SERIALIZER_REGISTER_TYPE_MEMBER(binary, Vec3, z, 0);
+	SERIALIZER_REGISTER_TYPE(binary, std::vector<Vec3>, 0);
+
+	auto bytes = binary.BinaryWriteString(&v1);
+	std::vector<Vec3> v3;
+	binary.BinaryLoad(&v3, bytes);
+
+	printf("%zu bytes of binary\n", bytes.size());
+	serializer.JSONWrite(stdout, &v3);
+	printf("\n");
+
+	// types with SERIALIZER_FIELDS() don't need registering to be written
+	Particle p{"proton", 1.007f, {1, 2, 3}};
+	serializer.JSONWrite(stdout, &p, "particle", SerializerJSON::TEXT_EXPORT_SINGLE_LINE);
+	printf("\n");
+
+	Particle p2;
+	binary.BinaryLoad(&p2, binary.BinaryWriteString(&p));
+	serializer.JSONWrite(stdout, &p2, "", SerializerJSON::TEXT_EXPORT_MINIMAL);
+	printf("\n");
+
+	// a document cut off in an array keeps only the elements it got to
+	SERIALIZER_REGISTER_FIELDS(serializer, Particle, 0);
+	serializer.SetDiagnosticSink(nullptr);
+
+	Particle p3;
+	auto status = serializer.JSONLoad(&p3, "{ \"ids\": [ 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18");
+	printf("truncated: %s, %zu ids\n", (status.Status() == SerializerJSON::LoadStatus::BadFormat ? "BadFormat" : "?"), p3.ids.size());
+
+	// one cut off after a separator parses, and loads like its Node tree
+	Particle p4;
+	status = serializer.JSONLoad(&p4, "{ \"ids\": [ 1, 2,");
+	printf("cut off: %s, %zu ids\n", (status.Status() == SerializerJSON::LoadStatus::Loaded ? "Loaded" : "?"), p4.ids.size());
+
 	return 0;
 }
 
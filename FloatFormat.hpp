@@ -0,0 +1,524 @@
+/*
+ * SerializerCpp
+ * Copyright (c) 2015-2016 Christopher D. Granz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <clocale>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+
+// Define SERIALIZER_NO_STRTOD_L if the C library lacks strtod_l() and friends
+#if !defined(SERIALIZER_NO_STRTOD_L) && defined(_WIN32)
+#define SERIALIZER_STRTOD_L 1
+#include <locale.h>
+typedef _locale_t SerializerLocale;
+#define SERIALIZER_NEW_C_LOCALE() _create_locale(LC_NUMERIC, "C")
+#define SERIALIZER_STRTOD_L_FN _strtod_l
+#define SERIALIZER_STRTOF_L_FN _strtof_l
+#elif !defined(SERIALIZER_NO_STRTOD_L) && (defined(__GLIBC__) || defined(__APPLE__) || defined(__FreeBSD__))
+#define SERIALIZER_STRTOD_L 1
+#include <locale.h>
+#ifdef __APPLE__
+#include <xlocale.h>
+#endif
+typedef locale_t SerializerLocale;
+#define SERIALIZER_NEW_C_LOCALE() newlocale(LC_NUMERIC_MASK, "C", (locale_t)0)
+#define SERIALIZER_STRTOD_L_FN strtod_l
+#define SERIALIZER_STRTOF_L_FN strtof_l
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+/// Formats floats and doubles with the fewest digits that still read back as
+/// the same value, using Florian Loitsch's Grisu2 algorithm: "Printing
+/// Floating-Point Numbers Quickly and Accurately with Integers" (PLDI 2010).
+/// Everything is done with 64 bit integers and a small table of powers of
+/// ten. The result always round trips; in rare cases a shorter form exists.
+/// Numbers are read back with ParseDouble() and ParseFloat(), whatever the
+/// C locale is.
+///////////////////////////////////////////////////////////////////////////////
+class FloatFormat
+{
+public:
+	///////////////////////////////////////////////////////////////////////////
+	static const size_t MAX_LENGTH = 32;
+
+private:
+	///////////////////////////////////////////////////////////////////////////
+	// Plain numbers are written up to 10^MAX_FIXED_EXP and down to
+	// 10^MIN_FIXED_EXP, exponent notation is used outside of that
+	static const int MIN_FIXED_EXP = -4;
+	static const int MAX_FIXED_EXP = 15;
+
+	// Exponent range the scaled values are brought into, so the integral
+	// part of a digit generation step fits in 32 bits
+	static const int ALPHA = -60;
+	static const int GAMMA = -32;
+
+	///////////////////////////////////////////////////////////////////////////
+	// f * 2^e with a 64 bit significand ("do it yourself floating point")
+	struct DiyFp
+	{
+		uint64_t f;
+		int e;
+
+		inline DiyFp(uint64_t f_, int e_) : f(f_), e(e_) { }
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	struct CachedPower
+	{
+		uint64_t f;
+		int e;
+		int k;  // decimal exponent
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	static inline DiyFp Mul(const DiyFp& x, const DiyFp& y)
+	{
+		// upper 64 bits of the 128 bit product, rounded
+		const uint64_t mask32 = 0xFFFFFFFF;
+
+		auto a = (x.f >> 32);
+		auto b = (x.f & mask32);
+		auto c = (y.f >> 32);
+		auto d = (y.f & mask32);
+
+		auto ac = a * c;
+		auto bc = b * c;
+		auto ad = a * d;
+		auto bd = b * d;
+
+		auto mid = (bd >> 32) + (ad & mask32) + (bc & mask32) + (uint64_t(1) << 31);
+
+		return DiyFp(ac + (ad >> 32) + (bc >> 32) + (mid >> 32), x.e + y.e + 64);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	static inline DiyFp Normalize(DiyFp x)
+	{
+		assert(x.f != 0);
+
+#if defined(__GNUC__)
+		auto shift = __builtin_clzll(x.f);
+		x.f <<= shift;
+		x.e -= shift;
+#else
+		while ((x.f >> 63) == 0)
+		{
+			x.f <<= 1;
+			--x.e;
+		}
+#endif
+
+		return x;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Returns 10^k (normalized) such that the exponent of a number with
+	// binary exponent e multiplied by it lies in [ALPHA, GAMMA]
+	///////////////////////////////////////////////////////////////////////////
+	static inline const CachedPower& GetCachedPower(int e)
+	{
+		// 10^-300 to 10^324 in steps of 10^8, covering all doubles
+		static const int firstDecExp = -300;
+		static const int decExpStep = 8;
+
+		static const CachedPower powers[] = {
+			{ 0xAB70FE17C79AC6CAULL, -1060, -300 },
+			{ 0xFF77B1FCBEBCDC4FULL, -1034, -292 },
+			{ 0xBE5691EF416BD60CULL, -1007, -284 },
+			{ 0x8DD01FAD907FFC3CULL,  -980, -276 },
+			{ 0xD3515C2831559A83ULL,  -954, -268 },
+			{ 0x9D71AC8FADA6C9B5ULL,  -927, -260 },
+			{ 0xEA9C227723EE8BCBULL,  -901, -252 },
+			{ 0xAECC49914078536DULL,  -874, -244 },
+			{ 0x823C12795DB6CE57ULL,  -847, -236 },
+			{ 0xC21094364DFB5637ULL,  -821, -228 },
+			{ 0x9096EA6F3848984FULL,  -794, -220 },
+			{ 0xD77485CB25823AC7ULL,  -768, -212 },
+			{ 0xA086CFCD97BF97F4ULL,  -741, -204 },
+			{ 0xEF340A98172AACE5ULL,  -715, -196 },
+			{ 0xB23867FB2A35B28EULL,  -688, -188 },
+			{ 0x84C8D4DFD2C63F3BULL,  -661, -180 },
+			{ 0xC5DD44271AD3CDBAULL,  -635, -172 },
+			{ 0x936B9FCEBB25C996ULL,  -608, -164 },
+			{ 0xDBAC6C247D62A584ULL,  -582, -156 },
+			{ 0xA3AB66580D5FDAF6ULL,  -555, -148 },
+			{ 0xF3E2F893DEC3F126ULL,  -529, -140 },
+			{ 0xB5B5ADA8AAFF80B8ULL,  -502, -132 },
+			{ 0x87625F056C7C4A8BULL,  -475, -124 },
+			{ 0xC9BCFF6034C13053ULL,  -449, -116 },
+			{ 0x964E858C91BA2655ULL,  -422, -108 },
+			{ 0xDFF9772470297EBDULL,  -396, -100 },
+			{ 0xA6DFBD9FB8E5B88FULL,  -369,  -92 },
+			{ 0xF8A95FCF88747D94ULL,  -343,  -84 },
+			{ 0xB94470938FA89BCFULL,  -316,  -76 },
+			{ 0x8A08F0F8BF0F156BULL,  -289,  -68 },
+			{ 0xCDB02555653131B6ULL,  -263,  -60 },
+			{ 0x993FE2C6D07B7FACULL,  -236,  -52 },
+			{ 0xE45C10C42A2B3B06ULL,  -210,  -44 },
+			{ 0xAA242499697392D3ULL,  -183,  -36 },
+			{ 0xFD87B5F28300CA0EULL,  -157,  -28 },
+			{ 0xBCE5086492111AEBULL,  -130,  -20 },
+			{ 0x8CBCCC096F5088CCULL,  -103,  -12 },
+			{ 0xD1B71758E219652CULL,   -77,   -4 },
+			{ 0x9C40000000000000ULL,   -50,    4 },
+			{ 0xE8D4A51000000000ULL,   -24,   12 },
+			{ 0xAD78EBC5AC620000ULL,     3,   20 },
+			{ 0x813F3978F8940984ULL,    30,   28 },
+			{ 0xC097CE7BC90715B3ULL,    56,   36 },
+			{ 0x8F7E32CE7BEA5C70ULL,    83,   44 },
+			{ 0xD5D238A4ABE98068ULL,   109,   52 },
+			{ 0x9F4F2726179A2245ULL,   136,   60 },
+			{ 0xED63A231D4C4FB27ULL,   162,   68 },
+			{ 0xB0DE65388CC8ADA8ULL,   189,   76 },
+			{ 0x83C7088E1AAB65DBULL,   216,   84 },
+			{ 0xC45D1DF942711D9AULL,   242,   92 },
+			{ 0x924D692CA61BE758ULL,   269,  100 },
+			{ 0xDA01EE641A708DEAULL,   295,  108 },
+			{ 0xA26DA3999AEF774AULL,   322,  116 },
+			{ 0xF209787BB47D6B85ULL,   348,  124 },
+			{ 0xB454E4A179DD1877ULL,   375,  132 },
+			{ 0x865B86925B9BC5C2ULL,   402,  140 },
+			{ 0xC83553C5C8965D3DULL,   428,  148 },
+			{ 0x952AB45CFA97A0B3ULL,   455,  156 },
+			{ 0xDE469FBD99A05FE3ULL,   481,  164 },
+			{ 0xA59BC234DB398C25ULL,   508,  172 },
+			{ 0xF6C69A72A3989F5CULL,   534,  180 },
+			{ 0xB7DCBF5354E9BECEULL,   561,  188 },
+			{ 0x88FCF317F22241E2ULL,   588,  196 },
+			{ 0xCC20CE9BD35C78A5ULL,   614,  204 },
+			{ 0x98165AF37B2153DFULL,   641,  212 },
+			{ 0xE2A0B5DC971F303AULL,   667,  220 },
+			{ 0xA8D9D1535CE3B396ULL,   694,  228 },
+			{ 0xFB9B7CD9A4A7443CULL,   720,  236 },
+			{ 0xBB764C4CA7A44410ULL,   747,  244 },
+			{ 0x8BAB8EEFB6409C1AULL,   774,  252 },
+			{ 0xD01FEF10A657842CULL,   800,  260 },
+			{ 0x9B10A4E5E9913129ULL,   827,  268 },
+			{ 0xE7109BFBA19C0C9DULL,   853,  276 },
+			{ 0xAC2820D9623BF429ULL,   880,  284 },
+			{ 0x80444B5E7AA7CF85ULL,   907,  292 },
+			{ 0xBF21E44003ACDD2DULL,   933,  300 },
+			{ 0x8E679C2F5E44FF8FULL,   960,  308 },
+			{ 0xD433179D9C8CB841ULL,   986,  316 },
+			{ 0x9E19DB92B4E31BA9ULL,  1013,  324 },
+		};
+
+		// k = ceil((ALPHA - e - 1) * log10(2)), 78913 / 2^18 being log10(2)
+		auto f = (ALPHA - e - 1);
+		auto k = (f * 78913) / (1 << 18) + (f > 0 ? 1 : 0);
+		auto index = (k - firstDecExp + (decExpStep - 1)) / decExpStep;
+
+		assert(index >= 0 && size_t(index) < sizeof(powers) / sizeof(powers[0]));
+		assert(powers[index].e + e + 64 >= ALPHA && powers[index].e + e + 64 <= GAMMA);
+
+		return powers[index];
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// The value of a positive float or double, and the midpoints to its
+	// neighbours (any number strictly between those reads back as value).
+	// The boundaries share their exponent.
+	///////////////////////////////////////////////////////////////////////////
+	template <typename FloatT, typename BitsT>
+	static inline void ComputeBoundaries(FloatT value, DiyFp& w, DiyFp& lower, DiyFp& upper)
+	{
+		static_assert(sizeof(FloatT) == sizeof(BitsT), "Bits type must match the float type");
+
+		const int precision = std::numeric_limits<FloatT>::digits; // with the hidden bit
+		const int bias = std::numeric_limits<FloatT>::max_exponent - 1 + (precision - 1);
+		const auto hiddenBit = (BitsT(1) << (precision - 1));
+
+		BitsT bits;
+		memcpy(&bits, &value, sizeof(bits));
+
+		auto exponent = (bits >> (precision - 1));
+		auto fraction = (bits & (hiddenBit - 1));
+
+		auto v = (exponent == 0 // subnormal
+			? DiyFp(fraction, 1 - bias)
+			: DiyFp(fraction + hiddenBit, int(exponent) - bias));
+
+		// at a power of two the gap below is half the gap above
+		auto lowerIsCloser = (fraction == 0 && exponent > 1);
+
+		upper = Normalize(DiyFp(2 * v.f + 1, v.e - 1));
+		lower = (lowerIsCloser ? DiyFp(4 * v.f - 1, v.e - 2) : DiyFp(2 * v.f - 1, v.e - 1));
+		lower.f <<= (lower.e - upper.e);
+		lower.e = upper.e;
+		w = Normalize(v);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Move the last digit towards w while staying inside the boundaries
+	///////////////////////////////////////////////////////////////////////////
+	static inline void Round(char* buf, int len, uint64_t dist, uint64_t delta, uint64_t rest, uint64_t tenK)
+	{
+		while (rest < dist
+		  && delta - rest >= tenK
+		  && (rest + tenK < dist || dist - rest > rest + tenK - dist))
+		{
+			--buf[len - 1];
+			rest += tenK;
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Generate the shortest digits of a number in [lower, upper], as close
+	// to w as possible. The value is buf * 10^decExp.
+	///////////////////////////////////////////////////////////////////////////
+	static inline void GenerateDigits(char* buf, int& len, int& decExp, const DiyFp& lower, const DiyFp& w, const DiyFp& upper)
+	{
+		static const uint32_t powersOf10[] = {
+			1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+		};
+
+		auto delta = (upper.f - lower.f);
+		auto dist = (upper.f - w.f);
+
+		// split upper into integral and fractional parts
+		auto shift = -upper.e;
+		auto one = (uint64_t(1) << shift);
+		auto integral = uint32_t(upper.f >> shift);
+		auto fractional = (upper.f & (one - 1));
+
+		auto n = 10;
+
+		while (n > 1 && integral < powersOf10[n - 1])
+			--n;
+
+		for (; n > 0; --n)
+		{
+			auto pow10 = powersOf10[n - 1];
+			buf[len++] = char('0' + integral / pow10);
+			integral %= pow10;
+
+			auto rest = ((uint64_t(integral) << shift) + fractional);
+
+			if (rest <= delta)
+			{
+				decExp += (n - 1);
+				Round(buf, len, dist, delta, rest, uint64_t(pow10) << shift);
+				return;
+			}
+		}
+
+		for (;;)
+		{
+			fractional *= 10;
+			delta *= 10;
+			dist *= 10;
+
+			buf[len++] = char('0' + (fractional >> shift));
+			fractional &= (one - 1);
+			--decExp;
+
+			if (fractional <= delta)
+				break;
+		}
+
+		Round(buf, len, dist, delta, fractional, one);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	template <typename FloatT, typename BitsT>
+	static inline void Grisu2(FloatT value, char* buf, int& len, int& decExp)
+	{
+		DiyFp w(0, 0), lower(0, 0), upper(0, 0);
+		ComputeBoundaries<FloatT, BitsT>(value, w, lower, upper);
+
+		auto& cached = GetCachedPower(upper.e);
+		DiyFp c(cached.f, cached.e);
+
+		w = Mul(w, c);
+		lower = Mul(lower, c);
+		upper = Mul(upper, c);
+
+		// stay clear of the boundaries, Mul() may be off by one each way
+		++lower.f;
+		--upper.f;
+
+		len = 0;
+		decExp = -cached.k;
+		GenerateDigits(buf, len, decExp, lower, w, upper);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Lay out len digits in buf (with room to spare) as digits * 10^decExp,
+	// returns the resulting length
+	///////////////////////////////////////////////////////////////////////////
+	static inline size_t Layout(char* buf, int len, int decExp)
+	{
+		auto point = len + decExp; // digits before the decimal point
+
+		if (len <= point && point <= MAX_FIXED_EXP) // 1234500.0
+		{
+			memset(buf + len, '0', size_t(point - len));
+			buf[point] = '.';
+			buf[point + 1] = '0';
+			return size_t(point + 2);
+		}
+
+		if (0 < point && point <= MAX_FIXED_EXP) // 1234.5
+		{
+			memmove(buf + point + 1, buf + point, size_t(len - point));
+			buf[point] = '.';
+			return size_t(len + 1);
+		}
+
+		if (MIN_FIXED_EXP < point && point <= 0) // 0.0012345
+		{
+			memmove(buf + 2 - point, buf, size_t(len));
+			buf[0] = '0';
+			buf[1] = '.';
+			memset(buf + 2, '0', size_t(-point));
+			return size_t(2 - point + len);
+		}
+
+		// 1.2345e-7
+		auto p = buf + 1;
+
+		if (len > 1)
+		{
+			memmove(buf + 2, buf + 1, size_t(len - 1));
+			buf[1] = '.';
+			p = buf + len + 1;
+		}
+
+		*p++ = 'e';
+		auto exponent = point - 1;
+
+		if (exponent < 0)
+		{
+			*p++ = '-';
+			exponent = -exponent;
+		}
+
+		if (exponent >= 100)
+			*p++ = char('0' + exponent / 100);
+
+		if (exponent >= 10)
+			*p++ = char('0' + exponent / 10 % 10);
+
+		*p++ = char('0' + exponent % 10);
+		return size_t(p - buf);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	template <typename FloatT, typename BitsT>
+	static inline size_t FormatFloat(FloatT value, char* buf)
+	{
+		assert(std::isfinite(value) && "NaN and infinity can't be formatted");
+
+		auto p = buf;
+
+		if (std::signbit(value))
+		{
+			*p++ = '-';
+			value = -value;
+		}
+
+		if (value == 0)
+		{
+			memcpy(p, "0.0", 3);
+			return size_t(p - buf) + 3;
+		}
+
+		int len, decExp;
+		Grisu2<FloatT, BitsT>(value, p, len, decExp);
+		return size_t(p - buf) + Layout(p, len, decExp);
+	}
+
+public:
+	///////////////////////////////////////////////////////////////////////////
+	// Writes value (which must be finite) to buf, which needs MAX_LENGTH
+	// characters of room. Not NUL terminated. Returns the length.
+	///////////////////////////////////////////////////////////////////////////
+	static inline size_t Format(double value, char* buf) { return FormatFloat<double, uint64_t>(value, buf); }
+	static inline size_t Format(float value, char* buf)  { return FormatFloat<float, uint32_t>(value, buf); }
+
+	///////////////////////////////////////////////////////////////////////////
+	// Reads a number with a '.' for the decimal point, as strtod() does in
+	// the "C" locale, even if the program set another LC_NUMERIC (where
+	// strtod() would stop at the '.'). str has to be NUL terminated.
+	///////////////////////////////////////////////////////////////////////////
+	static inline double ParseDouble(const char* str)
+	{
+#ifdef SERIALIZER_STRTOD_L
+		if (CLocale() != (SerializerLocale)0)
+			return SERIALIZER_STRTOD_L_FN(str, nullptr, CLocale());
+#endif
+
+		std::string localized;
+		return strtod(Localize(str, localized), nullptr);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// As ParseDouble(), but rounded straight to the nearest float
+	///////////////////////////////////////////////////////////////////////////
+	static inline float ParseFloat(const char* str)
+	{
+#ifdef SERIALIZER_STRTOD_L
+		if (CLocale() != (SerializerLocale)0)
+			return SERIALIZER_STRTOF_L_FN(str, nullptr, CLocale());
+#endif
+
+		std::string localized;
+		return strtof(Localize(str, localized), nullptr);
+	}
+
+private:
+#ifdef SERIALIZER_STRTOD_L
+	///////////////////////////////////////////////////////////////////////////
+	static inline SerializerLocale CLocale()
+	{
+		static const SerializerLocale cLocale = SERIALIZER_NEW_C_LOCALE();
+		return cLocale;
+	}
+#endif
+
+	///////////////////////////////////////////////////////////////////////////
+	// str with the decimal point spelled the way the current locale does
+	// (in buf if that differs)
+	///////////////////////////////////////////////////////////////////////////
+	static inline const char* Localize(const char* str, std::string& buf)
+	{
+		auto point = localeconv()->decimal_point;
+		auto dot = strchr(str, '.');
+
+		if (dot == nullptr || point == nullptr || strcmp(point, ".") == 0)
+			return str;
+
+		buf.assign(str, dot);
+		buf += point;
+		buf += (dot + 1);
+		return buf.c_str();
+	}
+};
@@ -0,0 +1,516 @@
+/*
+ * SerializerCpp
+ * Copyright (c) 2015-2016 Christopher D. Granz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Define SERIALIZER_NO_SIMD to build the scalar code paths only
+#if !defined(SERIALIZER_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define SERIALIZER_SSE2 1
+#include <emmintrin.h>
+
+// AVX2 is picked at runtime, which needs per-function target attributes
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SERIALIZER_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+/// Stage one of JSON parsing: finds the structural characters of a document
+/// 64 bytes at a time using bitmasks, in the spirit of simdjson.
+///
+/// A structural is a brace, bracket, colon or comma outside of a String, the
+/// opening quote of a String, or the first character of anything else (a
+/// Number, Boolean, Null or garbage). Whitespace and the insides of Strings
+/// never show up, so the parser's state machine only visits tokens.
+///
+/// Documents may be fed in consecutive pieces; quote, escape and scalar
+/// state carries over from one piece to the next.
+///////////////////////////////////////////////////////////////////////////////
+class JSONScanner
+{
+public:
+	///////////////////////////////////////////////////////////////////////////
+	static const size_t BLOCK_SIZE = 64;
+
+	///////////////////////////////////////////////////////////////////////////
+	enum class InstructionSet
+	{
+		Scalar = 0,
+		SSE2,
+		AVX2,
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	// Character classes of one block (bit i is byte i)
+	///////////////////////////////////////////////////////////////////////////
+	struct RawBlock
+	{
+		uint64_t quote;      // '"'
+		uint64_t backslash;  // '\\'
+		uint64_t op;         // { } [ ] : ,
+		uint64_t whitespace; // space, tab, carriage return, newline
+	};
+
+	typedef void (*ClassifyFunc)(const unsigned char* p, size_t blockCount, RawBlock* out);
+
+private:
+	///////////////////////////////////////////////////////////////////////////
+	uint64_t m_prevEscaped;    // 1 if the first byte of the next block is escaped
+	uint64_t m_prevInString;   // all ones if the next block starts inside a String
+	uint64_t m_prevScalar;     // 1 if the last byte of the previous block was a non-quote scalar
+	ClassifyFunc m_classify;   // character classification kernel
+	std::vector<RawBlock> m_blocks; // scratch space for classified blocks
+
+	///////////////////////////////////////////////////////////////////////////
+	// Scalar fallback: one table lookup per byte
+	///////////////////////////////////////////////////////////////////////////
+	static inline const unsigned char* ClassTable()
+	{
+		static const struct Table
+		{
+			unsigned char c[256];
+
+			Table()
+			{
+				memset(c, 0, sizeof(c));
+				c[(unsigned char)'\"'] = 1;
+				c[(unsigned char)'\\'] = 2;
+				c[(unsigned char)'{'] = c[(unsigned char)'}'] = 4;
+				c[(unsigned char)'['] = c[(unsigned char)']'] = 4;
+				c[(unsigned char)':'] = c[(unsigned char)','] = 4;
+				c[(unsigned char)' '] = c[(unsigned char)'\t'] = 8;
+				c[(unsigned char)'\r'] = c[(unsigned char)'\n'] = 8;
+			}
+		} table;
+
+		return table.c;
+	}
+
+	static inline void ClassifyScalar(const unsigned char* p, size_t blockCount, RawBlock* out)
+	{
+		auto table = ClassTable();
+
+		for (size_t b = 0; b < blockCount; ++b, p += BLOCK_SIZE)
+		{
+			uint64_t quote = 0, backslash = 0, op = 0, whitespace = 0;
+
+			for (unsigned int i = 0; i < BLOCK_SIZE; ++i)
+			{
+				auto c = table[p[i]];
+				quote |= uint64_t(c & 1) << i;
+				backslash |= uint64_t((c >> 1) & 1) << i;
+				op |= uint64_t((c >> 2) & 1) << i;
+				whitespace |= uint64_t((c >> 3) & 1) << i;
+			}
+
+			out[b].quote = quote;
+			out[b].backslash = backslash;
+			out[b].op = op;
+			out[b].whitespace = whitespace;
+		}
+	}
+
+#ifdef SERIALIZER_SSE2
+	///////////////////////////////////////////////////////////////////////////
+	// Brackets and braces only differ from each other in bit 5, so OR-ing in
+	// 0x20 folds '[' onto '{' and ']' onto '}' (nothing else maps there).
+	///////////////////////////////////////////////////////////////////////////
+	static inline void ClassifySSE2(const unsigned char* p, size_t blockCount, RawBlock* out)
+	{
+		const __m128i quoteChar = _mm_set1_epi8('\"');
+		const __m128i backslashChar = _mm_set1_epi8('\\');
+		const __m128i fold = _mm_set1_epi8(0x20);
+		const __m128i openChar = _mm_set1_epi8('{');
+		const __m128i closeChar = _mm_set1_epi8('}');
+		const __m128i colonChar = _mm_set1_epi8(':');
+		const __m128i commaChar = _mm_set1_epi8(',');
+		const __m128i spaceChar = _mm_set1_epi8(' ');
+		const __m128i tabChar = _mm_set1_epi8('\t');
+		const __m128i crChar = _mm_set1_epi8('\r');
+		const __m128i nlChar = _mm_set1_epi8('\n');
+
+		for (size_t b = 0; b < blockCount; ++b, p += BLOCK_SIZE)
+		{
+			uint64_t quote = 0, backslash = 0, op = 0, whitespace = 0;
+
+			for (unsigned int i = 0; i < BLOCK_SIZE; i += 16)
+			{
+				auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+				auto folded = _mm_or_si128(v, fold);
+
+				auto o = _mm_or_si128(
+					_mm_or_si128(_mm_cmpeq_epi8(folded, openChar), _mm_cmpeq_epi8(folded, closeChar)),
+					_mm_or_si128(_mm_cmpeq_epi8(v, colonChar), _mm_cmpeq_epi8(v, commaChar)));
+				auto w = _mm_or_si128(
+					_mm_or_si128(_mm_cmpeq_epi8(v, spaceChar), _mm_cmpeq_epi8(v, tabChar)),
+					_mm_or_si128(_mm_cmpeq_epi8(v, crChar), _mm_cmpeq_epi8(v, nlChar)));
+
+				quote |= uint64_t(uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, quoteChar)))) << i;
+				backslash |= uint64_t(uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, backslashChar)))) << i;
+				op |= uint64_t(uint32_t(_mm_movemask_epi8(o))) << i;
+				whitespace |= uint64_t(uint32_t(_mm_movemask_epi8(w))) << i;
+			}
+
+			out[b].quote = quote;
+			out[b].backslash = backslash;
+			out[b].op = op;
+			out[b].whitespace = whitespace;
+		}
+	}
+#endif
+
+#ifdef SERIALIZER_AVX2
+	///////////////////////////////////////////////////////////////////////////
+	__attribute__((target("avx2")))
+	static void ClassifyAVX2(const unsigned char* p, size_t blockCount, RawBlock* out)
+	{
+		const __m256i quoteChar = _mm256_set1_epi8('\"');
+		const __m256i backslashChar = _mm256_set1_epi8('\\');
+		const __m256i fold = _mm256_set1_epi8(0x20);
+		const __m256i openChar = _mm256_set1_epi8('{');
+		const __m256i closeChar = _mm256_set1_epi8('}');
+		const __m256i colonChar = _mm256_set1_epi8(':');
+		const __m256i commaChar = _mm256_set1_epi8(',');
+		const __m256i spaceChar = _mm256_set1_epi8(' ');
+		const __m256i tabChar = _mm256_set1_epi8('\t');
+		const __m256i crChar = _mm256_set1_epi8('\r');
+		const __m256i nlChar = _mm256_set1_epi8('\n');
+
+		for (size_t b = 0; b < blockCount; ++b, p += BLOCK_SIZE)
+		{
+			uint64_t quote = 0, backslash = 0, op = 0, whitespace = 0;
+
+			for (unsigned int i = 0; i < BLOCK_SIZE; i += 32)
+			{
+				auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+				auto folded = _mm256_or_si256(v, fold);
+
+				auto o = _mm256_or_si256(
+					_mm256_or_si256(_mm256_cmpeq_epi8(folded, openChar), _mm256_cmpeq_epi8(folded, closeChar)),
+					_mm256_or_si256(_mm256_cmpeq_epi8(v, colonChar), _mm256_cmpeq_epi8(v, commaChar)));
+				auto w = _mm256_or_si256(
+					_mm256_or_si256(_mm256_cmpeq_epi8(v, spaceChar), _mm256_cmpeq_epi8(v, tabChar)),
+					_mm256_or_si256(_mm256_cmpeq_epi8(v, crChar), _mm256_cmpeq_epi8(v, nlChar)));
+
+				quote |= uint64_t(uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, quoteChar)))) << i;
+				backslash |= uint64_t(uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, backslashChar)))) << i;
+				op |= uint64_t(uint32_t(_mm256_movemask_epi8(o))) << i;
+				whitespace |= uint64_t(uint32_t(_mm256_movemask_epi8(w))) << i;
+			}
+
+			out[b].quote = quote;
+			out[b].backslash = backslash;
+			out[b].op = op;
+			out[b].whitespace = whitespace;
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	__attribute__((target("avx2")))
+	static const char* FindStringSpecialAVX2(const char* p, const char* end)
+	{
+		const __m256i quoteChar = _mm256_set1_epi8('\"');
+		const __m256i backslashChar = _mm256_set1_epi8('\\');
+		const __m256i controlMax = _mm256_set1_epi8(0x1F);
+
+		while (end - p >= 32)
+		{
+			auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+			auto special = _mm256_or_si256(
+				_mm256_or_si256(_mm256_cmpeq_epi8(v, quoteChar), _mm256_cmpeq_epi8(v, backslashChar)),
+				_mm256_cmpeq_epi8(_mm256_min_epu8(v, controlMax), v)); // v <= 0x1F
+			auto mask = uint32_t(_mm256_movemask_epi8(special));
+
+			if (mask != 0)
+				return p + TrailingZeros(mask);
+
+			p += 32;
+		}
+
+		return FindStringSpecialSSE2(p, end);
+	}
+#endif
+
+#ifdef SERIALIZER_SSE2
+	///////////////////////////////////////////////////////////////////////////
+	static inline const char* FindStringSpecialSSE2(const char* p, const char* end)
+	{
+		const __m128i quoteChar = _mm_set1_epi8('\"');
+		const __m128i backslashChar = _mm_set1_epi8('\\');
+		const __m128i controlMax = _mm_set1_epi8(0x1F);
+
+		while (end - p >= 16)
+		{
+			auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+			auto special = _mm_or_si128(
+				_mm_or_si128(_mm_cmpeq_epi8(v, quoteChar), _mm_cmpeq_epi8(v, backslashChar)),
+				_mm_cmpeq_epi8(_mm_min_epu8(v, controlMax), v)); // v <= 0x1F
+			auto mask = uint32_t(_mm_movemask_epi8(special));
+
+			if (mask != 0)
+				return p + TrailingZeros(mask);
+
+			p += 16;
+		}
+
+		return FindStringSpecialScalar(p, end);
+	}
+#endif
+
+	///////////////////////////////////////////////////////////////////////////
+	static inline const char* FindStringSpecialScalar(const char* p, const char* end)
+	{
+		for (; p != end; ++p)
+		{
+			if (*p == '\"' || *p == '\\' || (unsigned char)*p < 0x20)
+				return p;
+		}
+
+		return end;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Marks the characters escaped by a backslash. Runs of backslashes escape
+	// every other character, so the parity of where a run starts decides
+	// whether the character after it is escaped.
+	///////////////////////////////////////////////////////////////////////////
+	inline uint64_t FindEscaped(uint64_t backslash)
+	{
+		const uint64_t evenBits = 0x5555555555555555ULL;
+
+		backslash &= ~m_prevEscaped;
+		uint64_t followsEscape = (backslash << 1) | m_prevEscaped;
+		uint64_t oddSequenceStarts = backslash & ~evenBits & ~followsEscape;
+		uint64_t sequencesStartingOnEvenBits = oddSequenceStarts + backslash;
+		m_prevEscaped = (sequencesStartingOnEvenBits < oddSequenceStarts ? 1 : 0); // carry out
+		uint64_t invertMask = sequencesStartingOnEvenBits << 1;
+
+		return ((evenBits ^ invertMask) & followsEscape);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Bit i of the result is the XOR of bits 0..i of x (so everything from an
+	// opening quote up to, but not including, its closing quote is set)
+	///////////////////////////////////////////////////////////////////////////
+	static inline uint64_t PrefixXor(uint64_t x)
+	{
+		x ^= x << 1;
+		x ^= x << 2;
+		x ^= x << 4;
+		x ^= x << 8;
+		x ^= x << 16;
+		x ^= x << 32;
+		return x;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	inline uint64_t FindStructurals(const RawBlock& block)
+	{
+		auto escaped = FindEscaped(block.backslash);
+		auto quote = block.quote & ~escaped;
+
+		auto inString = PrefixXor(quote) ^ m_prevInString;
+		m_prevInString = uint64_t(int64_t(inString) >> 63);
+		auto stringTail = inString ^ quote; // inside of strings plus closing quotes
+
+		auto scalar = ~(block.op | block.whitespace);
+		auto nonQuoteScalar = scalar & ~quote;
+		auto followsNonQuoteScalar = (nonQuoteScalar << 1) | m_prevScalar;
+		m_prevScalar = nonQuoteScalar >> 63;
+
+		return ((block.op | (scalar & ~followsNonQuoteScalar)) & ~stringTail);
+	}
+
+public:
+	///////////////////////////////////////////////////////////////////////////
+	static inline unsigned int TrailingZeros(uint64_t x)
+	{
+		assert(x != 0);
+#if defined(__GNUC__)
+		return (unsigned int)__builtin_ctzll(x);
+#elif defined(_MSC_VER) && defined(_M_X64)
+		unsigned long i;
+		_BitScanForward64(&i, x);
+		return (unsigned int)i;
+#else
+		unsigned int i = 0;
+
+		while (!(x & 1))
+		{
+			x >>= 1;
+			++i;
+		}
+
+		return i;
+#endif
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Best instruction set this CPU supports (checked once)
+	///////////////////////////////////////////////////////////////////////////
+	static inline InstructionSet DetectInstructionSet()
+	{
+#if defined(SERIALIZER_AVX2)
+		static const InstructionSet best = (__builtin_cpu_supports("avx2") ? InstructionSet::AVX2 : InstructionSet::SSE2);
+		return best;
+#elif defined(SERIALIZER_SSE2)
+		return InstructionSet::SSE2;
+#else
+		return InstructionSet::Scalar;
+#endif
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	static inline ClassifyFunc GetClassifier(InstructionSet set)
+	{
+		switch (set)
+		{
+#ifdef SERIALIZER_AVX2
+		case InstructionSet::AVX2: return &ClassifyAVX2;
+#endif
+#ifdef SERIALIZER_SSE2
+		case InstructionSet::SSE2: return &ClassifySSE2;
+#endif
+		default: return &ClassifyScalar;
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// First '"', '\\' or control character in [p, end), or end
+	///////////////////////////////////////////////////////////////////////////
+	static inline const char* FindStringSpecial(const char* p, const char* end)
+	{
+#if defined(SERIALIZER_AVX2)
+		if (DetectInstructionSet() == InstructionSet::AVX2)
+			return FindStringSpecialAVX2(p, end);
+#endif
+#if defined(SERIALIZER_SSE2)
+		return FindStringSpecialSSE2(p, end);
+#else
+		return FindStringSpecialScalar(p, end);
+#endif
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	inline explicit JSONScanner(InstructionSet set = DetectInstructionSet())
+		:
+		m_prevEscaped(0),
+		m_prevInString(0),
+		m_prevScalar(0),
+		m_classify(GetClassifier(set))
+	{ }
+
+	///////////////////////////////////////////////////////////////////////////
+	// Forget carried state before scanning a new document
+	///////////////////////////////////////////////////////////////////////////
+	inline void Reset()
+	{
+		m_prevEscaped = 0;
+		m_prevInString = 0;
+		m_prevScalar = 0;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Whether the bytes scanned so far end inside a String
+	///////////////////////////////////////////////////////////////////////////
+	inline bool InString() const { return (m_prevInString != 0); }
+
+	///////////////////////////////////////////////////////////////////////////
+	// Writes the document offsets of all structurals in [p, p + len) to out
+	// (which needs room for len entries) and returns how many were found.
+	// offset is the position of p in the document. len must be a multiple of
+	// BLOCK_SIZE unless this is the final piece of the document; bytes past
+	// len are never read.
+	///////////////////////////////////////////////////////////////////////////
+	inline size_t Scan(const char* p, size_t len, size_t offset, size_t* out)
+	{
+		auto blockCount = (len / BLOCK_SIZE);
+		auto tail = (len % BLOCK_SIZE);
+		auto totalBlocks = blockCount + (tail != 0 ? 1 : 0);
+
+		if (m_blocks.size() < totalBlocks)
+			m_blocks.resize(totalBlocks);
+
+		m_classify(reinterpret_cast<const unsigned char*>(p), blockCount, m_blocks.data());
+
+		// pad the last partial block with whitespace
+		if (tail != 0)
+		{
+			unsigned char padded[BLOCK_SIZE];
+			memset(padded, ' ', BLOCK_SIZE);
+			memcpy(padded, p + blockCount * BLOCK_SIZE, tail);
+			m_classify(padded, 1, &m_blocks[blockCount]);
+		}
+
+		size_t count = 0;
+
+		for (size_t b = 0; b < totalBlocks; ++b, offset += BLOCK_SIZE)
+		{
+			auto bits = FindStructurals(m_blocks[b]);
+
+			while (bits != 0)
+			{
+				out[count++] = offset + TrailingZeros(bits);
+				bits &= (bits - 1);
+			}
+		}
+
+		return count;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// 1-based line and column of a byte offset in a document
+	///////////////////////////////////////////////////////////////////////////
+	static inline void GetLineColumn(const char* str, size_t offset, size_t& line, size_t& column)
+	{
+		line = 1;
+		size_t lineStart = 0;
+		auto p = str;
+		auto end = str + offset;
+
+		while (p != end)
+		{
+			auto nl = static_cast<const char*>(memchr(p, '\n', size_t(end - p)));
+
+			if (nl == nullptr)
+				break;
+
+			++line;
+			p = nl + 1;
+			lineStart = size_t(p - str);
+		}
+
+		column = (offset - lineStart + 1);
+	}
+};
@@ -0,0 +1,173 @@
+/*
+ * SerializerCpp
+ * Copyright (c) 2015-2016 Christopher D. Granz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// Define SERIALIZER_NO_MMAP to always read files into memory instead
+#if !defined(SERIALIZER_NO_MMAP) && (defined(__unix__) || defined(__APPLE__))
+#define SERIALIZER_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+/// Read-only view of the contents of a whole file. Where possible the file
+/// is mapped into memory, so its pages are shared with the page cache rather
+/// than copied, and the kernel is told they'll be read front to back. Other
+/// files (pipes, or any file without mmap support) are read into a buffer.
+/// The contents are not NUL terminated.
+///////////////////////////////////////////////////////////////////////////////
+class MappedFile
+{
+private:
+	///////////////////////////////////////////////////////////////////////////
+	const char* m_data;   // contents of the file
+	size_t m_size;        // size of the file in bytes
+	bool m_mapped;        // whether m_data is a mapping (else it is m_buffer)
+	std::string m_buffer; // contents of a file which couldn't be mapped
+
+	///////////////////////////////////////////////////////////////////////////
+	inline bool ReadFile(const char* path)
+	{
+		auto fp = fopen(path, "rb");
+
+		if (fp == nullptr)
+			return false;
+
+		char chunk[65536];
+		size_t len;
+
+		while ((len = fread(chunk, 1, sizeof(chunk), fp)) > 0)
+			m_buffer.append(chunk, len);
+
+		bool ok = (ferror(fp) == 0);
+		fclose(fp);
+
+		if (!ok)
+		{
+			m_buffer.clear();
+			return false;
+		}
+
+		m_data = m_buffer.data();
+		m_size = m_buffer.size();
+		return true;
+	}
+
+#ifdef SERIALIZER_MMAP
+	///////////////////////////////////////////////////////////////////////////
+	// Returns false if the file should be read instead
+	///////////////////////////////////////////////////////////////////////////
+	inline bool MapFile(const char* path)
+	{
+		int fd = open(path, O_RDONLY);
+
+		if (fd < 0)
+			return false;
+
+		struct stat st;
+
+		if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0
+		  || uint64_t(st.st_size) > uint64_t(SIZE_MAX))
+		{
+			close(fd);
+			return false;
+		}
+
+		auto size = size_t(st.st_size);
+		auto p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd); // the mapping keeps the file open
+
+		if (p == MAP_FAILED)
+			return false;
+
+		madvise(p, size, MADV_SEQUENTIAL);
+
+		m_data = static_cast<const char*>(p);
+		m_size = size;
+		m_mapped = true;
+		return true;
+	}
+#endif
+
+public:
+	///////////////////////////////////////////////////////////////////////////
+	inline MappedFile()
+		:
+		m_data(""),
+		m_size(0),
+		m_mapped(false)
+	{ }
+
+	///////////////////////////////////////////////////////////////////////////
+	MappedFile(const MappedFile& rhs) = delete;
+	MappedFile& operator=(const MappedFile& rhs) = delete;
+
+	///////////////////////////////////////////////////////////////////////////
+	inline ~MappedFile()
+	{
+		Close();
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Returns false if the file can't be read (errno tells why)
+	///////////////////////////////////////////////////////////////////////////
+	inline bool Open(const char* path)
+	{
+		Close();
+
+#ifdef SERIALIZER_MMAP
+		if (MapFile(path))
+			return true;
+#endif
+
+		return ReadFile(path);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	inline void Close()
+	{
+#ifdef SERIALIZER_MMAP
+		if (m_mapped)
+			munmap(const_cast<char*>(m_data), m_size);
+#endif
+
+		m_data = "";
+		m_size = 0;
+		m_mapped = false;
+		m_buffer.clear();
+		m_buffer.shrink_to_fit();
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	inline const char* Data() const { return m_data; }
+	inline size_t Size() const      { return m_size; }
+	inline bool IsMapped() const    { return m_mapped; }
+};
@@ -0,0 +1,331 @@
+/*
+ * SerializerCpp
+ * Copyright (c) 2015-2016 Christopher D. Granz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+
+#include "FloatFormat.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SERIALIZER_FD_OUTPUT 1
+#include <cerrno>
+#include <unistd.h>
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+/// Collects output in one large buffer and hands it to a FILE*, a file
+/// descriptor or a std::string in big pieces, so writers can emit many
+/// small tokens without a library call (and a stdio lock) for each one.
+/// Whatever is still buffered is flushed by the destructor.
+///////////////////////////////////////////////////////////////////////////////
+class OutputBuffer
+{
+private:
+	///////////////////////////////////////////////////////////////////////////
+	enum class Sink
+	{
+		File,
+		Descriptor,
+		String
+	};
+
+	static const size_t MIN_CAPACITY = 256;
+	static const size_t DEFAULT_CAPACITY = (64 << 10);
+
+	Sink m_sink;
+	FILE* m_file;          // for Sink::File
+	int m_fd;              // for Sink::Descriptor
+	std::string* m_string; // for Sink::String (appended to)
+
+	char* m_buffer;
+	size_t m_capacity;
+	size_t m_used;
+	bool m_failed;         // a write to the sink went wrong
+
+	///////////////////////////////////////////////////////////////////////////
+	inline void Init(size_t capacity)
+	{
+		if (capacity < MIN_CAPACITY)
+			capacity = MIN_CAPACITY;
+
+		m_capacity = capacity;
+		m_buffer = static_cast<char*>(malloc(m_capacity));
+
+		if (m_buffer == nullptr)
+			throw std::bad_alloc();
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	inline void WriteToSink(const char* p, size_t len)
+	{
+		if (m_failed || len == 0)
+			return;
+
+		switch (m_sink)
+		{
+		case Sink::File:
+			if (fwrite(p, 1, len, m_file) != len)
+				m_failed = true;
+			break;
+
+		case Sink::Descriptor:
+#ifdef SERIALIZER_FD_OUTPUT
+			while (len > 0)
+			{
+				auto n = write(m_fd, p, len);
+
+				if (n < 0)
+				{
+					if (errno == EINTR)
+						continue;
+
+					m_failed = true;
+					break;
+				}
+
+				p += n;
+				len -= size_t(n);
+			}
+#else
+			m_failed = true;
+#endif
+			break;
+
+		case Sink::String:
+			m_string->append(p, len);
+			break;
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Writes value backwards ending just before end, returns the first digit
+	///////////////////////////////////////////////////////////////////////////
+	static inline char* FormatUInt(uint64_t value, char* end)
+	{
+		static const char digitPairs[] =
+			"00010203040506070809" "10111213141516171819"
+			"20212223242526272829" "30313233343536373839"
+			"40414243444546474849" "50515253545556575859"
+			"60616263646566676869" "70717273747576777879"
+			"80818283848586878889" "90919293949596979899";
+
+		auto p = end;
+
+		while (value >= 100)
+		{
+			auto pair = size_t(value % 100) * 2;
+			value /= 100;
+			*--p = digitPairs[pair + 1];
+			*--p = digitPairs[pair];
+		}
+
+		if (value >= 10)
+		{
+			auto pair = size_t(value) * 2;
+			*--p = digitPairs[pair + 1];
+			*--p = digitPairs[pair];
+		}
+		else
+			*--p = char('0' + value);
+
+		return p;
+	}
+
+public:
+	///////////////////////////////////////////////////////////////////////////
+	inline explicit OutputBuffer(FILE* fp, size_t capacity = DEFAULT_CAPACITY)
+		:
+		m_sink(Sink::File),
+		m_file(fp),
+		m_fd(-1),
+		m_string(nullptr),
+		m_used(0),
+		m_failed(false)
+	{
+		assert(fp != nullptr);
+		Init(capacity);
+	}
+
+#ifdef SERIALIZER_FD_OUTPUT
+	///////////////////////////////////////////////////////////////////////////
+	inline explicit OutputBuffer(int fd, size_t capacity = DEFAULT_CAPACITY)
+		:
+		m_sink(Sink::Descriptor),
+		m_file(nullptr),
+		m_fd(fd),
+		m_string(nullptr),
+		m_used(0),
+		m_failed(false)
+	{
+		assert(fd >= 0);
+		Init(capacity);
+	}
+#endif
+
+	///////////////////////////////////////////////////////////////////////////
+	// Output is appended to str
+	///////////////////////////////////////////////////////////////////////////
+	inline explicit OutputBuffer(std::string& str, size_t capacity = DEFAULT_CAPACITY)
+		:
+		m_sink(Sink::String),
+		m_file(nullptr),
+		m_fd(-1),
+		m_string(&str),
+		m_used(0),
+		m_failed(false)
+	{
+		Init(capacity);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	OutputBuffer(const OutputBuffer& rhs) = delete;
+	OutputBuffer& operator=(const OutputBuffer& rhs) = delete;
+
+	///////////////////////////////////////////////////////////////////////////
+	inline ~OutputBuffer()
+	{
+		Flush();
+		free(m_buffer);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Pass everything buffered on to the sink. Returns false if any write
+	// so far has failed. FILE* sinks are not fflush()ed.
+	///////////////////////////////////////////////////////////////////////////
+	inline bool Flush()
+	{
+		WriteToSink(m_buffer, m_used);
+		m_used = 0;
+		return !m_failed;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	inline bool Failed() const { return m_failed; }
+
+	///////////////////////////////////////////////////////////////////////////
+	inline void Put(char c)
+	{
+		if (m_used == m_capacity)
+			Flush();
+
+		m_buffer[m_used++] = c;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	inline void Fill(char c, size_t count)
+	{
+		while (count > 0)
+		{
+			if (m_used == m_capacity)
+				Flush();
+
+			auto n = (count < m_capacity - m_used ? count : m_capacity - m_used);
+			memset(m_buffer + m_used, c, n);
+			m_used += n;
+			count -= n;
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	inline void Write(const char* p, size_t len)
+	{
+		if (m_capacity - m_used < len)
+		{
+			Flush();
+
+			// too big to be worth copying
+			if (len >= m_capacity)
+			{
+				WriteToSink(p, len);
+				return;
+			}
+		}
+
+		memcpy(m_buffer + m_used, p, len);
+		m_used += len;
+	}
+
+	inline void Write(const char* str)        { Write(str, strlen(str)); }
+	inline void Write(const std::string& str) { Write(str.data(), str.size()); }
+
+	///////////////////////////////////////////////////////////////////////////
+	inline void WriteUInt(uint64_t value)
+	{
+		char digits[20];
+		auto end = digits + sizeof(digits);
+		auto p = FormatUInt(value, end);
+		Write(p, size_t(end - p));
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	inline void WriteInt(int64_t value)
+	{
+		char digits[21];
+		auto end = digits + sizeof(digits);
+
+		// negate as unsigned so INT64_MIN works
+		auto p = FormatUInt(value < 0 ? (0 - uint64_t(value)) : uint64_t(value), end);
+
+		if (value < 0)
+			*--p = '-';
+
+		Write(p, size_t(end - p));
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Shortest form which reads back as the same value (see FloatFormat).
+	// JSON has no NaN or infinity, so they are written as null.
+	///////////////////////////////////////////////////////////////////////////
+	inline void WriteDouble(double value)
+	{
+		if (!std::isfinite(value))
+		{
+			Write("null", 4);
+			return;
+		}
+
+		char digits[FloatFormat::MAX_LENGTH];
+		Write(digits, FloatFormat::Format(value, digits));
+	}
+
+	inline void WriteFloat(float value)
+	{
+		if (!std::isfinite(value))
+		{
+			Write("null", 4);
+			return;
+		}
+
+		char digits[FloatFormat::MAX_LENGTH];
+		Write(digits, FloatFormat::Format(value, digits));
+	}
+};
@@ -1,869 +1,2442 @@
-/*
- * SerializerCpp
- * Copyright (c) 2015-2016 Christopher D. Granz
- *
- * Permission is hereby granted, free of charge, to any person obtaining a
- * copy of this software and associated documentation files (the "Software"),
- * to deal in the Software without restriction, including without limitation
- * the rights to use, copy, modify, merge, publish, distribute, sublicense,
- * and/or sell copies of the Software, and to permit persons to whom the
- * Software is furnished to do so, subject to the following conditions:
- *
- * The above copyright notice and this permission notice shall be included in
- * all copies or substantial portions of the Software.
- *
- * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
- * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
- * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
- * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
- * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
- * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
- * IN THE SOFTWARE.
- */
-
-#pragma once
-
-#include <cassert>
-#include <cstdio>
-#include <cstring>
-#include <string>
-#include <vector>
-#include <map>
-
-///////////////////////////////////////////////////////////////////////////////
-class ParserJSON
-{
-public:
-	///////////////////////////////////////////////////////////////////////////
-	// JSON data types
-	///////////////////////////////////////////////////////////////////////////
-	enum class DataType : unsigned char
-	{
-		Undefined = 0,
-		Number,
-		String,
-		Boolean,
-		Array,
-		Object,
-		Null,
-	};
-
-	///////////////////////////////////////////////////////////////////////////
-	struct Node
-	{
-		DataType type;    // node type, see above
-		std::string name; // node name, may be empty for array entries
-		std::string data; // value if type is Number, String, Boolean, or Null
-		std::vector<Node*> children; // pointers to children if type is Array or Object (data above not used in that case)
-
-		///////////////////////////////////////////////////////////////////////
-		inline Node(DataType type = DataType::Undefined)
-			: type(type)
-		{ }
-
-		///////////////////////////////////////////////////////////////////////
-		inline const Node* GetChild(const char* name) const
-		{
-			if (type != DataType::Object)
-				return nullptr;
-
-			for (auto& child : children)
-			{
-				if (child->name == name)
-					return child;
-			}
-
-			return nullptr; // not found
-		}
-
-		///////////////////////////////////////////////////////////////////////
-		inline const Node* GetChild(size_t index) const
-		{
-			if (type != DataType::Object && type != DataType::Array)
-				return nullptr;
-
-			if (index < children.size())
-				return children[index];
-
-			return nullptr; // not found
-		}
-
-		///////////////////////////////////////////////////////////////////////
-		// For debugging purposes
-		///////////////////////////////////////////////////////////////////////
-		bool Print(int indentLevel = 0) const
-		{
-			for (int i = 0; i < indentLevel; ++i)
-				printf("\t");
-
-			if (name != "") // has a name
-			{
-				if (type == DataType::Array || type == DataType::Object)
-				{
-					printf("\"%s\" :\n", name.c_str());
-
-					for (int i = 0; i < indentLevel; ++i)
-						printf("\t");
-				}
-				else
-					printf("\"%s\" : ", name.c_str());
-			}
-
-			switch (type)
-			{
-			case DataType::Undefined:
-			case DataType::Number:
-			case DataType::Boolean:
-			case DataType::Null:
-				printf("%s", data.c_str());
-				break;
-
-			case DataType::String:
-				printf("\"%s\"", data.c_str());
-				break;
-
-			case DataType::Array:
-				printf("[\n");
-
-				for (decltype(children.size()) i = 0; i < children.size(); ++i)
-				{
-					assert(children[i] != nullptr);
-					children[i]->Print(indentLevel + 1);
-
-					if (i == (children.size() - 1))
-						printf("\n");
-					else
-						printf(",\n");
-				}
-
-				for (int i = 0; i < indentLevel; ++i)
-					printf("\t");
-
-				printf("]");
-				break;
-
-			case DataType::Object:
-				printf("{\n");
-
-				for (decltype(children.size()) i = 0; i < children.size(); ++i)
-				{
-					assert(children[i] != nullptr);
-					children[i]->Print(indentLevel + 1);
-
-					if (i == (children.size() - 1))
-						printf("\n");
-					else
-						printf(",\n");
-				}
-
-				for (int i = 0; i < indentLevel; ++i)
-					printf("\t");
-
-				printf("}");
-				break;
-			}
-
-			return true;
-		}
-	};
-
-	///////////////////////////////////////////////////////////////////////////
-	enum class ParseError
-	{
-		None = 0,
-		InternalError,
-		BadFormat,
-		BadNumberFormat,
-		InvalidRoot,
-		InvalidKey,
-		MissingKeyValueSeperator,
-		MissingComma,
-		UnterminatedString,
-		InvalidEscape,
-		OutOfPlaceBrace,
-		OutOfPlaceSquareBracket,
-	};
-
-private:
-	std::vector<Node*> m_nodes;     // we allocate nodes from here (allows for easy cleanup)
-	ParseError m_lastError;        // error code from last call to Parse()
-	std::string m_lastErrorDesc;   // description of last error
-	//std::string m_lastErrorLine;   // line which contains the error
-	size_t m_lastErrorLineNo;      // current line number (starting at 1)
-	size_t m_lastErrorCharNo;      // offset in line since last newline (starting at 1)
-
-public:
-	///////////////////////////////////////////////////////////////////////////
-	inline ParserJSON()
-		:
-		m_lastError(ParseError::None)
-	{ }
-
-	///////////////////////////////////////////////////////////////////////////
-	inline ParserJSON(std::string str, size_t reserveNodes = 100)
-		:
-		m_lastError(ParseError::None)
-	{
-		Parse(str.c_str(), reserveNodes);
-	}
-
-	///////////////////////////////////////////////////////////////////////////
-	inline Node const* GetRoot()                 { return (m_nodes.size() == 0 ? nullptr : m_nodes[0]); }
-	inline ParseError GetLastError()             { return m_lastError; }
-	inline const std::string& GetLastErrorDesc() { return m_lastErrorDesc; }
-
-	///////////////////////////////////////////////////////////////////////////
-	inline void PrintLastError()
-	{
-		printf("\n");
-
-		switch (m_lastError)
-		{
-		case ParseError::None: printf("No error\n"); return;
-		case ParseError::InternalError: printf("Internal error\n"); return;
-		case ParseError::BadFormat: printf("BadFormat"); break;
-		case ParseError::BadNumberFormat: printf("BadNumberFormat"); break;
-		case ParseError::InvalidRoot: printf("InvalidRoot"); break;
-		case ParseError::InvalidKey: printf("InvalidKey"); break;
-		case ParseError::MissingKeyValueSeperator: printf("MissingKeyValueSeperator"); break;
-		case ParseError::MissingComma: printf("MissingComma"); break;
-		case ParseError::UnterminatedString: printf("UnterminatedString"); break;
-		case ParseError::InvalidEscape: printf("InvalidEscape"); break;
-		case ParseError::OutOfPlaceBrace: printf("OutOfPlaceBrace"); break;
-		case ParseError::OutOfPlaceSquareBracket: printf("OutOfPlaceSquareBracket"); break;
-		}
-
-		printf(": (line %ld, char %ld) %s\n", long(m_lastErrorLineNo), long(m_lastErrorCharNo), m_lastErrorDesc.c_str());
-	}
-
-	///////////////////////////////////////////////////////////////////////////
-	// JSON Number format: https://tools.ietf.org/html/rfc7159
-	//
-	// number = [minus] int [frac] [exp]
-	// decimal - point = %x2E; .
-	// digit1 - 9 = %x31 - 39; 1 - 9
-	// e = %x65 / %x45; e E
-	// exp = e [minus / plus] 1 * DIGIT
-	// frac = decimal - point 1 * DIGIT
-	// int = zero / (digit1 - 9 * DIGIT)
-	// minus = %x2D; -
-	// plus = %x2B; +
-	// zero = %x30; 0
-	///////////////////////////////////////////////////////////////////////////
-	static inline bool IsNumber(const char* p)
-	{
-		// leading minus
-		if (*p == '-')
-			++p;
-
-		// int part
-		if (*p < '0' || *p > '9')
-			return false;
-
-		// int digits
-		if (*p == '0') // zero by itself is a valid int
-			++p;
-		else // otherwise we have multiple digits (but no leading zero)
-		{
-			while (*p != '\0')
-			{
-				if (*p < '0' || *p > '9')
-					break;
-
-				++p;
-			}
-		}
-
-		// optional fractional part
-		if (*p == '.')
-		{
-			if (*++p == '\0')
-				return false;
-
-			while (*p != '\0')
-			{
-				if (*p < '0' || *p > '9')
-					break;
-
-				++p;
-			}
-		}
-
-		// optional exponent part
-		if (*p == 'e' || *p == 'E')
-		{
-			++p;
-
-			if (*p == '+' || *p == '-')
-				++p;
-
-			if (*p == '\0')
-				return false;
-
-			while (*p != '\0')
-			{
-				if (*p < '0' || *p > '9')
-					break;
-
-				++p;
-			}
-		}
-
-		if (*p != '\0')
-			return false;
-
-		return true;
-	}
-
-	///////////////////////////////////////////////////////////////////////////
-	static inline bool IsBoolean(const char* p) { return (!strcmp(p, "true") || !strcmp(p, "false")); }
-	static inline bool IsNull(const char* p) { return !strcmp(p, "null"); }
-
-private:
-	///////////////////////////////////////////////////////////////////////////
-	// Helper function to parse a JSON Number, Boolean, or Null.
-	///////////////////////////////////////////////////////////////////////////
-	inline int ParsePrimitive(const char* p, std::string& result)
-	{
-		if (p[0] == ':' || p[0] == '\t' || p[0] == '\r' || p[0] == '\n'
-		  || p[0] == ' ' || p[0] == ',' || p[0] == ']' || p[0] == '}'
-		  || p[0] == '\0')
-		{
-			m_lastError = ParseError::BadFormat;
-			m_lastErrorDesc = "Unexpected end to JSON Number, Boolean, or Null";
-			return -1;
-		}
-
-		for (int i = 1; p[i] != '\0'; ++i)
-		{
-			++m_lastErrorCharNo;
-
-			if (p[i] == ':' || p[i] == '\t' || p[i] == '\r' || p[i] == '\n'
-			  || p[i] == ' ' || p[i] == ',' || p[i] == ']' || p[i] == '}')
-			{
-				result = std::string(&p[0], i);
-				return (i - 1); // don't include delimiter
-			}
-
-			if (p[i] < 32 || p[i] >= 127) // invalid character
-				return -1;
-		}
-
-		m_lastError = ParseError::BadFormat;
-		m_lastErrorDesc = "Unexpected end to JSON Number, Boolean, or Null";
-		return -1; // never closed
-	}
-
-	///////////////////////////////////////////////////////////////////////////
-	// Helper function to parse a JSON String.
-	///////////////////////////////////////////////////////////////////////////
-	inline int ParseString(const char* p, std::string& result)
-	{
-		if (p[0] != '\"')
-		{
-			m_lastError = ParseError::BadFormat;
-			m_lastErrorDesc = "Unexpected start character for JSON String";
-			return -1;
-		}
-
-		for (int i = 1; p[i] != '\0'; ++i)
-		{
-			++m_lastErrorCharNo;
-
-			// quote indicates end of string
-			if (p[i] == '\"')
-			{
-				result = std::string(&p[1], (i - 1));
-				return i;
-			}
-
-			// control characters are not allowed in string (need escaping)
-			if (p[i] == '\b' || p[i] == '\f' || p[i] == '\r' || p[i] == '\n' || p[i] == '\t')
-				break;
-
-			// backslash escape
-			if (p[i] == '\\' && p[i + 1] != '\0')
-			{
-				++i;
-
-				switch (p[i])
-				{
-				// allowed escaped symbols
-				case '\"': case '/' : case '\\' : case 'b' :
-				case 'f' : case 'r' : case 'n'  : case 't' :
-					break;
-
-				// escaped symbol \uXXXX
-				case 'u':
-					++i;
-
-					for (int k = 0; k < 4 && p[i] != '\0'; ++k, ++i)
-					{
-						++m_lastErrorCharNo;
-
-						// check for valid hexadecimal character
-						if (!((p[i] >= '0' && p[i] <= '9') // 0-9
-						  || (p[i] >= 'A' && p[i] <= 'F') // A-F
-						  || (p[i] >= 'a' && p[i] <= 'f'))) // a-f
-						{
-							m_lastError = ParseError::InvalidEscape;
-							m_lastErrorDesc = "Invalid escape character in JSON String";
-							return -1; // error
-						}
-					}
-
-					--i;
-					break;
-
-				// unexpected escape symbol
-				default:
-					m_lastError = ParseError::InvalidEscape;
-					m_lastErrorDesc = "Invalid escape character in JSON String";
-					return -1; // error
-				}
-			}
-		}
-
-		m_lastError = ParseError::UnterminatedString;
-		m_lastErrorDesc = "Unterminated JSON String";
-		return -1; // never closed
-	}
-
-public:
-	///////////////////////////////////////////////////////////////////////////
-	void Parse(const char* str, size_t reserveNodes = 100)
-	{
-		// reset everything
-		for (auto p : m_nodes)
-			delete p;
-
-		m_nodes.clear();
-		m_nodes.reserve(reserveNodes);
-		m_lastError = ParseError::None;
-		m_lastErrorDesc = "No error";
-		m_lastErrorLineNo = 1;
-		m_lastErrorCharNo = 1;
-
-		// parser states
-		enum class State
-		{
-			Root = 0,
-			Key,
-			Value,
-			KeyValueSeparator,
-			CommaOrEnd,
-			Done,
-		};
-
-		//Node* root = nullptr;
-		Node* curr = nullptr;
-		State state = State::Root;
-		std::vector<Node*> containerStack;
-
-		for (size_t i = 0; str[i] != '\0'; ++i)
-		{
-			if (state == State::Done)
-				break;
-
-			// skip whitespace
-			if (str[i] == ' ' || str[i] == '\t')
-			{
-				++m_lastErrorCharNo;
-				continue;
-			}
-
-			if (str[i] == '\r')
-				continue;
-
-			if (str[i] == '\n')
-			{
-				++m_lastErrorLineNo;
-				m_lastErrorCharNo = 1;
-				continue;
-			}
-
-			// handle the character depending on the current parser state
-			switch (state)
-			{
-			///////////////////////////////////////////////////////////////////
-			case State::Root:
-			{
-				if (str[i] == '{')
-				{
-					m_nodes.push_back(new Node(DataType::Object));
-					m_nodes.back()->name = "__rootObject";
-					state = State::Key;
-				}
-				else if (str[i] == '[')
-				{
-					m_nodes.push_back(new Node(DataType::Array));
-					m_nodes.back()->name = "__rootArray";
-					state = State::Value;
-				}
-				else
-				{
-					m_lastError = ParseError::InvalidRoot;
-					m_lastErrorDesc = "Root not valid JSON Object or Array";
-					return; // unexpected char
-				}
-
-				containerStack.push_back(m_nodes.back());
-				break;
-			}
-
-			///////////////////////////////////////////////////////////////////
-			case State::Key:
-			{
-				switch (str[i])
-				{
-				case '}':
-				{
-					if (containerStack.back()->type != DataType::Object)
-					{
-						m_lastError = ParseError::OutOfPlaceBrace;
-						m_lastErrorDesc = "Out of place brace";
-						return;
-					}
-
-					containerStack.pop_back();
-
-					if (containerStack.size() == 0) // root finished
-						state = State::Done;
-					else
-						state = State::CommaOrEnd;
-
-					break;
-				}
-
-				case ']':
-				{
-					if (containerStack.back()->type != DataType::Array)
-					{
-						m_lastError = ParseError::OutOfPlaceSquareBracket;
-						m_lastErrorDesc = "Out of place square bracket";
-						return;
-					}
-
-					containerStack.pop_back();
-
-					if (containerStack.size() == 0) // root finished
-						state = State::Done;
-					else
-						state = State::CommaOrEnd;
-
-					break;
-				}
-
-				case '\"':
-				{
-					m_nodes.push_back(new Node(DataType::Undefined));
-					curr = m_nodes.back();
-					auto len = ParseString(&str[i], curr->name);
-
-					if (len == -1)
-						return;
-
-					i += len;
-					state = State::KeyValueSeparator;
-					break;
-				}
-
-				default:
-					m_lastError = ParseError::InvalidKey;
-					m_lastErrorDesc = "Key is not String";
-					return;
-				}
-
-				break;
-			}
-
-			///////////////////////////////////////////////////////////////////
-			case State::KeyValueSeparator:
-			{
-				if (str[i] != ':')
-				{
-					m_lastError = ParseError::MissingKeyValueSeperator;
-					m_lastErrorDesc = "Missing key-value separator";
-					return;
-				}
-
-				state = State::Value;
-				break;
-			}
-
-			///////////////////////////////////////////////////////////////////
-			case State::Value:
-			{
-				switch (str[i])
-				{
-				case '{':
-				{
-					if (curr == nullptr)
-					{
-						m_nodes.push_back(new Node(DataType::Object));
-						curr = m_nodes.back();
-					}
-					else
-						curr->type = DataType::Object;
-
-					containerStack.back()->children.push_back(curr);
-					containerStack.push_back(curr);
-					curr = nullptr;
-					state = State::Key;
-					break;
-				}
-
-				case '[':
-				{
-					if (curr == nullptr)
-					{
-						m_nodes.push_back(new Node(DataType::Array));
-						curr = m_nodes.back();
-					}
-					else
-						curr->type = DataType::Array;
-
-					containerStack.back()->children.push_back(curr);
-					containerStack.push_back(curr);
-					curr = nullptr;
-					state = State::Value;
-					break;
-				}
-
-				case '}':
-				{
-					if (containerStack.back()->type != DataType::Object)
-					{
-						m_lastError = ParseError::OutOfPlaceBrace;
-						m_lastErrorDesc = "Out of place brace";
-						return;
-					}
-
-					containerStack.pop_back();
-
-					if (containerStack.size() == 0) // root finished
-						state = State::Done;
-					else
-						state = State::CommaOrEnd;
-
-					break;
-				}
-
-				case ']':
-				{
-					if (containerStack.back()->type != DataType::Array)
-					{
-						m_lastError = ParseError::OutOfPlaceSquareBracket;
-						m_lastErrorDesc = "Out of place square bracket";
-						return;
-					}
-
-					containerStack.pop_back();
-
-					if (containerStack.size() == 0) // root finished
-						state = State::Done;
-					else
-						state = State::CommaOrEnd;
-
-					break;
-				}
-
-				case '\"':
-				{
-					if (curr == nullptr)
-					{
-						m_nodes.push_back(new Node(DataType::String));
-						curr = m_nodes.back();
-					}
-					else
-						curr->type = DataType::String;
-
-					auto len = ParseString(&str[i], curr->data);
-
-					if (len == -1)
-						return;
-
-					i += len;
-
-					containerStack.back()->children.push_back(curr);
-					curr = nullptr;
-					state = State::CommaOrEnd;
-					break;
-				}
-
-				// handle numbers
-				case '-':
-				case '0': case '1': case '2': case '3': case '4':
-				case '5': case '6': case '7': case '8': case '9':
-				{
-					if (curr == nullptr)
-					{
-						m_nodes.push_back(new Node(DataType::Number));
-						curr = m_nodes.back();
-					}
-					else
-						curr->type = DataType::Number;
-
-					auto len = ParsePrimitive(&str[i], curr->data);
-
-					if (len == -1)
-						return;
-
-					i += len;
-
-					if (!IsNumber(curr->data.c_str()))
-					{
-						m_lastError = ParseError::BadNumberFormat;
-						m_lastErrorDesc = "Invalid JSON Number format";
-						return;
-					}
-
-					containerStack.back()->children.push_back(curr);
-					curr = nullptr;
-					state = State::CommaOrEnd;
-					break;
-				}
-
-				// handle true/false
-				case 't': case 'f':
-				{
-					if (curr == nullptr)
-					{
-						m_nodes.push_back(new Node(DataType::Boolean));
-						curr = m_nodes.back();
-					}
-					else
-						curr->type = DataType::Boolean;
-
-					auto len = ParsePrimitive(&str[i], curr->data);
-
-					if (len == -1)
-						return;
-
-					i += len;
-
-					if (!IsBoolean(curr->data.c_str()))
-					{
-						m_lastError = ParseError::BadFormat;
-						m_lastErrorDesc = "Value not JSON Number, String, Boolean, or Null";
-						return;
-					}
-
-					containerStack.back()->children.push_back(curr);
-					curr = nullptr;
-					state = State::CommaOrEnd;
-					break;
-				}
-
-				// handle null
-				case 'n':
-				{
-					if (curr == nullptr)
-					{
-						m_nodes.push_back(new Node(DataType::Null));
-						curr = m_nodes.back();
-					}
-					else
-						curr->type = DataType::Null;
-
-					auto len = ParsePrimitive(&str[i], curr->data);
-
-					if (len == -1)
-						return;
-
-					i += len;
-
-					if (!IsNull(curr->data.c_str()))
-					{
-						m_lastError = ParseError::BadFormat;
-						m_lastErrorDesc = "Value not JSON Number, String, Boolean, or Null";
-						return;
-					}
-
-					containerStack.back()->children.push_back(curr);
-					curr = nullptr;
-					state = State::CommaOrEnd;
-					break;
-				}
-
-				default:
-					m_lastError = ParseError::BadFormat;
-					m_lastErrorDesc = "Value not JSON Number, String, Boolean, or Null";
-					return;
-				}
-
-				break;
-			}
-
-			///////////////////////////////////////////////////////////////////
-			case State::CommaOrEnd:
-			{
-				switch (str[i])
-				{
-				case ',':
-				{
-					if (containerStack.back()->type == DataType::Object)
-						state = State::Key;
-					else // parent is array
-						state = State::Value;
-
-					break;
-				}
-
-				case '}':
-				{
-					if (containerStack.back()->type != DataType::Object)
-					{
-						m_lastError = ParseError::OutOfPlaceBrace;
-						m_lastErrorDesc = "Out of place brace";
-						return;
-					}
-
-					containerStack.pop_back();
-
-					if (containerStack.size() == 0) // root finished
-						state = State::Done;
-					else
-						state = State::CommaOrEnd;
-
-					break;
-				}
-
-				case ']':
-				{
-					if (containerStack.back()->type != DataType::Array)
-					{
-						m_lastError = ParseError::OutOfPlaceSquareBracket;
-						m_lastErrorDesc = "Out of place square bracket";
-						return;
-					}
-
-					containerStack.pop_back();
-
-					if (containerStack.size() == 0) // root finished
-						state = State::Done;
-					else
-						state = State::CommaOrEnd;
-
-					break;
-				}
-
-				default:
-					m_lastError = ParseError::MissingComma;
-					m_lastErrorDesc = "Missing comma";
-					return;
-				}
-
-				break;
-			}
-
-			///////////////////////////////////////////////////////////////////
-			default: // this should never happen
-				m_lastError = ParseError::InternalError;
-				m_lastErrorDesc = "Internal parser state";
-				return;
-			}
-		}
-	}
-};
-
+/*
+ * SerializerCpp
+ * Copyright (c) 2015-2016 Christopher D. Granz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <map>
+#include <new>
+
+#include "Arena.hpp"
+#include "FloatFormat.hpp"
+#include "JSONScanner.hpp"
+#include "MappedFile.hpp"
+#include "ThreadPool.hpp"
+
+///////////////////////////////////////////////////////////////////////////////
+class ParserJSON
+{
+public:
+	///////////////////////////////////////////////////////////////////////////
+	// JSON data types
+	///////////////////////////////////////////////////////////////////////////
+	enum class DataType : unsigned char
+	{
+		Undefined = 0,
+		Number,
+		String,
+		Boolean,
+		Array,
+		Object,
+		Null,
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	// Non-owning view of a key or value inside a parsed document
+	///////////////////////////////////////////////////////////////////////////
+	struct StringRef
+	{
+		const char* ptr; // first character (not NUL terminated)
+		size_t len;      // length in bytes
+
+		inline StringRef() : ptr(""), len(0) { }
+		inline StringRef(const char* ptr, size_t len) : ptr(ptr), len(len) { }
+
+		inline const char* data() const { return ptr; }
+		inline size_t size() const      { return len; }
+		inline size_t length() const    { return len; }
+		inline bool empty() const       { return (len == 0); }
+		inline std::string str() const  { return std::string(ptr, len); }
+
+		inline bool Equals(const char* s, size_t n) const { return (n == len && memcmp(ptr, s, n) == 0); }
+
+		inline bool operator==(const char* s) const        { return Equals(s, strlen(s)); }
+		inline bool operator!=(const char* s) const        { return !Equals(s, strlen(s)); }
+		inline bool operator==(const std::string& s) const { return Equals(s.data(), s.length()); }
+		inline bool operator!=(const std::string& s) const { return !Equals(s.data(), s.length()); }
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	// Value of a JSON Number, converted while it is parsed. Integers which
+	// fit are kept exactly; everything else is the nearest double.
+	///////////////////////////////////////////////////////////////////////////
+	struct Number
+	{
+		enum class Type : unsigned char
+		{
+			Double = 0,
+			Int64,
+			UInt64, // above INT64_MAX
+		};
+
+		Type type;
+
+		union
+		{
+			double d;
+			int64_t i;
+			uint64_t u;
+		};
+
+		inline Number() : type(Type::Double), d(0.0) { }
+
+		inline bool IsInteger() const { return (type != Type::Double); }
+
+		inline double ToDouble() const
+		{
+			if (type == Type::Int64)
+				return double(i);
+			else if (type == Type::UInt64)
+				return double(u);
+
+			return d;
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		// Store the value in result if it is an integer within its range
+		///////////////////////////////////////////////////////////////////////
+		template <typename IntT>
+		inline bool ToInteger(IntT& result) const
+		{
+			static_assert(std::is_integral<IntT>::value, "IntT should be an integer type");
+
+			if (type == Type::Int64)
+			{
+				if (i < 0 ? (!std::is_signed<IntT>::value || i < int64_t(std::numeric_limits<IntT>::min()))
+				  : uint64_t(i) > uint64_t(std::numeric_limits<IntT>::max()))
+					return false;
+
+				result = IntT(i);
+				return true;
+			}
+			else if (type == Type::UInt64)
+			{
+				if (u > uint64_t(std::numeric_limits<IntT>::max()))
+					return false;
+
+				result = IntT(u);
+				return true;
+			}
+
+			return false;
+		}
+	};
+
+	struct Node;
+	struct KeyIndex;
+
+	///////////////////////////////////////////////////////////////////////////
+	// Fixed list of child pointers (lives in the parser's arena)
+	///////////////////////////////////////////////////////////////////////////
+	struct NodeList
+	{
+		Node** ptr;
+		size_t count;
+
+		inline NodeList() : ptr(nullptr), count(0) { }
+
+		inline Node* const* begin() const { return ptr; }
+		inline Node* const* end() const   { return ptr + count; }
+		inline size_t size() const        { return count; }
+		inline bool empty() const         { return (count == 0); }
+		inline Node* front() const        { assert(count > 0); return ptr[0]; }
+		inline Node* back() const         { assert(count > 0); return ptr[count - 1]; }
+
+		inline Node* operator[](size_t i) const
+		{
+			assert(i < count);
+			return ptr[i];
+		}
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	struct Node
+	{
+		static const size_t NOT_FOUND = size_t(-1);
+		static const unsigned char NAME_ESCAPED = (1 << 0); // name contains backslash escapes
+		static const unsigned char DATA_ESCAPED = (1 << 1); // data contains backslash escapes
+		static const unsigned char NUMBER_INT64 = (1 << 2);  // number holds an int64_t (see Number)
+		static const unsigned char NUMBER_UINT64 = (1 << 3); // number holds a uint64_t
+
+		DataType type;       // node type, see above
+		unsigned char flags; // see above
+		StringRef name;      // node name (raw, still escaped), may be empty for array entries
+		StringRef data;      // value (raw, still escaped) if type is Number, String, Boolean, or Null
+		NodeList children;   // pointers to children if type is Array or Object (data above not used in that case)
+
+		union
+		{
+			const KeyIndex* keyIndex; // hash index over the children's names for large Objects (or nullptr), see BuildKeyIndex()
+			double number;            // value of a Number, unless flagged NUMBER_INT64 or NUMBER_UINT64
+			int64_t numberInt;
+			uint64_t numberUInt;
+		};
+
+		///////////////////////////////////////////////////////////////////////
+		inline Node(DataType type = DataType::Undefined)
+			: type(type), flags(0), keyIndex(nullptr)
+		{ }
+
+		///////////////////////////////////////////////////////////////////////
+		// Value of a Number, converted when it was parsed
+		///////////////////////////////////////////////////////////////////////
+		inline Number GetNumber() const
+		{
+			assert(type == DataType::Number);
+			Number result;
+
+			if (flags & NUMBER_INT64)
+			{
+				result.type = Number::Type::Int64;
+				result.i = numberInt;
+			}
+			else if (flags & NUMBER_UINT64)
+			{
+				result.type = Number::Type::UInt64;
+				result.u = numberUInt;
+			}
+			else
+				result.d = number;
+
+			return result;
+		}
+
+		inline void SetNumber(const Number& value)
+		{
+			flags &= ~(NUMBER_INT64 | NUMBER_UINT64);
+
+			if (value.type == Number::Type::Int64)
+			{
+				flags |= NUMBER_INT64;
+				numberInt = value.i;
+			}
+			else if (value.type == Number::Type::UInt64)
+			{
+				flags |= NUMBER_UINT64;
+				numberUInt = value.u;
+			}
+			else
+				number = value.d;
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		// Name and String value with escapes resolved. Only strings which
+		// actually contained a backslash pay for unescaping.
+		///////////////////////////////////////////////////////////////////////
+		inline std::string GetName() const
+		{
+			std::string result;
+
+			if (flags & NAME_ESCAPED)
+				Unescape(name.data(), name.size(), result);
+			else
+				result.assign(name.data(), name.size());
+
+			return result;
+		}
+
+		inline std::string GetString() const
+		{
+			std::string result;
+
+			if (flags & DATA_ESCAPED)
+				Unescape(data.data(), data.size(), result);
+			else
+				result.assign(data.data(), data.size());
+
+			return result;
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		// Position of the named child in children (or NOT_FOUND)
+		///////////////////////////////////////////////////////////////////////
+		inline size_t FindChildIndex(const char* name, size_t len) const
+		{
+			if (type != DataType::Object)
+				return NOT_FOUND;
+
+			if (keyIndex != nullptr)
+			{
+				auto mask = keyIndex->mask;
+				auto slots = keyIndex->slots;
+
+				for (auto i = (HashKey(name, len) & mask); slots[i] != 0; i = ((i + 1) & mask))
+				{
+					if (keyIndex->Name(children, slots[i] - 1).Equals(name, len))
+						return (slots[i] - 1);
+				}
+
+				return NOT_FOUND;
+			}
+
+			// small objects are faster to just scan
+			for (size_t i = 0; i < children.size(); ++i)
+			{
+				auto child = children[i];
+
+				if (child->name.Equals(name, len))
+					return i;
+
+				if ((child->flags & NAME_ESCAPED) && child->GetName().compare(0, std::string::npos, name, len) == 0)
+					return i;
+			}
+
+			return NOT_FOUND;
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		inline const Node* GetChild(const char* name, size_t len) const
+		{
+			auto i = FindChildIndex(name, len);
+			return (i == NOT_FOUND ? nullptr : children[i]);
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		inline const Node* GetChild(const char* name) const
+		{
+			return GetChild(name, strlen(name));
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		inline const Node* GetChild(size_t index) const
+		{
+			if (type != DataType::Object && type != DataType::Array)
+				return nullptr;
+
+			if (index < children.size())
+				return children[index];
+
+			return nullptr; // not found
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		// For debugging purposes
+		///////////////////////////////////////////////////////////////////////
+		bool Print(int indentLevel = 0) const
+		{
+			for (int i = 0; i < indentLevel; ++i)
+				printf("\t");
+
+			if (!name.empty()) // has a name
+			{
+				if (type == DataType::Array || type == DataType::Object)
+				{
+					printf("\"%.*s\" :\n", int(name.size()), name.data());
+
+					for (int i = 0; i < indentLevel; ++i)
+						printf("\t");
+				}
+				else
+					printf("\"%.*s\" : ", int(name.size()), name.data());
+			}
+
+			switch (type)
+			{
+			case DataType::Undefined:
+			case DataType::Number:
+			case DataType::Boolean:
+			case DataType::Null:
+				printf("%.*s", int(data.size()), data.data());
+				break;
+
+			case DataType::String:
+				printf("\"%.*s\"", int(data.size()), data.data());
+				break;
+
+			case DataType::Array:
+				printf("[\n");
+
+				for (decltype(children.size()) i = 0; i < children.size(); ++i)
+				{
+					assert(children[i] != nullptr);
+					children[i]->Print(indentLevel + 1);
+
+					if (i == (children.size() - 1))
+						printf("\n");
+					else
+						printf(",\n");
+				}
+
+				for (int i = 0; i < indentLevel; ++i)
+					printf("\t");
+
+				printf("]");
+				break;
+
+			case DataType::Object:
+				printf("{\n");
+
+				for (decltype(children.size()) i = 0; i < children.size(); ++i)
+				{
+					assert(children[i] != nullptr);
+					children[i]->Print(indentLevel + 1);
+
+					if (i == (children.size() - 1))
+						printf("\n");
+					else
+						printf(",\n");
+				}
+
+				for (int i = 0; i < indentLevel; ++i)
+					printf("\t");
+
+				printf("}");
+				break;
+			}
+
+			return true;
+		}
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	// Hash index over the names of the children of a large Object (see
+	// BuildKeyIndex()), living in the parser's arena
+	///////////////////////////////////////////////////////////////////////////
+	struct KeyIndex
+	{
+		uint32_t mask;          // slot count - 1
+		const uint32_t* slots;  // open addressing table of (child index + 1), zero means empty
+		const StringRef* names; // names of the children with escapes resolved, nullptr if none had any
+
+		inline const StringRef& Name(const NodeList& children, size_t i) const
+		{
+			return (names != nullptr ? names[i] : children[i]->name);
+		}
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	enum class ParseError
+	{
+		None = 0,
+		InternalError,
+		BadFormat,
+		BadNumberFormat,
+		InvalidRoot,
+		InvalidKey,
+		MissingKeyValueSeperator,
+		MissingComma,
+		UnterminatedString,
+		InvalidEscape,
+		OutOfPlaceBrace,
+		OutOfPlaceSquareBracket,
+		UnexpectedEnd,
+		FileError,
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	// Receives the contents of a document as it is parsed, see ParseSAX().
+	// Derive from this and hide the events you care about; calls are
+	// resolved at compile time. Keys and values are raw slices of the input
+	// (escapes still in place if escaped is set) and only valid during the
+	// call when streaming.
+	///////////////////////////////////////////////////////////////////////////
+	struct Handler
+	{
+		inline void OnObjectBegin() { }
+		inline void OnObjectEnd() { }
+		inline void OnArrayBegin() { }
+		inline void OnArrayEnd() { }
+		inline void OnKey(const char* /*p*/, size_t /*len*/, bool /*escaped*/) { }
+		inline void OnString(const char* /*p*/, size_t /*len*/, bool /*escaped*/) { }
+		inline void OnNumber(const char* /*p*/, size_t /*len*/, const Number& /*value*/) { }
+		inline void OnBoolean(bool /*value*/) { }
+		inline void OnNull() { }
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	static const size_t DEFAULT_KEY_INDEX_THRESHOLD = 16;
+	static const size_t STRUCTURAL_WINDOW = (16 * 1024); // bytes scanned for structurals at a time
+	static const size_t DEFAULT_PARALLEL_MIN_SIZE = (1 << 20); // see SetExecutor()
+	static const size_t MIN_PARALLEL_SLICE = (64 << 10);       // bytes one task parses at least
+
+private:
+	///////////////////////////////////////////////////////////////////////////
+	// parser states
+	///////////////////////////////////////////////////////////////////////////
+	enum class State
+	{
+		Root = 0,
+		Key,
+		Value,
+		KeyValueSeparator,
+		CommaOrEnd,
+		Done,
+	};
+
+	static const size_t NO_TOKEN = size_t(-1);
+
+	///////////////////////////////////////////////////////////////////////////
+	// Container which is still open during parsing
+	///////////////////////////////////////////////////////////////////////////
+	struct Container
+	{
+		Node* node;        // the Array or Object node
+		size_t firstChild; // where its children start in m_pendingChildren
+
+		inline Container(Node* node, size_t firstChild) : node(node), firstChild(firstChild) { }
+	};
+
+	Arena m_arena;                          // owns all nodes, child lists and strings (allows for easy cleanup)
+	Node* m_root;                           // root node of the last parse (or nullptr)
+	JSONScanner m_scanner;                  // finds the structural characters for the state machine
+	MappedFile m_file;                      // file given to ParseFile() (the tree points into it)
+	std::vector<size_t> m_structurals;      // structurals of the current window
+	const char* m_source;                   // document being parsed
+	bool m_inSitu;                          // keys and values point into the caller's buffer
+	size_t m_keyIndexThreshold;             // Objects with at least this many keys get a hash index (0 = never)
+	Executor* m_executor;                   // parses large Arrays in slices (or nullptr)
+	size_t m_parallelMinSize;               // bytes a document needs for that
+	std::vector<Container> m_containerStack; // open container nodes while building the tree
+	std::vector<Node*> m_pendingChildren;   // children of open containers (moved to the arena on close)
+	Node* m_curr;                           // node whose key was read but not its value yet
+	std::vector<DataType> m_nesting;        // Objects and Arrays open in the state machine
+	State m_state;                          // where the state machine is
+	size_t m_next;                          // first byte of the source not consumed yet
+	bool m_moreInput;                       // the source may continue past its end (streaming)
+	size_t m_tokenStart;                    // token cut off by the end of a stream chunk (or NO_TOKEN)
+	size_t m_tokenScanned;                  // bytes of that token known not to end it
+	std::string m_streamBuffer;             // unconsumed stream bytes (partial token and unscanned tail)
+	size_t m_streamScanned;                 // bytes of m_streamBuffer run through m_scanner
+	size_t m_sourceLineNo;                  // line of the first byte of the source (streams drop consumed bytes)
+	size_t m_sourceCharNo;                  // char of the first byte of the source in that line
+	mutable size_t m_countedOffset;         // lines of the source are counted up to here (see GetTokenPosition())
+	mutable size_t m_countedLines;          // newlines before that
+	mutable size_t m_countedLineStart;      // offset of the line that is in
+	ParseError m_lastError;        // error code from last call to Parse()
+	std::string m_lastErrorDesc;   // description of last error
+	//std::string m_lastErrorLine;   // line which contains the error
+	size_t m_errorOffset;          // byte offset of the last error
+	size_t m_lastErrorLineNo;      // line of the last error (starting at 1)
+	size_t m_lastErrorCharNo;      // offset in line since last newline (starting at 1)
+
+public:
+	///////////////////////////////////////////////////////////////////////////
+	inline ParserJSON()
+		:
+		m_root(nullptr),
+		m_source(nullptr),
+		m_inSitu(false),
+		m_keyIndexThreshold(DEFAULT_KEY_INDEX_THRESHOLD),
+		m_executor(nullptr),
+		m_parallelMinSize(DEFAULT_PARALLEL_MIN_SIZE),
+		m_curr(nullptr),
+		m_state(State::Root),
+		m_next(0),
+		m_moreInput(false),
+		m_tokenStart(NO_TOKEN),
+		m_tokenScanned(0),
+		m_streamScanned(0),
+		m_sourceLineNo(1),
+		m_sourceCharNo(1),
+		m_countedOffset(0),
+		m_countedLines(0),
+		m_countedLineStart(0),
+		m_lastError(ParseError::None),
+		m_errorOffset(0),
+		m_lastErrorLineNo(1),
+		m_lastErrorCharNo(1)
+	{ }
+
+	///////////////////////////////////////////////////////////////////////////
+	inline ParserJSON(const std::string& str, size_t reserveNodes = 100)
+		:
+		m_root(nullptr),
+		m_source(nullptr),
+		m_inSitu(false),
+		m_keyIndexThreshold(DEFAULT_KEY_INDEX_THRESHOLD),
+		m_executor(nullptr),
+		m_parallelMinSize(DEFAULT_PARALLEL_MIN_SIZE),
+		m_curr(nullptr),
+		m_state(State::Root),
+		m_next(0),
+		m_moreInput(false),
+		m_tokenStart(NO_TOKEN),
+		m_tokenScanned(0),
+		m_streamScanned(0),
+		m_sourceLineNo(1),
+		m_sourceCharNo(1),
+		m_countedOffset(0),
+		m_countedLines(0),
+		m_countedLineStart(0),
+		m_lastError(ParseError::None),
+		m_errorOffset(0),
+		m_lastErrorLineNo(1),
+		m_lastErrorCharNo(1)
+	{
+		Parse(str.c_str(), reserveNodes);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Nodes point into our arena, so copying would leave dangling pointers
+	///////////////////////////////////////////////////////////////////////////
+	ParserJSON(const ParserJSON& rhs) = delete;
+	ParserJSON& operator=(const ParserJSON& rhs) = delete;
+
+	///////////////////////////////////////////////////////////////////////////
+	// Objects with at least this many keys get a hash index for GetChild()
+	// lookups when parsed; smaller ones are scanned. Zero disables indexing.
+	///////////////////////////////////////////////////////////////////////////
+	inline void SetKeyIndexThreshold(size_t minKeys) { m_keyIndexThreshold = minKeys; }
+	inline size_t GetKeyIndexThreshold() const      { return m_keyIndexThreshold; }
+
+	///////////////////////////////////////////////////////////////////////////
+	// Executor which Parse(), ParseInSitu() and ParseFile() use to build the
+	// tree of documents of at least minSize bytes whose root is an Array,
+	// in slices at the same time (see ParseTreeParallel()). The tree comes
+	// out the same, and so do errors with their line and char. nullptr, the
+	// default, parses on the calling thread.
+	///////////////////////////////////////////////////////////////////////////
+	inline void SetExecutor(Executor* executor, size_t minSize = DEFAULT_PARALLEL_MIN_SIZE)
+	{
+		m_executor = executor;
+		m_parallelMinSize = minSize;
+	}
+
+	inline Executor* GetExecutor() const         { return m_executor; }
+	inline size_t GetParallelMinSize() const     { return m_parallelMinSize; }
+
+	///////////////////////////////////////////////////////////////////////////
+	inline Node const* GetRoot()                 { return m_root; }
+	inline ParseError GetLastError() const             { return m_lastError; }
+	inline const std::string& GetLastErrorDesc() const { return m_lastErrorDesc; }
+	inline size_t GetLastErrorLineNo() const           { return m_lastErrorLineNo; }
+	inline size_t GetLastErrorCharNo() const           { return m_lastErrorCharNo; }
+
+	///////////////////////////////////////////////////////////////////////////
+	// Line and char (both starting at 1) of the token being parsed, which a
+	// Handler can ask for during its calls. Returns false if nothing is
+	// being parsed. Lines are counted on from the previous call, so asking
+	// for every token costs about one pass over the document.
+	///////////////////////////////////////////////////////////////////////////
+	inline bool GetTokenPosition(size_t& line, size_t& column) const
+	{
+		if (m_source == nullptr)
+			return false;
+
+		auto offset = m_errorOffset;
+
+		if (offset < m_countedOffset)
+		{
+			m_countedOffset = 0;
+			m_countedLines = 0;
+			m_countedLineStart = 0;
+		}
+
+		size_t lines, lineColumn;
+		JSONScanner::GetLineColumn(&m_source[m_countedOffset], (offset - m_countedOffset), lines, lineColumn);
+
+		if (lines > 1)
+			m_countedLineStart = (offset - lineColumn + 1);
+
+		m_countedLines += (lines - 1);
+		m_countedOffset = offset;
+
+		line = (m_countedLines + 1);
+		column = (offset - m_countedLineStart + 1);
+
+		if (line == 1)
+			column += (m_sourceCharNo - 1);
+
+		line += (m_sourceLineNo - 1);
+		return true;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	inline void PrintLastError()
+	{
+		printf("\n");
+
+		switch (m_lastError)
+		{
+		case ParseError::None: printf("No error\n"); return;
+		case ParseError::InternalError: printf("Internal error\n"); return;
+		case ParseError::BadFormat: printf("BadFormat"); break;
+		case ParseError::BadNumberFormat: printf("BadNumberFormat"); break;
+		case ParseError::InvalidRoot: printf("InvalidRoot"); break;
+		case ParseError::InvalidKey: printf("InvalidKey"); break;
+		case ParseError::MissingKeyValueSeperator: printf("MissingKeyValueSeperator"); break;
+		case ParseError::MissingComma: printf("MissingComma"); break;
+		case ParseError::UnterminatedString: printf("UnterminatedString"); break;
+		case ParseError::InvalidEscape: printf("InvalidEscape"); break;
+		case ParseError::OutOfPlaceBrace: printf("OutOfPlaceBrace"); break;
+		case ParseError::OutOfPlaceSquareBracket: printf("OutOfPlaceSquareBracket"); break;
+		case ParseError::UnexpectedEnd: printf("UnexpectedEnd"); break;
+		case ParseError::FileError: printf("FileError"); break;
+		}
+
+		printf(": (line %ld, char %ld) %s\n", long(m_lastErrorLineNo), long(m_lastErrorCharNo), m_lastErrorDesc.c_str());
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// JSON Number format: https://tools.ietf.org/html/rfc7159
+	//
+	// number = [minus] int [frac] [exp]
+	// decimal - point = %x2E; .
+	// digit1 - 9 = %x31 - 39; 1 - 9
+	// e = %x65 / %x45; e E
+	// exp = e [minus / plus] 1 * DIGIT
+	// frac = decimal - point 1 * DIGIT
+	// int = zero / (digit1 - 9 * DIGIT)
+	// minus = %x2D; -
+	// plus = %x2B; +
+	// zero = %x30; 0
+	///////////////////////////////////////////////////////////////////////////
+	static inline bool IsNumber(const char* p, size_t len)
+	{
+		auto end = p + len;
+
+		// leading minus
+		if (p != end && *p == '-')
+			++p;
+
+		// int part
+		if (p == end || *p < '0' || *p > '9')
+			return false;
+
+		// int digits
+		if (*p == '0') // zero by itself is a valid int
+			++p;
+		else // otherwise we have multiple digits (but no leading zero)
+		{
+			while (p != end)
+			{
+				if (*p < '0' || *p > '9')
+					break;
+
+				++p;
+			}
+		}
+
+		// optional fractional part
+		if (p != end && *p == '.')
+		{
+			if (++p == end)
+				return false;
+
+			while (p != end)
+			{
+				if (*p < '0' || *p > '9')
+					break;
+
+				++p;
+			}
+		}
+
+		// optional exponent part
+		if (p != end && (*p == 'e' || *p == 'E'))
+		{
+			++p;
+
+			if (p != end && (*p == '+' || *p == '-'))
+				++p;
+
+			if (p == end)
+				return false;
+
+			while (p != end)
+			{
+				if (*p < '0' || *p > '9')
+					break;
+
+				++p;
+			}
+		}
+
+		if (p != end)
+			return false;
+
+		return true;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	static inline bool IsBoolean(const char* p, size_t len)
+	{
+		return ((len == 4 && memcmp(p, "true", 4) == 0) || (len == 5 && memcmp(p, "false", 5) == 0));
+	}
+
+	static inline bool IsNull(const char* p, size_t len) { return (len == 4 && memcmp(p, "null", 4) == 0); }
+
+	static inline bool IsNumber(const char* p)  { return IsNumber(p, strlen(p)); }
+	static inline bool IsBoolean(const char* p) { return IsBoolean(p, strlen(p)); }
+	static inline bool IsNull(const char* p)    { return IsNull(p, strlen(p)); }
+
+	///////////////////////////////////////////////////////////////////////////
+	static inline bool ParseHex4(const char* p, const char* end, unsigned long& result)
+	{
+		if (end - p < 4)
+			return false;
+
+		result = 0;
+
+		for (int i = 0; i < 4; ++i)
+		{
+			auto c = p[i];
+			result <<= 4;
+
+			if (c >= '0' && c <= '9')
+				result |= (c - '0');
+			else if (c >= 'A' && c <= 'F')
+				result |= (c - 'A' + 10);
+			else if (c >= 'a' && c <= 'f')
+				result |= (c - 'a' + 10);
+			else
+				return false;
+		}
+
+		return true;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	static inline void AppendUTF8(unsigned long cp, std::string& result)
+	{
+		if (cp < 0x80)
+			result += char(cp);
+		else if (cp < 0x800)
+		{
+			result += char(0xC0 | (cp >> 6));
+			result += char(0x80 | (cp & 0x3F));
+		}
+		else if (cp < 0x10000)
+		{
+			result += char(0xE0 | (cp >> 12));
+			result += char(0x80 | ((cp >> 6) & 0x3F));
+			result += char(0x80 | (cp & 0x3F));
+		}
+		else
+		{
+			result += char(0xF0 | (cp >> 18));
+			result += char(0x80 | ((cp >> 12) & 0x3F));
+			result += char(0x80 | ((cp >> 6) & 0x3F));
+			result += char(0x80 | (cp & 0x3F));
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// FNV-1a, used for the Object key index
+	///////////////////////////////////////////////////////////////////////////
+	static inline uint32_t HashKey(const char* p, size_t len)
+	{
+		uint32_t hash = 2166136261u;
+
+		for (size_t i = 0; i < len; ++i)
+		{
+			hash ^= (unsigned char)p[i];
+			hash *= 16777619u;
+		}
+
+		return hash;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Resolve the escapes of a raw (already validated) JSON String. \uXXXX
+	// escapes are written as UTF-8; unpaired surrogates become U+FFFD.
+	///////////////////////////////////////////////////////////////////////////
+	static inline void Unescape(const char* p, size_t len, std::string& result)
+	{
+		auto end = p + len;
+		result.clear();
+		result.reserve(len);
+
+		while (p != end)
+		{
+			auto q = static_cast<const char*>(memchr(p, '\\', size_t(end - p)));
+
+			if (q == nullptr)
+			{
+				result.append(p, end);
+				return;
+			}
+
+			result.append(p, q);
+			p = q + 1;
+
+			if (p == end)
+				return;
+
+			switch (*p++)
+			{
+			case 'b': result += '\b'; break;
+			case 'f': result += '\f'; break;
+			case 'n': result += '\n'; break;
+			case 'r': result += '\r'; break;
+			case 't': result += '\t'; break;
+			case 'u':
+			{
+				unsigned long cp = 0;
+
+				if (!ParseHex4(p, end, cp))
+					return;
+
+				p += 4;
+
+				// surrogate pair
+				if (cp >= 0xD800 && cp <= 0xDBFF)
+				{
+					unsigned long low = 0;
+
+					if (end - p >= 6 && p[0] == '\\' && p[1] == 'u' && ParseHex4(p + 2, end, low)
+					  && low >= 0xDC00 && low <= 0xDFFF)
+					{
+						cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+						p += 6;
+					}
+					else
+						cp = 0xFFFD;
+				}
+				else if (cp >= 0xDC00 && cp <= 0xDFFF)
+					cp = 0xFFFD;
+
+				AppendUTF8(cp, result);
+				break;
+			}
+
+			default: // \" \\ \/
+				result += p[-1];
+				break;
+			}
+		}
+	}
+
+private:
+	///////////////////////////////////////////////////////////////////////////
+	// Keys and values either point straight into the source (in-situ) or
+	// get copied into the arena.
+	///////////////////////////////////////////////////////////////////////////
+	inline StringRef MakeString(const char* p, size_t len)
+	{
+		if (m_inSitu)
+			return StringRef(p, len);
+
+		return StringRef(m_arena.CopyString(p, len), len);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	inline void SetError(ParseError error, const char* desc, const char* at)
+	{
+		m_lastError = error;
+		m_lastErrorDesc = desc;
+		m_errorOffset = size_t(at - m_source);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	static inline bool IsPrimitiveDelimiter(char c)
+	{
+		return (c == ':' || c == '\t' || c == '\r' || c == '\n'
+		  || c == ' ' || c == ',' || c == ']' || c == '}');
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// A token starting at p ran into the end of the input. If more input may
+	// follow (streaming) remember it and return end; it is parsed again once
+	// a chunk arrives which holds its end, see CutOffTokenEnds(). Otherwise
+	// this is an error.
+	///////////////////////////////////////////////////////////////////////////
+	inline const char* CutOffToken(const char* p, const char* resume, const char* end,
+	  ParseError error, const char* desc)
+	{
+		if (m_moreInput)
+		{
+			m_tokenStart = size_t(p - m_source);
+			m_tokenScanned = size_t(resume - p);
+			return end;
+		}
+
+		SetError(error, desc, end);
+		return nullptr; // never closed
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Helper function to parse a JSON Number, Boolean, or Null into a slice
+	// of the input. Returns the last character of the token (or nullptr on
+	// error, end when cut off).
+	///////////////////////////////////////////////////////////////////////////
+	inline const char* ParsePrimitive(const char* p, const char* end, StringRef& result)
+	{
+		assert(p != end && !IsPrimitiveDelimiter(p[0]));
+
+		for (auto q = p + 1; q != end; ++q)
+		{
+			if (IsPrimitiveDelimiter(*q))
+			{
+				result = StringRef(p, size_t(q - p));
+				return (q - 1); // don't include delimiter
+			}
+		}
+
+		return CutOffToken(p, end, end, ParseError::BadFormat, "Unexpected end to JSON Number, Boolean, or Null");
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Check and convert the JSON Number at p in one go (see IsNumber() for
+	// the format). Returns the first character after it, or nullptr if it
+	// isn't a valid Number or reaches end.
+	//
+	// Up to 19 digits are collected exactly into an integer. Integers are
+	// done at that point; other numbers whose digits fit in a double's 53 bit
+	// mantissa and whose exponent is small enough for an exact power of ten
+	// come out right from a single multiply or divide (Clinger's fast path).
+	// Anything else goes to FloatFormat::ParseDouble(), which rounds
+	// correctly.
+	///////////////////////////////////////////////////////////////////////////
+	static inline const char* ScanNumber(const char* p, const char* end, Number& result)
+	{
+		auto start = p;
+		bool negative = (*p == '-');
+
+		if (negative && ++p == end)
+			return nullptr;
+
+		if (*p < '0' || *p > '9')
+			return nullptr;
+
+		uint64_t mantissa = 0;
+		auto digitsStart = p;
+
+		if (*p == '0') // no leading zeros
+			++p;
+		else
+		{
+			for (; p != end && *p >= '0' && *p <= '9'; ++p)
+				mantissa = (mantissa * 10 + uint64_t(*p - '0'));
+		}
+
+		auto digits = size_t(p - digitsStart);
+		long exponent = 0;
+		bool isInteger = true;
+
+		if (p != end && *p == '.')
+		{
+			isInteger = false;
+			auto fracStart = ++p;
+
+			// the digits may be left out, but not the rest of the token
+			if (p == end || IsPrimitiveDelimiter(*p))
+				return nullptr;
+
+			for (; p != end && *p >= '0' && *p <= '9'; ++p)
+				mantissa = (mantissa * 10 + uint64_t(*p - '0'));
+
+			digits += size_t(p - fracStart);
+			exponent = -long(p - fracStart);
+		}
+
+		if (p != end && (*p == 'e' || *p == 'E'))
+		{
+			isInteger = false;
+			bool negativeExponent = false;
+
+			if (++p != end && (*p == '+' || *p == '-'))
+				negativeExponent = (*p++ == '-');
+
+			if (p == end || *p < '0' || *p > '9')
+				return nullptr;
+
+			long e = 0;
+
+			for (; p != end && *p >= '0' && *p <= '9'; ++p)
+			{
+				if (e < 100000) // far beyond what a double can hold either way
+					e = (e * 10 + long(*p - '0'));
+			}
+
+			exponent += (negativeExponent ? -e : e);
+		}
+
+		if (p == end)
+			return nullptr;
+
+		if (digits <= 19) // mantissa is exact
+		{
+			if (isInteger)
+			{
+				if (!negative && mantissa <= uint64_t(INT64_MAX))
+				{
+					result.type = Number::Type::Int64;
+					result.i = int64_t(mantissa);
+					return p;
+				}
+				else if (!negative)
+				{
+					result.type = Number::Type::UInt64;
+					result.u = mantissa;
+					return p;
+				}
+				else if (mantissa <= uint64_t(INT64_MAX) + 1)
+				{
+					result.type = Number::Type::Int64;
+					result.i = int64_t(0 - mantissa);
+					return p;
+				}
+			}
+			else if (mantissa <= (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22)
+			{
+				static const double powersOf10[] = {
+					1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+					1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+				};
+
+				auto d = double(mantissa);
+
+				if (exponent < 0)
+					d /= powersOf10[-exponent];
+				else
+					d *= powersOf10[exponent];
+
+				result.type = Number::Type::Double;
+				result.d = (negative ? -d : d);
+				return p;
+			}
+		}
+
+		ConvertNumberSlow(start, size_t(p - start), isInteger, result);
+		return p;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	static inline void ConvertNumberSlow(const char* p, size_t len, bool isInteger, Number& result)
+	{
+		if (isInteger && ConvertLongInteger(p, len, result))
+			return;
+
+		// the input isn't NUL terminated (in-situ, files and streams)
+		char buf[64];
+		std::string longNumber;
+		const char* str = buf;
+
+		if (len < sizeof(buf))
+		{
+			memcpy(buf, p, len);
+			buf[len] = '\0';
+		}
+		else
+		{
+			longNumber.assign(p, len);
+			str = longNumber.c_str();
+		}
+
+		result.type = Number::Type::Double;
+		result.d = FloatFormat::ParseDouble(str);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// An integer with too many digits to collect exactly, which may still
+	// fit in 64 bits (20 digits). Returns false if it doesn't.
+	///////////////////////////////////////////////////////////////////////////
+	static inline bool ConvertLongInteger(const char* p, size_t len, Number& result)
+	{
+		bool negative = (*p == '-');
+		uint64_t value = 0;
+
+		for (size_t i = (negative ? 1 : 0); i < len; ++i)
+		{
+			auto digit = uint64_t(p[i] - '0');
+
+			if (value > (UINT64_MAX - digit) / 10)
+				return false;
+
+			value = (value * 10 + digit);
+		}
+
+		if (!negative)
+		{
+			result.type = (value <= uint64_t(INT64_MAX) ? Number::Type::Int64 : Number::Type::UInt64);
+			result.u = value;
+		}
+		else if (value <= uint64_t(INT64_MAX) + 1)
+		{
+			result.type = Number::Type::Int64;
+			result.i = int64_t(0 - value);
+		}
+		else
+			return false;
+
+		return true;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Helper function to parse a JSON Number into a slice of the input and
+	// its value. Returns the last character of the token (or nullptr on
+	// error, end when cut off).
+	///////////////////////////////////////////////////////////////////////////
+	inline const char* ParseNumber(const char* p, const char* end, StringRef& result, Number& value)
+	{
+		auto q = ScanNumber(p, end, value);
+
+		if (q != nullptr && IsPrimitiveDelimiter(*q))
+		{
+			result = StringRef(p, size_t(q - p));
+			return (q - 1); // don't include delimiter
+		}
+
+		// not a valid Number or it runs into the end; find where the token
+		// ends to tell which
+		auto last = ParsePrimitive(p, end, result);
+
+		if (last == nullptr || last == end)
+			return last;
+
+		SetError(ParseError::BadNumberFormat, "Invalid JSON Number format", p);
+		return nullptr;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Helper function to parse a JSON String into a slice of the input (still
+	// escaped). Returns the closing quote (or nullptr on error, end when cut
+	// off). Plain runs of characters are skipped 16 or 32 bytes at a time;
+	// only quotes, backslashes and control characters stop us.
+	///////////////////////////////////////////////////////////////////////////
+	inline const char* ParseString(const char* p, const char* end, StringRef& result, bool& escaped)
+	{
+		if (p[0] != '\"')
+		{
+			SetError(ParseError::BadFormat, "Unexpected start character for JSON String", p);
+			return nullptr;
+		}
+
+		escaped = false;
+		auto q = p + 1;
+
+		for (;;)
+		{
+			q = JSONScanner::FindStringSpecial(q, end);
+
+			if (q == end)
+				return CutOffToken(p, q, end, ParseError::UnterminatedString, "Unterminated JSON String");
+
+			// quote indicates end of string
+			if (*q == '\"')
+			{
+				result = StringRef(p + 1, size_t(q - p - 1));
+				return q;
+			}
+
+			// backslash escape
+			if (*q == '\\')
+			{
+				auto escape = q; // escapes are checked in one piece
+
+				if (q + 1 == end)
+					return CutOffToken(p, escape, end, ParseError::UnterminatedString, "Unterminated JSON String");
+
+				escaped = true;
+				++q;
+
+				switch (*q)
+				{
+				// allowed escaped symbols
+				case '\"': case '/' : case '\\' : case 'b' :
+				case 'f' : case 'r' : case 'n'  : case 't' :
+					++q;
+					break;
+
+				// escaped symbol \uXXXX
+				case 'u':
+					++q;
+
+					for (int k = 0; k < 4; ++k, ++q)
+					{
+						if (q == end)
+							return CutOffToken(p, escape, end, ParseError::UnterminatedString, "Unterminated JSON String");
+
+						// check for valid hexadecimal character
+						if (!((*q >= '0' && *q <= '9') // 0-9
+						  || (*q >= 'A' && *q <= 'F') // A-F
+						  || (*q >= 'a' && *q <= 'f'))) // a-f
+						{
+							SetError(ParseError::InvalidEscape, "Invalid escape character in JSON String", q);
+							return nullptr; // error
+						}
+					}
+
+					break;
+
+				// unexpected escape symbol
+				default:
+					SetError(ParseError::InvalidEscape, "Invalid escape character in JSON String", q);
+					return nullptr; // error
+				}
+
+				continue;
+			}
+
+			// control characters are not allowed in string (need escaping)
+			if (*q == '\b' || *q == '\f' || *q == '\r' || *q == '\n' || *q == '\t')
+			{
+				SetError(ParseError::UnterminatedString, "Unterminated JSON String", q);
+				return nullptr;
+			}
+
+			++q; // other control characters are let through
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	inline Node* NewNode(DataType type)
+	{
+		return new (m_arena.AllocateArray<Node>(1)) Node(type);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	inline void OpenContainer(Node* node)
+	{
+		m_containerStack.push_back(Container(node, m_pendingChildren.size()));
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Move the children collected for the innermost container into one
+	// exactly sized list in the arena.
+	///////////////////////////////////////////////////////////////////////////
+	inline void CloseContainer()
+	{
+		assert(!m_containerStack.empty());
+		auto& c = m_containerStack.back();
+		auto count = m_pendingChildren.size() - c.firstChild;
+
+		if (count > 0)
+		{
+			c.node->children.ptr = m_arena.AllocateArray<Node*>(count);
+			c.node->children.count = count;
+			memcpy(c.node->children.ptr, &m_pendingChildren[c.firstChild], count * sizeof(Node*));
+			BuildKeyIndex(c.node);
+		}
+
+		m_pendingChildren.resize(c.firstChild);
+		m_containerStack.pop_back();
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Build the hash index used by Node::GetChild() for large Objects. The
+	// table is kept at most half full; duplicate keys keep the first entry
+	// so lookups match what a linear scan would find. Raw keys with escapes
+	// wouldn't hash like the names looked up, so if there are any, all the
+	// names are kept with their escapes resolved (once, in the arena).
+	///////////////////////////////////////////////////////////////////////////
+	inline void BuildKeyIndex(Node* node)
+	{
+		auto count = node->children.size();
+
+		if (node->type != DataType::Object || m_keyIndexThreshold == 0 || count < m_keyIndexThreshold
+		  || count >= 0x7FFFFFFF)
+			return;
+
+		auto index = m_arena.AllocateArray<KeyIndex>(1);
+		index->names = nullptr;
+
+		for (auto child : node->children)
+		{
+			if (child->flags & Node::NAME_ESCAPED)
+			{
+				index->names = UnescapeNames(node->children);
+				break;
+			}
+		}
+
+		uint32_t capacity = 1;
+
+		while (capacity < count * 2)
+			capacity <<= 1;
+
+		auto slots = m_arena.AllocateArray<uint32_t>(capacity);
+		auto mask = (capacity - 1);
+		memset(slots, 0, capacity * sizeof(uint32_t));
+		index->mask = mask;
+		index->slots = slots;
+
+		for (uint32_t k = 0; k < count; ++k)
+		{
+			auto& name = index->Name(node->children, k);
+			auto i = (HashKey(name.data(), name.size()) & mask);
+
+			for (; slots[i] != 0; i = ((i + 1) & mask))
+			{
+				if (index->Name(node->children, slots[i] - 1).Equals(name.data(), name.size()))
+					break; // duplicate key
+			}
+
+			if (slots[i] == 0)
+				slots[i] = (k + 1);
+		}
+
+		node->keyIndex = index;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	inline const StringRef* UnescapeNames(const NodeList& children)
+	{
+		auto names = m_arena.AllocateArray<StringRef>(children.size());
+		std::string unescaped;
+
+		for (size_t k = 0; k < children.size(); ++k)
+		{
+			auto child = children[k];
+
+			if (child->flags & Node::NAME_ESCAPED)
+			{
+				Unescape(child->name.data(), child->name.size(), unescaped);
+				new (&names[k]) StringRef(m_arena.CopyString(unescaped.data(), unescaped.size()), unescaped.size());
+			}
+			else
+				new (&names[k]) StringRef(child->name);
+		}
+
+		return names;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// The Handler which builds the Node tree for Parse() and friends. Like
+	// the state machine it keeps the node it works on in a local and hands
+	// it back to the parser when done, so streams can pick up where they
+	// left off.
+	///////////////////////////////////////////////////////////////////////////
+	struct TreeBuilder : public Handler
+	{
+		ParserJSON& parser;
+		Node* curr; // node created for the last key, waiting for its value
+
+		inline explicit TreeBuilder(ParserJSON& parser) : parser(parser), curr(parser.m_curr) { }
+		inline ~TreeBuilder() { parser.m_curr = curr; }
+
+		///////////////////////////////////////////////////////////////////////
+		// Node for the next value: the one created for its key in Objects
+		///////////////////////////////////////////////////////////////////////
+		inline Node* ValueNode(DataType type)
+		{
+			auto node = curr;
+			curr = nullptr;
+
+			if (node == nullptr)
+				return parser.NewNode(type);
+
+			node->type = type;
+			return node;
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		inline void OpenContainer(DataType type, const char* rootName, size_t rootNameLen)
+		{
+			auto node = ValueNode(type);
+
+			if (parser.m_root == nullptr)
+			{
+				node->name = StringRef(rootName, rootNameLen);
+				parser.m_root = node;
+			}
+			else
+				parser.m_pendingChildren.push_back(node);
+
+			parser.OpenContainer(node);
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		inline Node* AddValue(DataType type, StringRef data, unsigned char flags = 0)
+		{
+			auto node = ValueNode(type);
+			node->data = data;
+			node->flags |= flags;
+			parser.m_pendingChildren.push_back(node);
+			return node;
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		inline void OnObjectBegin() { OpenContainer(DataType::Object, "__rootObject", 12); }
+		inline void OnArrayBegin()  { OpenContainer(DataType::Array, "__rootArray", 11); }
+		inline void OnObjectEnd()   { parser.CloseContainer(); }
+		inline void OnArrayEnd()    { parser.CloseContainer(); }
+
+		inline void OnKey(const char* p, size_t len, bool escaped)
+		{
+			auto node = parser.NewNode(DataType::Undefined);
+			node->name = parser.MakeString(p, len);
+
+			if (escaped)
+				node->flags |= Node::NAME_ESCAPED;
+
+			curr = node;
+		}
+
+		inline void OnString(const char* p, size_t len, bool escaped)
+		{
+			AddValue(DataType::String, parser.MakeString(p, len), (escaped ? Node::DATA_ESCAPED : 0));
+		}
+
+		inline void OnNumber(const char* p, size_t len, const Number& value)
+		{
+			AddValue(DataType::Number, parser.MakeString(p, len))->SetNumber(value);
+		}
+
+		inline void OnBoolean(bool value) { AddValue(DataType::Boolean, (value ? StringRef("true", 4) : StringRef("false", 5))); }
+		inline void OnNull()              { AddValue(DataType::Null, StringRef("null", 4)); }
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	// Run the structurals at the given offsets of str through the state
+	// machine, which reports what it finds to handler. Returns false once
+	// parsing stops (document done, an error, or a token cut off by the end
+	// of a stream chunk).
+	///////////////////////////////////////////////////////////////////////////
+	template <typename HandlerT>
+	bool ParseStructurals(HandlerT& handler, const char* str, size_t len, const size_t* structurals, size_t count)
+	{
+		// the state machine works on locals, which unlike members can stay
+		// in registers, and hands them back however it returns
+		struct SaveState
+		{
+			ParserJSON* parser;
+			const State& state;
+			const size_t& next;
+
+			inline ~SaveState()
+			{
+				parser->m_state = state;
+				parser->m_next = next;
+			}
+		};
+
+		auto state = m_state;
+		auto next = m_next;
+		SaveState save = { this, state, next };
+
+		auto end = str + len;
+
+		for (size_t k = 0; k < count; ++k)
+		{
+			auto i = structurals[k];
+
+			if (i < next) // inside a token we already consumed
+				continue;
+
+			m_errorOffset = i;
+
+			// handle the character depending on the current parser state
+			switch (state)
+			{
+			///////////////////////////////////////////////////////////////////
+			case State::Root:
+			{
+				if (str[i] == '{')
+				{
+					m_nesting.push_back(DataType::Object);
+					handler.OnObjectBegin();
+					state = State::Key;
+				}
+				else if (str[i] == '[')
+				{
+					m_nesting.push_back(DataType::Array);
+					handler.OnArrayBegin();
+					state = State::Value;
+				}
+				else
+				{
+					m_lastError = ParseError::InvalidRoot;
+					m_lastErrorDesc = "Root not valid JSON Object or Array";
+					return false; // unexpected char
+				}
+
+				break;
+			}
+
+			///////////////////////////////////////////////////////////////////
+			case State::Key:
+			{
+				switch (str[i])
+				{
+				case '}':
+				{
+					if (m_nesting.back() != DataType::Object)
+					{
+						m_lastError = ParseError::OutOfPlaceBrace;
+						m_lastErrorDesc = "Out of place brace";
+						return false;
+					}
+
+					m_nesting.pop_back();
+					handler.OnObjectEnd();
+
+					if (m_nesting.empty()) // root finished
+						state = State::Done;
+					else
+						state = State::CommaOrEnd;
+
+					break;
+				}
+
+				case ']':
+				{
+					if (m_nesting.back() != DataType::Array)
+					{
+						m_lastError = ParseError::OutOfPlaceSquareBracket;
+						m_lastErrorDesc = "Out of place square bracket";
+						return false;
+					}
+
+					m_nesting.pop_back();
+					handler.OnArrayEnd();
+
+					if (m_nesting.empty()) // root finished
+						state = State::Done;
+					else
+						state = State::CommaOrEnd;
+
+					break;
+				}
+
+				case '\"':
+				{
+					StringRef key;
+					bool escaped;
+					auto last = ParseString(&str[i], end, key, escaped);
+
+					if (last == nullptr || last == end) // error or cut off
+						return false;
+
+					handler.OnKey(key.data(), key.size(), escaped);
+					i = size_t(last - str);
+					state = State::KeyValueSeparator;
+					break;
+				}
+
+				default:
+					m_lastError = ParseError::InvalidKey;
+					m_lastErrorDesc = "Key is not String";
+					return false;
+				}
+
+				break;
+			}
+
+			///////////////////////////////////////////////////////////////////
+			case State::KeyValueSeparator:
+			{
+				if (str[i] != ':')
+				{
+					m_lastError = ParseError::MissingKeyValueSeperator;
+					m_lastErrorDesc = "Missing key-value separator";
+					return false;
+				}
+
+				state = State::Value;
+				break;
+			}
+
+			///////////////////////////////////////////////////////////////////
+			case State::Value:
+			{
+				switch (str[i])
+				{
+				case '{':
+				{
+					m_nesting.push_back(DataType::Object);
+					handler.OnObjectBegin();
+					state = State::Key;
+					break;
+				}
+
+				case '[':
+				{
+					m_nesting.push_back(DataType::Array);
+					handler.OnArrayBegin();
+					state = State::Value;
+					break;
+				}
+
+				case '}':
+				{
+					if (m_nesting.back() != DataType::Object)
+					{
+						m_lastError = ParseError::OutOfPlaceBrace;
+						m_lastErrorDesc = "Out of place brace";
+						return false;
+					}
+
+					m_nesting.pop_back();
+					handler.OnObjectEnd();
+
+					if (m_nesting.empty()) // root finished
+						state = State::Done;
+					else
+						state = State::CommaOrEnd;
+
+					break;
+				}
+
+				case ']':
+				{
+					if (m_nesting.back() != DataType::Array)
+					{
+						m_lastError = ParseError::OutOfPlaceSquareBracket;
+						m_lastErrorDesc = "Out of place square bracket";
+						return false;
+					}
+
+					m_nesting.pop_back();
+					handler.OnArrayEnd();
+
+					if (m_nesting.empty()) // root finished
+						state = State::Done;
+					else
+						state = State::CommaOrEnd;
+
+					break;
+				}
+
+				case '\"':
+				{
+					StringRef value;
+					bool escaped;
+					auto last = ParseString(&str[i], end, value, escaped);
+
+					if (last == nullptr || last == end) // error or cut off
+						return false;
+
+					handler.OnString(value.data(), value.size(), escaped);
+					i = size_t(last - str);
+					state = State::CommaOrEnd;
+					break;
+				}
+
+				// handle numbers
+				case '-':
+				case '0': case '1': case '2': case '3': case '4':
+				case '5': case '6': case '7': case '8': case '9':
+				{
+					StringRef value;
+					Number number;
+					auto last = ParseNumber(&str[i], end, value, number);
+
+					if (last == nullptr || last == end) // error or cut off
+						return false;
+
+					i = size_t(last - str);
+					handler.OnNumber(value.data(), value.size(), number);
+					state = State::CommaOrEnd;
+					break;
+				}
+
+				// handle true/false
+				case 't': case 'f':
+				{
+					StringRef value;
+					auto last = ParsePrimitive(&str[i], end, value);
+
+					if (last == nullptr || last == end) // error or cut off
+						return false;
+
+					i = size_t(last - str);
+
+					if (!IsBoolean(value.data(), value.size()))
+					{
+						m_lastError = ParseError::BadFormat;
+						m_lastErrorDesc = "Value not JSON Number, String, Boolean, or Null";
+						return false;
+					}
+
+					handler.OnBoolean(value.size() == 4); // "true"
+					state = State::CommaOrEnd;
+					break;
+				}
+
+				// handle null
+				case 'n':
+				{
+					StringRef value;
+					auto last = ParsePrimitive(&str[i], end, value);
+
+					if (last == nullptr || last == end) // error or cut off
+						return false;
+
+					i = size_t(last - str);
+
+					if (!IsNull(value.data(), value.size()))
+					{
+						m_lastError = ParseError::BadFormat;
+						m_lastErrorDesc = "Value not JSON Number, String, Boolean, or Null";
+						return false;
+					}
+
+					handler.OnNull();
+					state = State::CommaOrEnd;
+					break;
+				}
+
+				default:
+					m_lastError = ParseError::BadFormat;
+					m_lastErrorDesc = "Value not JSON Number, String, Boolean, or Null";
+					return false;
+				}
+
+				break;
+			}
+
+			///////////////////////////////////////////////////////////////////
+			case State::CommaOrEnd:
+			{
+				switch (str[i])
+				{
+				case ',':
+				{
+					if (m_nesting.back() == DataType::Object)
+						state = State::Key;
+					else // parent is array
+						state = State::Value;
+
+					break;
+				}
+
+				case '}':
+				{
+					if (m_nesting.back() != DataType::Object)
+					{
+						m_lastError = ParseError::OutOfPlaceBrace;
+						m_lastErrorDesc = "Out of place brace";
+						return false;
+					}
+
+					m_nesting.pop_back();
+					handler.OnObjectEnd();
+
+					if (m_nesting.empty()) // root finished
+						state = State::Done;
+					else
+						state = State::CommaOrEnd;
+
+					break;
+				}
+
+				case ']':
+				{
+					if (m_nesting.back() != DataType::Array)
+					{
+						m_lastError = ParseError::OutOfPlaceSquareBracket;
+						m_lastErrorDesc = "Out of place square bracket";
+						return false;
+					}
+
+					m_nesting.pop_back();
+					handler.OnArrayEnd();
+
+					if (m_nesting.empty()) // root finished
+						state = State::Done;
+					else
+						state = State::CommaOrEnd;
+
+					break;
+				}
+
+				default:
+					m_lastError = ParseError::MissingComma;
+					m_lastErrorDesc = "Missing comma";
+					return false;
+				}
+
+				break;
+			}
+
+			///////////////////////////////////////////////////////////////////
+			default: // this should never happen
+				m_lastError = ParseError::InternalError;
+				m_lastErrorDesc = "Internal parser state";
+				return false;
+			}
+
+			if (state == State::Done)
+				return false;
+
+			next = (i + 1);
+		}
+
+		return true;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	template <typename HandlerT>
+	void ParseDocument(HandlerT& handler, const char* str, size_t len)
+	{
+		size_t scanned = 0;
+		m_source = str;
+		ParseRange(handler, str, len, scanned, len);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Find the structurals of str from scanned up to scanEnd one window at a
+	// time (keeps the index small and in cache) and parse them. scanEnd must
+	// be a multiple of JSONScanner::BLOCK_SIZE unless it is the end of the
+	// document.
+	///////////////////////////////////////////////////////////////////////////
+	template <typename HandlerT>
+	void ParseRange(HandlerT& handler, const char* str, size_t len, size_t& scanned, size_t scanEnd)
+	{
+		if (m_structurals.size() < STRUCTURAL_WINDOW)
+			m_structurals.resize(STRUCTURAL_WINDOW);
+
+		while (scanned < scanEnd)
+		{
+			auto windowLen = (scanEnd - scanned < STRUCTURAL_WINDOW ? scanEnd - scanned : STRUCTURAL_WINDOW);
+			auto count = m_scanner.Scan(&str[scanned], windowLen, scanned, m_structurals.data());
+			scanned += windowLen;
+
+			// when a token got cut off the rest of this window lies inside
+			// it, so nothing is lost by dropping it
+			if (!ParseStructurals(handler, str, len, m_structurals.data(), count))
+				return;
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	void Reset(size_t reserveNodes, bool inSitu)
+	{
+		// reset everything (all nodes and strings go at once with the arena)
+		m_arena.Reset(reserveNodes * (sizeof(Node) + sizeof(Node*)));
+		m_root = nullptr;
+		m_scanner.Reset();
+		m_file.Close();
+		m_source = nullptr;
+		m_inSitu = inSitu;
+		m_containerStack.clear();
+		m_pendingChildren.clear();
+		m_curr = nullptr;
+		m_nesting.clear();
+		m_state = State::Root;
+		m_next = 0;
+		m_moreInput = false;
+		m_tokenStart = NO_TOKEN;
+		m_tokenScanned = 0;
+		m_streamBuffer.clear();
+		m_streamScanned = 0;
+		m_sourceLineNo = 1;
+		m_sourceCharNo = 1;
+		m_countedOffset = 0;
+		m_countedLines = 0;
+		m_countedLineStart = 0;
+		m_lastError = ParseError::None;
+		m_lastErrorDesc = "No error";
+		m_errorOffset = 0;
+		m_lastErrorLineNo = 1;
+		m_lastErrorCharNo = 1;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	bool OpenFile(const char* path)
+	{
+		if (m_file.Open(path))
+			return true;
+
+		m_lastError = ParseError::FileError;
+		m_lastErrorDesc = std::string("Unable to read file '") + path + "': " + strerror(errno);
+		return false;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Line and char of a byte offset in the current source, which for a
+	// stream only starts where the consumed bytes were dropped
+	///////////////////////////////////////////////////////////////////////////
+	void GetSourcePosition(size_t offset, size_t& line, size_t& column) const
+	{
+		JSONScanner::GetLineColumn(m_source, offset, line, column);
+
+		if (line == 1)
+			column += (m_sourceCharNo - 1);
+
+		line += (m_sourceLineNo - 1);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	void FinishDocument()
+	{
+		if (m_lastError != ParseError::None)
+			GetSourcePosition(m_errorOffset, m_lastErrorLineNo, m_lastErrorCharNo);
+
+		// close anything left open by an error or a truncated document so the
+		// partial tree can still be walked
+		while (!m_containerStack.empty())
+			CloseContainer();
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Whether the token cut off by an earlier chunk ends within the buffered
+	// stream now. Only bytes not looked at before are checked, so a huge
+	// token arriving in many small chunks is still scanned just once more
+	// when it is finally parsed.
+	///////////////////////////////////////////////////////////////////////////
+	bool CutOffTokenEnds(const char* str, size_t len)
+	{
+		auto p = str + m_tokenStart;
+		auto q = p + m_tokenScanned;
+		auto end = str + len;
+
+		if (*p == '\"')
+		{
+			for (;;)
+			{
+				q = JSONScanner::FindStringSpecial(q, end);
+
+				if (q == end)
+					break;
+
+				if (*q == '\\') // skip what's escaped (if it's here yet)
+				{
+					if (end - q < 2)
+						break;
+
+					q += 2;
+				}
+				else if (*q == '\"' || *q == '\b' || *q == '\f' || *q == '\r' || *q == '\n' || *q == '\t')
+					return true; // closing quote, or an error ParseString() reports
+				else
+					++q;
+			}
+		}
+		else
+		{
+			for (; q != end; ++q)
+			{
+				if (IsPrimitiveDelimiter(*q))
+					return true;
+			}
+		}
+
+		m_tokenScanned = size_t(q - p);
+		return false;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Parse whatever has been buffered for a stream so far. Only whole
+	// scanner blocks are scanned until the stream has ended, since the
+	// scanner's state can't be carried over from a partial block.
+	///////////////////////////////////////////////////////////////////////////
+	template <typename HandlerT>
+	void ParseStreamBuffer(HandlerT& handler)
+	{
+		auto str = m_streamBuffer.data();
+		auto len = m_streamBuffer.size();
+		m_source = str;
+
+		// finish the token the last chunk cut off first (its structural has
+		// already been scanned), unless it still isn't complete
+		if (m_tokenStart != NO_TOKEN)
+		{
+			if (m_moreInput && !CutOffTokenEnds(str, len))
+				return;
+
+			auto i = m_tokenStart;
+			m_tokenStart = NO_TOKEN;
+
+			if (!ParseStructurals(handler, str, len, &i, 1))
+				return;
+		}
+
+		auto scanEnd = len;
+
+		if (m_moreInput)
+			scanEnd = m_streamScanned + (len - m_streamScanned) / JSONScanner::BLOCK_SIZE * JSONScanner::BLOCK_SIZE;
+
+		ParseRange(handler, str, len, m_streamScanned, scanEnd);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Drop the stream bytes we're done with: everything before a cut off
+	// token, or else everything which has been scanned.
+	///////////////////////////////////////////////////////////////////////////
+	void CompactStreamBuffer()
+	{
+		auto keep = (m_tokenStart != NO_TOKEN ? m_tokenStart : m_streamScanned);
+
+		if (keep == 0)
+			return;
+
+		size_t line, column;
+		GetSourcePosition(keep, line, column);
+		m_sourceLineNo = line;
+		m_sourceCharNo = column;
+
+		m_streamBuffer.erase(0, keep);
+		m_streamScanned -= keep;
+		m_countedOffset = 0;
+		m_countedLines = 0;
+		m_countedLineStart = 0;
+		m_next = (m_next > keep ? m_next - keep : 0);
+
+		if (m_tokenStart != NO_TOKEN)
+			m_tokenStart -= keep;
+
+		m_source = m_streamBuffer.data();
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Build the tree of the document in str (after Reset()), in parallel if
+	// it's large enough
+	///////////////////////////////////////////////////////////////////////////
+	void ParseTree(const char* str, size_t len)
+	{
+		if (m_executor == nullptr || len < m_parallelMinSize || !ParseTreeParallel(str, len))
+		{
+			TreeBuilder builder(*this);
+			ParseDocument(builder, str, len);
+		}
+
+		FinishDocument();
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Parse a document whose root is an Array in two phases. The first
+	// splits it up between elements (see SplitRootArray()). In the second
+	// the executor parses the slices into parsers of their own at the same
+	// time (see ParseSlice()); their elements are linked under one root and
+	// their arenas taken over. Returns false, having built nothing, if the
+	// document doesn't split up or a slice doesn't parse. The serial parse
+	// which follows then reports the error (and where it is) as always.
+	///////////////////////////////////////////////////////////////////////////
+	bool ParseTreeParallel(const char* str, size_t len)
+	{
+		auto sliceBytes = len / (m_executor->Concurrency() * 4);
+
+		if (sliceBytes < MIN_PARALLEL_SLICE)
+			sliceBytes = MIN_PARALLEL_SLICE;
+
+		std::vector<size_t> splits;
+		auto split = SplitRootArray(str, len, sliceBytes, splits);
+		m_scanner.Reset();
+
+		if (!split || splits.size() < 3)
+			return false;
+
+		auto sliceCount = (splits.size() - 1);
+		std::vector<std::unique_ptr<ParserJSON>> slices(sliceCount);
+		std::vector<char> parsed(sliceCount, 0);
+
+		m_executor->ForEach(sliceCount, [&](size_t s)
+		{
+			slices[s].reset(new ParserJSON);
+			auto& slice = *slices[s];
+			slice.m_inSitu = m_inSitu;
+			slice.m_keyIndexThreshold = m_keyIndexThreshold;
+			parsed[s] = slice.ParseSlice(str, len, (splits[s] + 1), splits[s + 1]);
+		});
+
+		size_t count = 0;
+
+		for (size_t s = 0; s < sliceCount; ++s)
+		{
+			if (!parsed[s])
+				return false;
+
+			count += slices[s]->m_root->children.size();
+		}
+
+		auto root = NewNode(DataType::Array);
+		root->name = StringRef("__rootArray", 11);
+		root->children.ptr = m_arena.AllocateArray<Node*>(count);
+		root->children.count = count;
+
+		auto child = root->children.ptr;
+
+		for (auto& slice : slices)
+		{
+			auto& children = slice->m_root->children;
+			memcpy(child, children.ptr, children.size() * sizeof(Node*));
+			child += children.size();
+			m_arena.Adopt(slice->m_arena);
+		}
+
+		m_root = root;
+		m_source = str;
+		m_state = State::Done;
+		m_next = (splits.back() + 1);
+		m_errorOffset = splits.back();
+		return true;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Find where the root Array of str can be split up, going by nothing but
+	// the structurals and how deeply they nest. splits gets the offset of
+	// the opening bracket, then commas between elements at least sliceBytes
+	// apart, and the closing bracket. Returns false if the root isn't an
+	// Array or never closes.
+	///////////////////////////////////////////////////////////////////////////
+	bool SplitRootArray(const char* str, size_t len, size_t sliceBytes, std::vector<size_t>& splits)
+	{
+		if (m_structurals.size() < STRUCTURAL_WINDOW)
+			m_structurals.resize(STRUCTURAL_WINDOW);
+
+		m_scanner.Reset();
+
+		size_t depth = 0;
+		size_t last = 0; // latest split
+
+		for (size_t scanned = 0; scanned < len; )
+		{
+			auto windowLen = (len - scanned < STRUCTURAL_WINDOW ? len - scanned : STRUCTURAL_WINDOW);
+			auto count = m_scanner.Scan(&str[scanned], windowLen, scanned, m_structurals.data());
+			scanned += windowLen;
+
+			for (size_t k = 0; k < count; ++k)
+			{
+				auto i = m_structurals[k];
+
+				switch (str[i])
+				{
+				case '[':
+				case '{':
+					if (depth == 0)
+					{
+						if (str[i] != '[')
+							return false;
+
+						splits.push_back(i);
+						last = i;
+					}
+
+					++depth;
+					break;
+
+				case ']':
+				case '}':
+					if (depth == 0)
+						return false;
+
+					if (--depth == 0)
+					{
+						splits.push_back(i);
+						return true;
+					}
+
+					break;
+
+				case ',':
+					if (depth == 1 && (i - last) >= sliceBytes)
+					{
+						splits.push_back(i);
+						last = i;
+					}
+
+					break;
+
+				default:
+					if (depth == 0)
+						return false;
+				}
+			}
+		}
+
+		return false;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Parse the elements in [begin, end) of str, which lies inside the root
+	// Array, as if they followed its opening bracket. They end up in the
+	// children of m_root. Returns false on an error, or if the range
+	// doesn't end right after an element.
+	///////////////////////////////////////////////////////////////////////////
+	bool ParseSlice(const char* str, size_t len, size_t begin, size_t end)
+	{
+		m_source = str;
+		m_root = NewNode(DataType::Array);
+		OpenContainer(m_root);
+		m_nesting.push_back(DataType::Array);
+		m_state = State::Value;
+		m_next = begin;
+
+		{
+			TreeBuilder builder(*this);
+			ParseRange(builder, str, len, begin, end);
+		}
+
+		if (m_lastError != ParseError::None || m_state != State::CommaOrEnd || m_nesting.size() != 1)
+			return false;
+
+		CloseContainer();
+		return true;
+	}
+
+public:
+	///////////////////////////////////////////////////////////////////////////
+	// Parse a document, copying all keys and values into the parser so the
+	// source buffer may be released right away.
+	///////////////////////////////////////////////////////////////////////////
+	void Parse(const char* str, size_t reserveNodes = 100)
+	{
+		Reset(reserveNodes, false);
+		ParseTree(str, strlen(str));
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Parse a document without copying: every Node::name and Node::data is a
+	// slice of str. The caller owns str and must keep it alive and unchanged
+	// for as long as the tree is used (until the next Parse call or until
+	// this parser is destroyed). Escapes are left in place; use
+	// Node::GetName() and Node::GetString() to resolve them.
+	///////////////////////////////////////////////////////////////////////////
+	void ParseInSitu(const char* str, size_t reserveNodes = 100)
+	{
+		Reset(reserveNodes, true);
+		ParseTree(str, strlen(str));
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Parse a document without building a tree: everything found is passed
+	// to handler (see Handler) in document order instead, so memory use
+	// doesn't depend on the size of the document. Slices passed to the
+	// handler point into str. GetRoot() returns nullptr afterwards.
+	///////////////////////////////////////////////////////////////////////////
+	template <typename HandlerT>
+	void ParseSAX(const char* str, HandlerT& handler)
+	{
+		Reset(0, true);
+		ParseDocument(handler, str, strlen(str));
+		FinishDocument();
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Parse the file at path. It is mapped into memory (see MappedFile) and
+	// parsed in-situ, so besides the file's own pages, which the OS can drop
+	// and reread as it likes, only the tree takes up memory. The mapping
+	// stays until the next Parse call or until this parser is destroyed. If
+	// the file can't be read the error is ParseError::FileError.
+	///////////////////////////////////////////////////////////////////////////
+	void ParseFile(const char* path, size_t reserveNodes = 100)
+	{
+		Reset(reserveNodes, true);
+
+		if (OpenFile(path))
+			ParseTree(m_file.Data(), m_file.Size());
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// ParseFile() for a Handler as with ParseSAX(). The file is released
+	// again before returning.
+	///////////////////////////////////////////////////////////////////////////
+	template <typename HandlerT>
+	void ParseFileSAX(const char* path, HandlerT& handler)
+	{
+		Reset(0, true);
+
+		if (OpenFile(path))
+		{
+			ParseDocument(handler, m_file.Data(), m_file.Size());
+			FinishDocument();
+		}
+
+		m_file.Close();
+		m_source = nullptr;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Incremental parsing of a document which arrives in pieces (from a pipe
+	// or socket, say):
+	//
+	//     parser.BeginStream();
+	//     while ((n = read(fd, buf, sizeof(buf))) > 0)
+	//         parser.ParseChunk(buf, n);
+	//     if (!parser.EndStream())
+	//         parser.PrintLastError();
+	//
+	// Chunks may be split anywhere, even inside a token or escape, and don't
+	// need to be NUL terminated or kept alive; keys and values are copied.
+	// Besides the tree itself the parser holds on to the open containers and
+	// at most the largest token plus one chunk of input. Pass a Handler to
+	// ParseChunk() and EndStream() to skip the tree as with ParseSAX().
+	///////////////////////////////////////////////////////////////////////////
+	void BeginStream(size_t reserveNodes = 100)
+	{
+		Reset(reserveNodes, false);
+		m_moreInput = true;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Feed the next piece of the document. Returns false once parsing has
+	// failed (the rest of the stream can be skipped then); a document is only
+	// known to be complete and valid after EndStream().
+	///////////////////////////////////////////////////////////////////////////
+	template <typename HandlerT>
+	bool ParseChunk(const char* data, size_t len, HandlerT& handler)
+	{
+		assert(m_moreInput && "ParseChunk() called without BeginStream()");
+
+		// trailing data after the root is ignored like Parse() does
+		if (m_lastError != ParseError::None || m_state == State::Done)
+			return (m_lastError == ParseError::None);
+
+		m_streamBuffer.append(data, len);
+		ParseStreamBuffer(handler);
+
+		if (m_lastError != ParseError::None)
+		{
+			FinishDocument();
+			return false;
+		}
+
+		CompactStreamBuffer();
+		return true;
+	}
+
+	bool ParseChunk(const char* data, size_t len)
+	{
+		TreeBuilder builder(*this);
+		return ParseChunk(data, len, builder);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Parse what is left after the last chunk. Returns true if a complete
+	// document was read, otherwise GetLastError() tells what went wrong.
+	///////////////////////////////////////////////////////////////////////////
+	template <typename HandlerT>
+	bool EndStream(HandlerT& handler)
+	{
+		if (m_lastError == ParseError::None && m_state != State::Done)
+		{
+			m_moreInput = false;
+			ParseStreamBuffer(handler);
+
+			if (m_lastError == ParseError::None && m_state != State::Done)
+			{
+				m_lastError = ParseError::UnexpectedEnd;
+				m_lastErrorDesc = "Unexpected end of JSON stream";
+				m_errorOffset = m_streamBuffer.size();
+			}
+
+			FinishDocument();
+		}
+
+		m_moreInput = false;
+		m_streamBuffer.clear();
+		m_streamBuffer.shrink_to_fit();
+		m_source = nullptr;
+
+		return (m_lastError == ParseError::None);
+	}
+
+	bool EndStream()
+	{
+		TreeBuilder builder(*this);
+		return EndStream(builder);
+	}
+};
@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2015-2016 Christopher D. Granz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+// Checks that floats and doubles come back bit for bit: from FloatFormat
+// and through JSONWrite() and both kinds of JSONLoad(). Exits with 1 if
+// any don't.
+
+#include "Serializer.hpp"
+#include "SerializerJSON.hpp"
+#include "FloatFormat.hpp"
+
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+struct Sample { std::vector<double> d; std::vector<float> f; double x; float y; };
+
+static size_t g_checked = 0;
+static size_t g_failed = 0;
+
+///////////////////////////////////////////////////////////////////////////////
+template <typename T>
+static bool SameBits(T a, T b)
+{
+	return (memcmp(&a, &b, sizeof(T)) == 0);
+}
+
+static void Check(bool ok, const char* what, double value)
+{
+	++g_checked;
+
+	if (ok)
+		return;
+
+	if (++g_failed <= 20)
+		printf("FAILED: %s for %.17g\n", what, value);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// FloatFormat::Format() and back
+///////////////////////////////////////////////////////////////////////////////
+static void CheckFormat(double value)
+{
+	char buf[FloatFormat::MAX_LENGTH + 1];
+	buf[FloatFormat::Format(value, buf)] = '\0';
+	Check(SameBits(FloatFormat::ParseDouble(buf), value), "double Format/ParseDouble", value);
+}
+
+static void CheckFormat(float value)
+{
+	char buf[FloatFormat::MAX_LENGTH + 1];
+	buf[FloatFormat::Format(value, buf)] = '\0';
+	Check(SameBits(FloatFormat::ParseFloat(buf), value), "float Format/ParseFloat", value);
+}
+
+// finite values of random bit patterns
+static double RandomDouble(std::mt19937_64& rng)
+{
+	for (;;)
+	{
+		uint64_t bits = rng();
+		double value;
+		memcpy(&value, &bits, sizeof(value));
+
+		if (std::isfinite(value))
+			return value;
+	}
+}
+
+static float RandomFloat(std::mt19937_64& rng)
+{
+	for (;;)
+	{
+		uint32_t bits = uint32_t(rng());
+		float value;
+		memcpy(&value, &bits, sizeof(value));
+
+		if (std::isfinite(value))
+			return value;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main()
+{
+	std::mt19937_64 rng(20161016);
+
+	const double doubles[] = {
+		0.0, -0.0, 1.0, -1.0, 0.1, 1.0 / 3, 5e-324, -5e-324, 2.2250738585072009e-308,
+		DBL_MIN, -DBL_MIN, DBL_MAX, -DBL_MAX, DBL_EPSILON, 1e15, 1e16, 123456789012345680.0, 9007199254740993.0 };
+	const float floats[] = {
+		0.0f, -0.0f, 1.0f, -1.0f, 0.1f, 1.0f / 3, 1.4e-45f, -1.4e-45f, 1.1754942e-38f,
+		FLT_MIN, -FLT_MIN, FLT_MAX, -FLT_MAX, FLT_EPSILON, 16777217.0f, 7.038531e-26f, -7.038531e-26f };
+
+	for (auto d : doubles)
+		CheckFormat(d);
+
+	for (auto f : floats)
+		CheckFormat(f);
+
+	// subnormals
+	for (int i = 0; i < 100000; ++i)
+	{
+		uint64_t dbits = (rng() & ((uint64_t(1) << 52) - 1)) | (uint64_t(i & 1) << 63);
+		uint32_t fbits = (uint32_t(rng()) & ((uint32_t(1) << 23) - 1)) | (uint32_t(i & 1) << 31);
+		double d;
+		float f;
+		memcpy(&d, &dbits, sizeof(d));
+		memcpy(&f, &fbits, sizeof(f));
+		CheckFormat(d);
+		CheckFormat(f);
+	}
+
+	for (int i = 0; i < 1000000; ++i)
+	{
+		CheckFormat(RandomDouble(rng));
+		CheckFormat(RandomFloat(rng));
+	}
+
+	SerializerJSON serializer;
+	serializer.SetDiagnosticSink(nullptr);
+	SERIALIZER_REGISTER_TYPE(serializer, std::vector<double>, 0);
+	SERIALIZER_REGISTER_TYPE(serializer, std::vector<float>, 0);
+	SERIALIZER_REGISTER_TYPE(serializer, Sample, 0);
+	SERIALIZER_REGISTER_TYPE_MEMBER(serializer, Sample, d, 0);
+	SERIALIZER_REGISTER_TYPE_MEMBER(serializer, Sample, f, 0);
+	SERIALIZER_REGISTER_TYPE_MEMBER(serializer, Sample, x, 0);
+	SERIALIZER_REGISTER_TYPE_MEMBER(serializer, Sample, y, 0);
+
+	// the double nearest this lies halfway between two floats, so rounding
+	// it to a double first and then to a float picks the wrong one
+	// (SerializerJSON's ToFloat() reads such numbers again as a float)
+	for (auto text : { "7.038531e-26", "-7.038531e-26" })
+	{
+		auto expected = FloatFormat::ParseFloat(text);
+		Check(!SameBits(float(FloatFormat::ParseDouble(text)), expected), "double rounding case", expected);
+
+		std::string doc = std::string("{ \"y\": ") + text + ", \"f\": [ " + text + " ] }";
+		ParserJSON parser;
+		parser.Parse(doc.c_str());
+
+		Sample tree = Sample(), sax = Sample();
+		serializer.JSONLoad(&tree, parser.GetRoot());
+		serializer.JSONLoad(&sax, doc.c_str());
+		Check(SameBits(tree.y, expected) && tree.f.size() == 1 && SameBits(tree.f[0], expected), "ToFloat (tree)", expected);
+		Check(SameBits(sax.y, expected) && sax.f.size() == 1 && SameBits(sax.f[0], expected), "ToFloat (SAX)", expected);
+	}
+
+	// JSONWrite() and back through the Node tree and straight from the text
+	for (int round = 0; round < 20; ++round)
+	{
+		Sample sample;
+		sample.x = RandomDouble(rng);
+		sample.y = RandomFloat(rng);
+
+		for (int i = 0; i < 1000; ++i)
+		{
+			sample.d.push_back(RandomDouble(rng));
+			sample.f.push_back(RandomFloat(rng));
+		}
+
+		sample.d.push_back(5e-324);
+		sample.d.push_back(-DBL_MAX);
+		sample.f.push_back(1.4e-45f);
+		sample.f.push_back(-FLT_MAX);
+		sample.f.push_back(7.038531e-26f);
+
+		auto doc = serializer.JSONWriteString(&sample);
+		ParserJSON parser;
+		parser.Parse(doc.c_str());
+
+		Sample tree = Sample(), sax = Sample();
+		serializer.JSONLoad(&tree, parser.GetRoot());
+		serializer.JSONLoad(&sax, doc.c_str());
+
+		for (auto loaded : { &tree, &sax })
+		{
+			auto what = (loaded == &tree ? "JSONWrite/JSONLoad (tree)" : "JSONWrite/JSONLoad (SAX)");
+			bool same = SameBits(loaded->x, sample.x) && SameBits(loaded->y, sample.y)
+				&& loaded->d.size() == sample.d.size() && loaded->f.size() == sample.f.size();
+
+			for (size_t i = 0; same && i < sample.d.size(); ++i)
+				same = SameBits(loaded->d[i], sample.d[i]);
+
+			for (size_t i = 0; same && i < sample.f.size(); ++i)
+				same = SameBits(loaded->f[i], sample.f[i]);
+
+			Check(same, what, sample.x);
+		}
+	}
+
+	printf("%zu checked, %zu failed\n", g_checked, g_failed);
+	return (g_failed == 0 ? 0 : 1);
+}
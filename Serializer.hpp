@@ -1,685 +1,1964 @@
-/*
- * SerializerCpp
- * Copyright (c) 2015-2016 Christopher D. Granz
- *
- * Permission is hereby granted, free of charge, to any person obtaining a
- * copy of this software and associated documentation files (the "Software"),
- * to deal in the Software without restriction, including without limitation
- * the rights to use, copy, modify, merge, publish, distribute, sublicense,
- * and/or sell copies of the Software, and to permit persons to whom the
- * Software is furnished to do so, subject to the following conditions:
- *
- * The above copyright notice and this permission notice shall be included in
- * all copies or substantial portions of the Software.
- *
- * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
- * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
- * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
- * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
- * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
- * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
- * IN THE SOFTWARE.
- */
-
-#pragma once
-
-#include <type_traits>
-#include <vector>
-#include <string>
-#include <utility>
-#include <map>
-#include <unordered_map>
-
-#include <cstdio>
-#include <cassert>
-#include <cstdint>
-#include <cstddef>
-
-namespace RTTI {
-
-///////////////////////////////////////////////////////////////////////////////
-template <typename T> struct TypeCounter { static int NextTypeID; };
-template <typename T> int TypeCounter<T>::NextTypeID(0);
-
-///////////////////////////////////////////////////////////////////////////////
-/// Helper class which stores type info and increments global counters.
-///////////////////////////////////////////////////////////////////////////////
-struct TypeInfo
-{
-	const int TypeID; //< unique type ID
-	inline TypeInfo(int& counter) : TypeID(counter) { ++counter; }
-};
-
-///////////////////////////////////////////////////////////////////////////////
-template < typename D, typename B >
-struct Base : public B
-{
-	static const TypeInfo RTTI;
-	Base() : B(RTTI.TypeID) { }
-	virtual ~Base() { }
-};
-
-template < typename D, typename B >
-const TypeInfo Base< D, B >::RTTI(TypeCounter<B>::NextTypeID);
-
-///////////////////////////////////////////////////////////////////////////////
-/// This is a simple type wrapper which allows for passing and storing type
-/// ID from template functions to non-template functions or store in generic
-/// data structures.
-///////////////////////////////////////////////////////////////////////////////
-struct WrapperBase
-{
-	const int TypeID;
-	inline explicit WrapperBase(int typeID) : TypeID(typeID) { }
-	inline virtual ~WrapperBase() { }
-};
-
-template <typename T> class Wrapper final
-	: public Base< Wrapper<T>, WrapperBase >
-{ };
-
-} // namespace RTTI
-
-///////////////////////////////////////////////////////////////////////////////
-class Serializer
-{
-protected:
-	///////////////////////////////////////////////////////////////////////////
-	// Helper template and base type when dealing with vector member types
-	///////////////////////////////////////////////////////////////////////////
-	struct VectorTypeDispatcherBase
-	{
-		inline virtual ~VectorTypeDispatcherBase() { }
-		virtual size_t size(const void* obj) const = 0;
-		virtual const unsigned char* base(const void* obj) const = 0;
-		virtual unsigned char* base(void* obj) const = 0;
-		virtual void reserve(void* obj, size_t s) const = 0;
-		virtual void resize(void* obj, size_t s) const = 0;
-	};
-
-	///////////////////////////////////////////////////////////////////////////
-	template<typename T>
-	struct VectorTypeDispatcher : public VectorTypeDispatcherBase
-	{
-		inline virtual ~VectorTypeDispatcher() { }
-
-		inline virtual size_t size(const void* obj) const
-		{
-			assert(obj != nullptr);
-			return static_cast<const std::vector<T>*>(obj)->size();
-		}
-
-		inline virtual const unsigned char* base(const void* obj) const
-		{
-			assert(obj != nullptr);
-			return (const unsigned char*)&(*(static_cast<const std::vector<T>*>(obj)))[0];
-		}
-
-		inline virtual unsigned char* base(void* obj) const
-		{
-			assert(obj != nullptr);
-			return (unsigned char*)&(*(static_cast<std::vector<T>*>(obj)))[0];
-		}
-
-		inline virtual void reserve(void* obj, size_t s) const
-		{
-			assert(obj != nullptr);
-			static_cast<std::vector<T>*>(obj)->reserve(s);
-		}
-
-		inline virtual void resize(void* obj, size_t s) const
-		{
-			assert(obj != nullptr);
-			static_cast<std::vector<T>*>(obj)->resize(s);
-		}
-	};
-
-	///////////////////////////////////////////////////////////////////////////
-	// enum definition data
-	///////////////////////////////////////////////////////////////////////////
-	struct EnumDefData
-	{
-		std::string name;
-		int typeID;
-		std::unordered_map<std::string, int> nameKeyMembers;  // map of defined enum name-value pairs
-		std::unordered_map<int, std::string> valueKeyMembers; // map of defined enum value-name pairs (so find by value)
-	};
-
-public:
-	///////////////////////////////////////////////////////////////////////////
-	static const unsigned int MAX_NESTED_DEPTH = 25;
-
-	///////////////////////////////////////////////////////////////////////////
-	enum class ComplexType
-	{
-		None = 0,
-		Enum,
-		Struct,
-		Vector,
-	};
-
-	///////////////////////////////////////////////////////////////////////////
-	static const uint TEXT_EXPORT_NO_NAMES = (1 << 0);
-	static const uint TEXT_EXPORT_SINGLE_LINE = (1 << 1);
-	static const uint TEXT_EXPORT_MINIMAL = (1 << 2);
-
-	using AttribFlags = unsigned int;
-
-	///////////////////////////////////////////////////////////////////////////
-	// Data for one struct or vector member
-	///////////////////////////////////////////////////////////////////////////
-	struct MemberData
-	{
-		std::string name;  // name for loading and writing
-
-		size_t byteOffset; // offset inside the structure in bytes
-		int typeID;        // member type from RTTI::Wrapper<T>::RTTI.TypeID
-		size_t typeSize;   // size in bytes of the member
-
-		ComplexType complexType;                    // ComplexType::None if this is a primitive member
-		std::vector<MemberData*> members;           // data for sub-members if this is not a primitive member
-		VectorTypeDispatcherBase* vectorDispatcher; // only used for vectors
-
-		AttribFlags attribFlags;                    // attributes for this member
-
-		///////////////////////////////////////////////////////////////////////
-		inline MemberData()
-			:
-			name("NO_NAME"),
-			byteOffset(0),
-			typeID(-1),
-			typeSize(0),
-			complexType(ComplexType::None),
-			vectorDispatcher(nullptr),
-			attribFlags(0)
-		{ }
-
-		///////////////////////////////////////////////////////////////////////
-		inline MemberData(
-			const char* name,
-			size_t byteOffset,
-			int typeID,
-			size_t typeSize,
-			ComplexType complexType,
-			VectorTypeDispatcherBase* vectorDispatcher,
-			AttribFlags attribFlags)
-			:
-			name(name),
-			byteOffset(byteOffset),
-			typeID(typeID),
-			typeSize(typeSize),
-			complexType(complexType),
-			vectorDispatcher(vectorDispatcher),
-			attribFlags(attribFlags)
-		{ }
-
-		///////////////////////////////////////////////////////////////////////
-		inline MemberData(const MemberData& rhs)
-			:
-			name(rhs.name),
-			byteOffset(rhs.byteOffset),
-			typeID(rhs.typeID),
-			typeSize(rhs.typeSize),
-			complexType(rhs.complexType),
-			vectorDispatcher(rhs.vectorDispatcher),
-			attribFlags(rhs.attribFlags)
-		{
-			for (auto& m : rhs.members)
-			{
-				assert(m != nullptr);
-				members.push_back(new MemberData(*m));
-			}
-		}
-
-		///////////////////////////////////////////////////////////////////////
-		inline MemberData& operator=(const MemberData& rhs)
-		{
-			name = rhs.name;
-			byteOffset = rhs.byteOffset;
-			typeID = rhs.typeID;
-			typeSize = rhs.typeSize;
-			complexType = rhs.complexType;
-			vectorDispatcher = rhs.vectorDispatcher;
-			attribFlags = rhs.attribFlags;
-
-			for (auto& m : rhs.members)
-			{
-				assert(m != nullptr);
-				members.push_back(new MemberData(*m));
-			}
-
-			return *this;
-		}
-
-		///////////////////////////////////////////////////////////////////////
-		inline ~MemberData()
-		{
-			for (auto& m : members)
-			{
-				assert(m != nullptr);
-				delete m;
-			}
-		}
-	};
-
-	///////////////////////////////////////////////////////////////////////////
-	// Status information used during/after loading
-	///////////////////////////////////////////////////////////////////////////
-	enum class LoadStatus
-	{
-		NotYetLoaded = 0,
-		Loaded,
-		Missing,
-		BadFormat,
-		MaxNestDepthExceeded
-	};
-
-	///////////////////////////////////////////////////////////////////////////
-	class LoadStatusInfo
-	{
-	public:
-		LoadStatus m_loadStatus;
-		LoadStatusInfo* m_subInfo;
-		size_t m_subInfoSize;
-
-		inline LoadStatusInfo(LoadStatus loadStatus)
-			:
-			m_loadStatus(loadStatus),
-			m_subInfo(nullptr),
-			m_subInfoSize(0)
-		{ }
-
-		inline LoadStatusInfo()
-			:
-			m_loadStatus(LoadStatus::NotYetLoaded),
-			m_subInfo(nullptr),
-			m_subInfoSize(0)
-		{ }
-
-		LoadStatusInfo(const LoadStatusInfo& rhs) = delete;
-		LoadStatusInfo& operator=(const LoadStatusInfo& rhs) = delete;
-
-		inline LoadStatusInfo(LoadStatusInfo&& rhs)
-			:
-			m_loadStatus(rhs.m_loadStatus),
-			m_subInfo(rhs.m_subInfo),
-			m_subInfoSize(rhs.m_subInfoSize)
-		{
-			rhs.m_loadStatus = LoadStatus::NotYetLoaded;
-			rhs.m_subInfo = nullptr;
-			rhs.m_subInfoSize = 0;
-		}
-
-		inline LoadStatusInfo& operator=(LoadStatusInfo&& rhs)
-		{
-			m_loadStatus = rhs.m_loadStatus;
-			m_subInfo = rhs.m_subInfo;
-			m_subInfoSize = rhs.m_subInfoSize;
-			rhs.m_loadStatus = LoadStatus::NotYetLoaded;
-			rhs.m_subInfo = nullptr;
-			rhs.m_subInfoSize = 0;
-			return *this;
-		}
-
-		inline ~LoadStatusInfo()
-		{
-			if (m_subInfo != nullptr)
-				delete[] m_subInfo;
-		}
-
-		inline LoadStatus Status() const { return m_loadStatus; }
-
-		inline const LoadStatusInfo& SubInfo(size_t i) const
-		{
-			assert(i < m_subInfoSize);
-			return m_subInfo[i];
-		}
-	};
-
-protected:
-	///////////////////////////////////////////////////////////////////////////
-	std::unordered_map<int, MemberData> m_structDefs; // table of defined structures
-	std::unordered_map<int, EnumDefData> m_enumDefs;  // table of defined enums
-
-	std::vector<VectorTypeDispatcherBase*> m_vectorDispatchers;
-
-protected:
-	///////////////////////////////////////////////////////////////////////////
-	template <typename T>
-	struct ComplexTypeHelper
-	{
-		///////////////////////////////////////////////////////////////////////
-		static inline bool BuildMember(Serializer& sds, MemberData& m, const char* name, size_t offset, AttribFlags flags)
-		{
-			assert(name != nullptr);
-			assert(name[0] != '\0');
-
-			auto id = RTTI::Wrapper<T>::RTTI.TypeID;
-
-			m.name = name;
-			m.byteOffset = offset;
-			m.typeID = id;
-			m.typeSize = sizeof(T);
-			m.vectorDispatcher = nullptr;
-			m.attribFlags = flags;
-
-			// NOTE: we treat strings as primitives, so exclude them here
-			if (std::is_class<T>::value && id != RTTI::Wrapper<std::string>::RTTI.TypeID)
-			{
-				assert(sds.m_structDefs.find(id) != sds.m_structDefs.end());
-				m.complexType = ComplexType::Struct;
-				m.attribFlags |= sds.m_structDefs[id].attribFlags;
-
-				for (auto& subm : sds.m_structDefs[id].members)
-				{
-					assert(subm != nullptr);
-					m.members.push_back(new MemberData(*subm));
-				}
-
-				return true;
-			}
-
-			if (std::is_enum<T>::value)
-			{
-				assert(sds.m_enumDefs.find(id) != sds.m_enumDefs.end());
-				m.complexType = ComplexType::Enum;
-				//m.attribFlags |= sds.m_enumDefs[childID].attribFlags;
-				return true;
-			}
-
-			// otherwise it is a primitive child member
-			m.complexType = ComplexType::None;
-			return true;
-		}
-
-		///////////////////////////////////////////////////////////////////////
-		static inline bool BuildChildMember(Serializer& sds, MemberData& parent, const char* name, size_t offset, AttribFlags flags)
-		{
-			assert(offset < parent.typeSize
-				&& "Byte offset into data structure is beyond the end of known size--data corruption likely!");
-#ifndef NDEBUG
-			// check that the member doesn't already exist
-			assert(name != nullptr);
-			assert(name[0] != '\0');
-
-			for (auto m : parent.members)
-			{
-				assert(m != nullptr);
-
-				if (m->name.compare(name) == 0)
-				{
-					assert(false && "Struct member with given name already exists in registry");
-					return false;
-				}
-			}
-#endif
-			parent.members.push_back(new MemberData);
-			auto m = parent.members.back();
-			return BuildMember(sds, *m, name, offset, flags);
-		}
-	};
-
-	///////////////////////////////////////////////////////////////////////////
-	/// Specialized for vector<T> types 
-	///////////////////////////////////////////////////////////////////////////
-	template <typename ElementT>
-	struct ComplexTypeHelper< std::vector<ElementT> >
-	{
-		///////////////////////////////////////////////////////////////////////
-		static inline bool BuildMember(Serializer& sds, MemberData& m, const char* name, size_t offset, AttribFlags flags)
-		{
-			assert(name != nullptr);
-			assert(name[0] != '\0');
-
-			auto id = RTTI::Wrapper<ElementT>::RTTI.TypeID;
-
-			// FIXME: we really don't need to add a vector dispatcher object for the same vector<T> each time
-			sds.m_vectorDispatchers.push_back(new VectorTypeDispatcher<ElementT>);
-
-			m.name = name;
-			m.byteOffset = offset;
-			m.typeID = id;
-			m.typeSize = sizeof(ElementT);
-			m.complexType = ComplexType::Vector;
-			m.vectorDispatcher = sds.m_vectorDispatchers.back();
-			m.attribFlags = flags;
-
-			/*
-			if (sds.m_structDefs.find(id) != sds.m_structDefs.end())
-			{
-				m.attribFlags |= sds.m_structDefs[id].attribFlags;
-
-				for (auto& subm : sds.m_structDefs[id].members)
-				{
-					assert(subm != nullptr);
-					m.members.push_back(HALCYON_NEW MemberData(*subm));
-				}
-			}
-			*/
-
-			return ComplexTypeHelper< ElementT >::BuildChildMember(sds, m, "vector<T>_subtype", 0, flags);
-		}
-
-		///////////////////////////////////////////////////////////////////////
-		static inline bool BuildChildMember(Serializer& sds, MemberData& parent, const char* name, size_t offset, AttribFlags flags)
-		{
-			assert(offset < parent.typeSize
-				&& "Byte offset into data structure is beyond the end of known size--data corruption likely!");
-
-			parent.members.push_back(new MemberData);
-			auto m = parent.members.back();
-			return BuildMember(sds, *m, name, offset, flags);
-		}
-	};
-
-	///////////////////////////////////////////////////////////////////////////
-	inline bool IsPrimitive(int typeID)
-	{
-		if (typeID == RTTI::Wrapper<char>::RTTI.TypeID
-			|| typeID == RTTI::Wrapper<unsigned char>::RTTI.TypeID
-			|| typeID == RTTI::Wrapper<int16_t>::RTTI.TypeID
-			|| typeID == RTTI::Wrapper<uint16_t>::RTTI.TypeID
-			|| typeID == RTTI::Wrapper<int32_t>::RTTI.TypeID
-			|| typeID == RTTI::Wrapper<uint32_t>::RTTI.TypeID
-			|| typeID == RTTI::Wrapper<int64_t>::RTTI.TypeID
-			|| typeID == RTTI::Wrapper<uint64_t>::RTTI.TypeID
-			|| typeID == RTTI::Wrapper<float>::RTTI.TypeID
-			|| typeID == RTTI::Wrapper<double>::RTTI.TypeID
-			|| typeID == RTTI::Wrapper<bool>::RTTI.TypeID
-			|| typeID == RTTI::Wrapper<std::string>::RTTI.TypeID)
-			return true;
-
-		return false;
-	}
-
-	///////////////////////////////////////////////////////////////////////////
-	inline void PrintPrimitive(FILE* fp, const unsigned char* data, int typeID)
-	{
-		assert(fp != nullptr);
-		assert(data != nullptr);
-
-		if (typeID == RTTI::Wrapper<bool>::RTTI.TypeID)
-			fprintf(fp, "'%s'", *((const bool*)data) ? "true" : "false");
-		else if (typeID == RTTI::Wrapper<char>::RTTI.TypeID)
-			fprintf(fp, "'%c'", *((const char*)data));
-		else if (typeID == RTTI::Wrapper<unsigned char>::RTTI.TypeID)
-			fprintf(fp, "'%c'", *((const unsigned char*)data));
-		else if (typeID == RTTI::Wrapper<int16_t>::RTTI.TypeID)
-			fprintf(fp, "%d", *((int16_t*)data));
-		else if (typeID == RTTI::Wrapper<uint16_t>::RTTI.TypeID)
-			fprintf(fp, "%u", *((const uint16_t*)data));
-		else if (typeID == RTTI::Wrapper<int32_t>::RTTI.TypeID)
-			fprintf(fp, "%d", *((const int32_t*)data));
-		else if (typeID == RTTI::Wrapper<uint32_t>::RTTI.TypeID)
-			fprintf(fp, "%u", *((const uint32_t*)data));
-		else if (typeID == RTTI::Wrapper<int64_t>::RTTI.TypeID)
-			fprintf(fp, "%ld", (long int)*((const int64_t*)data));
-		else if (typeID == RTTI::Wrapper<uint64_t>::RTTI.TypeID)
-			fprintf(fp, "%lu", (long unsigned)*((const uint64_t*)data));
-		else if (typeID == RTTI::Wrapper<float>::RTTI.TypeID)
-			fprintf(fp, "%f", *((const float*)data));
-		else if (typeID == RTTI::Wrapper<double>::RTTI.TypeID)
-			fprintf(fp, "%f", *((const double*)data));
-		else if (typeID == RTTI::Wrapper<std::string>::RTTI.TypeID)
-			fprintf(fp, "\"%s\"", ((const std::string*)data)->c_str());
-		else
-			assert(false && "Unknown primitive type");
-	}
-
-public:
-	///////////////////////////////////////////////////////////////////////////
-	inline Serializer() { }
-
-	///////////////////////////////////////////////////////////////////////////
-	Serializer(const Serializer& rhs) = delete;
-	Serializer& operator=(const Serializer& rhs) = delete;
-
-	///////////////////////////////////////////////////////////////////////////
-	inline ~Serializer()
-	{
-		Clear();
-	}
-
-	///////////////////////////////////////////////////////////////////////////
-	inline void Clear()
-	{
-		for (auto& vd : m_vectorDispatchers)
-			delete vd;
-
-		m_vectorDispatchers.clear();
-		m_enumDefs.clear();
-		m_structDefs.clear();
-	}
-
-	///////////////////////////////////////////////////////////////////////////
-	template <typename T>
-	inline int RegisterType(const char* name, AttribFlags flags = 0)
-	{
-		static_assert(std::is_class<T>::value == true
-			|| std::is_enum<T>::value == true,
-			"Type should be a class or enum type (not a primitive)");
-		static_assert(std::is_enum<T>::value == false
-			|| sizeof(T) == sizeof(int),
-			"Non-integer enum types are not supported");
-		static_assert(std::is_pointer<T>::value == false,
-			"Type should not be a pointer type");
-		//static_assert(std::is_standard_layout<T>::value == true
-		//	&& std::is_trivial<StructT>::value == true,
-		//	"Only POD types are supported");
-
-		assert(name != nullptr);
-		assert(name[0] != '\0');
-
-		int id = RTTI::Wrapper<T>::RTTI.TypeID;
-
-		if (std::is_enum<T>::value == true)
-		{
-			assert(m_enumDefs.find(id) == m_enumDefs.end()
-				&& "An enum type with the given name has already been added");
-
-			auto& s = m_enumDefs[id];
-			s.name = name;
-			s.typeID = id;
-
-			return id;
-		}
-
-		// otherwise it is struct of vector type
-		assert(m_structDefs.find(id) == m_structDefs.end()
-			&& "A type with the given name has already been added");
-
-		auto& s = m_structDefs[id];
-		ComplexTypeHelper< T >::BuildMember(*this, s, name, 0, flags);
-		return id;
-	}
-
-	///////////////////////////////////////////////////////////////////////////
-	template <typename T>
-	inline void UnregisterType()
-	{
-		static_assert(std::is_class<T>::value == true
-			|| std::is_enum<T>::value == true,
-			"Type should be a class or enum type (not a primitive)");
-		static_assert(std::is_pointer<T>::value == false,
-			"T should not be a pointer type");
-
-		int id = RTTI::Wrapper<T>::RTTI.TypeID;
-
-		// handle enums
-		if (std::is_enum<T>::value == true)
-		{
-			assert(m_enumDefs.find(id) != m_enumDefs.end());
-			m_enumDefs.erase(id);
-			return;
-		}
-
-		// otherwise it is a struct or vector type
-		assert(m_structDefs.find(id) != m_structDefs.end());
-		m_structDefs.erase(id);
-	}
-
-	///////////////////////////////////////////////////////////////////////////
-	inline void UnregisterAllTypes()
-	{
-		m_enumDefs.clear();
-		m_structDefs.clear();
-
-		for (auto& vd : m_vectorDispatchers)
-			delete vd;
-
-		m_vectorDispatchers.clear();
-	}
-
-	///////////////////////////////////////////////////////////////////////////
-	template <typename EnumT>
-	inline bool RegisterTypeMember(const char* name, EnumT value, AttribFlags flags = 0)
-	{
-		static_assert(std::is_enum<EnumT>::value == true,
-			"Type should be an enum type");
-		static_assert(sizeof(EnumT) == sizeof(int),
-			"Non-integer enum types are not supported");
-
-		int id = RTTI::Wrapper<EnumT>::RTTI.TypeID;
-		assert(m_enumDefs.find(id) != m_enumDefs.end());
-
-		assert(name != nullptr);
-		assert(name[0] != '\0');
-
-		auto it = m_enumDefs.find(id);
-
-		if (it == m_enumDefs.end()) // couldn't find the enum
-		{
-			assert(false && "Couldn't find enum to add member to");
-			return false;
-		}
-
-		auto& e = m_enumDefs[id];
-		e.nameKeyMembers.insert(std::pair<std::string, int>(name, (int)value));
-		e.valueKeyMembers.insert(std::pair<int, std::string>((int)value, name));
-
-		return true;
-	}
-
-	///////////////////////////////////////////////////////////////////////////
-	template <typename ParentStructT, typename T>
-	inline bool RegisterTypeMember(const char* name, size_t offset, AttribFlags flags = 0)
-	{
-		static_assert(std::is_class<ParentStructT>::value == true,
-			"Parent type should be a struct type");
-		auto parentID = RTTI::Wrapper<ParentStructT>::RTTI.TypeID;
-		assert(m_structDefs.find(parentID) != m_structDefs.end());
-		auto& parent = m_structDefs[parentID];
-		return ComplexTypeHelper< T >::BuildChildMember(*this, parent, name, offset, flags);
-	}
-};
-
-///////////////////////////////////////////////////////////////////////////////
-// convenience macros for registering new types
-///////////////////////////////////////////////////////////////////////////////
-#define SERIALIZER_REGISTER_TYPE(collection, structtype, flags) \
-	collection.RegisterType< structtype >(#structtype, flags)
-#define SERIALIZER_REGISTER_ENUM_TYPE_MEMBER(collection, structtype, membername, flags) \
-	collection.RegisterTypeMember< structtype >(#membername, structtype::membername, flags)
-#define SERIALIZER_REGISTER_TYPE_MEMBER(collection, structtype, membername, flags) \
-	collection.RegisterTypeMember< structtype, decltype(structtype::membername) >(#membername, offsetof(structtype, membername), flags)
-
+/*
+ * SerializerCpp
+ * Copyright (c) 2015-2016 Christopher D. Granz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <type_traits>
+#include <vector>
+#include <string>
+#include <utility>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <cstdio>
+#include <cassert>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+#include "Arena.hpp"
+#include "OutputBuffer.hpp"
+
+namespace RTTI {
+
+///////////////////////////////////////////////////////////////////////////////
+/// Type IDs with this bit set are stable: they are hashed from the name of
+/// the type, so they are the same in every build and process. The others
+/// are handed out in order of static initialization.
+///////////////////////////////////////////////////////////////////////////////
+static const int STABLE_TYPE_ID_BIT = 0x40000000;
+
+///////////////////////////////////////////////////////////////////////////////
+/// FNV-1a hash of a type name, at compile time
+///////////////////////////////////////////////////////////////////////////////
+constexpr uint32_t HashTypeName(const char* name, uint32_t hash = 2166136261u)
+{
+	return (*name == '\0') ? hash
+		: HashTypeName(name + 1, (hash ^ uint8_t(*name)) * 16777619u);
+}
+
+constexpr int StableTypeID(uint32_t hash)
+{
+	return int(uint32_t(STABLE_TYPE_ID_BIT) | (hash & uint32_t(STABLE_TYPE_ID_BIT - 1)));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Stable ID of type D, if it has one (see SERIALIZER_STABLE_TYPE_ID())
+///////////////////////////////////////////////////////////////////////////////
+template <typename D>
+struct StableID
+{
+	static const bool defined = false;
+	static const int value = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/// IDs are assigned during static initialization, which may run on more
+/// than one thread (e.g. as shared libraries load), so the counter is atomic.
+///////////////////////////////////////////////////////////////////////////////
+template <typename T> struct TypeCounter
+{
+	static std::atomic<int> NextTypeID;
+
+	template <typename D>
+	static inline int AssignTypeID()
+	{
+		if (StableID<D>::defined)
+			return StableID<D>::value;
+
+		int id = NextTypeID.fetch_add(1, std::memory_order_relaxed);
+		assert(id < STABLE_TYPE_ID_BIT);
+		return id;
+	}
+};
+
+template <typename T> std::atomic<int> TypeCounter<T>::NextTypeID(0);
+
+///////////////////////////////////////////////////////////////////////////////
+/// Helper class which stores type info.
+///////////////////////////////////////////////////////////////////////////////
+struct TypeInfo
+{
+	const int TypeID; //< unique type ID
+	inline explicit TypeInfo(int typeID) : TypeID(typeID) { }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+template < typename D, typename B >
+struct Base : public B
+{
+	static const TypeInfo RTTI;
+	Base() : B(RTTI.TypeID) { }
+	virtual ~Base() { }
+};
+
+template < typename D, typename B >
+const TypeInfo Base< D, B >::RTTI(TypeCounter<B>::template AssignTypeID<D>());
+
+///////////////////////////////////////////////////////////////////////////////
+/// This is a simple type wrapper which allows for passing and storing type
+/// ID from template functions to non-template functions or store in generic
+/// data structures.
+///////////////////////////////////////////////////////////////////////////////
+struct WrapperBase
+{
+	const int TypeID;
+	inline explicit WrapperBase(int typeID) : TypeID(typeID) { }
+	inline virtual ~WrapperBase() { }
+};
+
+template <typename T> class Wrapper final
+	: public Base< Wrapper<T>, WrapperBase >
+{ };
+
+///////////////////////////////////////////////////////////////////////////////
+/// Vectors of a type with a stable ID have one too
+///////////////////////////////////////////////////////////////////////////////
+template <typename T>
+struct StableID< Wrapper< std::vector<T> > >
+{
+	static const bool defined = StableID< Wrapper<T> >::defined;
+	static const int value = StableTypeID(HashTypeName("std::vector",
+		uint32_t(StableID< Wrapper<T> >::value)));
+};
+
+} // namespace RTTI
+
+///////////////////////////////////////////////////////////////////////////////
+/// Compile-time description of the members of a struct, specialized by
+/// SERIALIZER_FIELDS(). Serializers write and load such structs with code
+/// generated for them rather than by walking the registered schema.
+///////////////////////////////////////////////////////////////////////////////
+template <typename T>
+struct SerializerFields
+{
+	static const bool defined = false;
+	static const size_t count = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/// Whether T (or the elements of vector T) has SERIALIZER_FIELDS()
+///////////////////////////////////////////////////////////////////////////////
+template <typename T>
+struct SerializerHasFields : std::integral_constant<bool, SerializerFields<T>::defined> { };
+
+template <typename T>
+struct SerializerHasFields< std::vector<T> > : SerializerHasFields<T> { };
+
+///////////////////////////////////////////////////////////////////////////////
+class Serializer
+{
+protected:
+	///////////////////////////////////////////////////////////////////////////
+	// Helper template and base type when dealing with vector member types.
+	// Each element type has one constant dispatcher (instance) which every
+	// vector of that type shares. They are never deleted, hence no virtual
+	// destructor.
+	///////////////////////////////////////////////////////////////////////////
+	struct VectorTypeDispatcherBase
+	{
+		// smallest size grow() makes a vector
+		static const size_t GROW_MIN_SIZE = 16;
+
+		virtual size_t size(const void* obj) const = 0;
+		virtual const unsigned char* base(const void* obj) const = 0;
+		virtual unsigned char* base(void* obj) const = 0;
+		virtual void reserve(void* obj, size_t s) const = 0;
+
+		// these return base(obj) afterwards
+		virtual unsigned char* resize(void* obj, size_t s) const = 0;
+		virtual unsigned char* grow(void* obj, size_t s, size_t& newSize) const = 0;
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	template<typename T>
+	struct VectorTypeDispatcher final : public VectorTypeDispatcherBase
+	{
+		static const VectorTypeDispatcher instance;
+
+		inline constexpr VectorTypeDispatcher() { }
+
+		inline virtual size_t size(const void* obj) const
+		{
+			assert(obj != nullptr);
+			return static_cast<const std::vector<T>*>(obj)->size();
+		}
+
+		inline virtual const unsigned char* base(const void* obj) const
+		{
+			assert(obj != nullptr);
+			return (const unsigned char*)static_cast<const std::vector<T>*>(obj)->data();
+		}
+
+		inline virtual unsigned char* base(void* obj) const
+		{
+			assert(obj != nullptr);
+			return (unsigned char*)static_cast<std::vector<T>*>(obj)->data();
+		}
+
+		inline virtual void reserve(void* obj, size_t s) const
+		{
+			assert(obj != nullptr);
+			static_cast<std::vector<T>*>(obj)->reserve(s);
+		}
+
+		inline virtual unsigned char* resize(void* obj, size_t s) const
+		{
+			assert(obj != nullptr);
+			auto v = static_cast<std::vector<T>*>(obj);
+			v->resize(s);
+			return (unsigned char*)v->data();
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		// Make the vector at least s elements long when it is filled in one
+		// element at a time and its final size isn't known: it grows to at
+		// least twice its size, and resize() drops whatever was left unused
+		// at the end. newSize gets the size it grew to.
+		///////////////////////////////////////////////////////////////////////
+		inline virtual unsigned char* grow(void* obj, size_t s, size_t& newSize) const
+		{
+			assert(obj != nullptr);
+			auto v = static_cast<std::vector<T>*>(obj);
+			newSize = std::max(s, std::max(2 * v->size(), size_t(GROW_MIN_SIZE)));
+			v->resize(newSize);
+			return (unsigned char*)v->data();
+		}
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	// enum definition data
+	///////////////////////////////////////////////////////////////////////////
+	struct EnumDefData
+	{
+		std::string name;
+		int typeID;
+		const RTTI::TypeInfo* rtti; // of the enum (IDs alone can collide)
+		std::unordered_map<std::string, int> nameKeyMembers;  // map of defined enum name-value pairs
+		std::unordered_map<int, std::string> valueKeyMembers; // map of defined enum value-name pairs (so find by value)
+	};
+
+public:
+	///////////////////////////////////////////////////////////////////////////
+	static const unsigned int MAX_NESTED_DEPTH = 25;
+
+	///////////////////////////////////////////////////////////////////////////
+	enum class ComplexType
+	{
+		None = 0,
+		Enum,
+		Struct,
+		Vector,
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	// Which primitive a value is. Members get theirs when registered, so
+	// reading and writing them is a switch rather than typeID comparisons.
+	///////////////////////////////////////////////////////////////////////////
+	enum class PrimitiveType : unsigned char
+	{
+		None = 0, // not a primitive (enum, struct or vector)
+		Bool,
+		Char,
+		UChar,
+		Int16,
+		UInt16,
+		Int32,
+		UInt32,
+		Int64,
+		UInt64,
+		Float,
+		Double,
+		String,
+	};
+
+	template <typename T>
+	static constexpr PrimitiveType GetPrimitiveType(const T*)             { return PrimitiveType::None; }
+	static constexpr PrimitiveType GetPrimitiveType(const bool*)          { return PrimitiveType::Bool; }
+	static constexpr PrimitiveType GetPrimitiveType(const char*)          { return PrimitiveType::Char; }
+	static constexpr PrimitiveType GetPrimitiveType(const unsigned char*) { return PrimitiveType::UChar; }
+	static constexpr PrimitiveType GetPrimitiveType(const int16_t*)       { return PrimitiveType::Int16; }
+	static constexpr PrimitiveType GetPrimitiveType(const uint16_t*)      { return PrimitiveType::UInt16; }
+	static constexpr PrimitiveType GetPrimitiveType(const int32_t*)       { return PrimitiveType::Int32; }
+	static constexpr PrimitiveType GetPrimitiveType(const uint32_t*)      { return PrimitiveType::UInt32; }
+	static constexpr PrimitiveType GetPrimitiveType(const int64_t*)       { return PrimitiveType::Int64; }
+	static constexpr PrimitiveType GetPrimitiveType(const uint64_t*)      { return PrimitiveType::UInt64; }
+	static constexpr PrimitiveType GetPrimitiveType(const float*)         { return PrimitiveType::Float; }
+	static constexpr PrimitiveType GetPrimitiveType(const double*)        { return PrimitiveType::Double; }
+	static constexpr PrimitiveType GetPrimitiveType(const std::string*)   { return PrimitiveType::String; }
+
+	///////////////////////////////////////////////////////////////////////////
+	static const uint TEXT_EXPORT_NO_NAMES = (1 << 0);
+	static const uint TEXT_EXPORT_SINGLE_LINE = (1 << 1);
+	static const uint TEXT_EXPORT_MINIMAL = (1 << 2);
+
+	using AttribFlags = unsigned int;
+
+	///////////////////////////////////////////////////////////////////////////
+	// Data for one struct member (or the element of a vector), and for a
+	// struct or vector type as a whole. Once compiled these all live in one
+	// array, the schema (see CompileSchema()), where the members of a type
+	// are a run of entries which its struct and vector members refer to by
+	// index rather than each having a copy.
+	///////////////////////////////////////////////////////////////////////////
+	struct MemberData
+	{
+		const char* name;  // name for loading and writing (see InternName())
+		size_t nameLength;
+
+		size_t byteOffset; // offset inside the structure in bytes
+		int typeID;        // member type from RTTI::Wrapper<T>::RTTI.TypeID
+		size_t typeSize;   // size in bytes of the member (for vectors: of an element)
+
+		ComplexType complexType;                          // ComplexType::None if this is a primitive member
+		PrimitiveType primitiveType;                      // PrimitiveType::None unless this is a primitive member
+		const VectorTypeDispatcherBase* vectorDispatcher; // only used for vectors
+
+		AttribFlags attribFlags;                          // attributes for this member
+
+		// Plain bytes which can be copied as they are: a number, or a trivially
+		// copyable struct made up only of flat members without any padding
+		bool isFlat;
+
+		// structs and vectors: the run of the schema with the members of the
+		// struct (or the element of the vector)
+		uint32_t firstMember;
+		uint32_t memberCount;
+
+		///////////////////////////////////////////////////////////////////////
+		inline MemberData()
+			:
+			name("NO_NAME"),
+			nameLength(7),
+			byteOffset(0),
+			typeID(-1),
+			typeSize(0),
+			complexType(ComplexType::None),
+			primitiveType(PrimitiveType::None),
+			vectorDispatcher(nullptr),
+			attribFlags(0),
+			isFlat(false),
+			firstMember(0),
+			memberCount(0)
+		{ }
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	// Status information used during/after loading
+	///////////////////////////////////////////////////////////////////////////
+	enum class LoadStatus
+	{
+		NotYetLoaded = 0,
+		Loaded,
+		Missing,
+		BadFormat,
+		MaxNestDepthExceeded
+	};
+
+	static const size_t LOAD_STATUS_COUNT = size_t(LoadStatus::MaxNestDepthExceeded) + 1;
+
+	///////////////////////////////////////////////////////////////////////////
+	// What a load went through: every value (structs and vectors included)
+	// counted by status, and the first one which didn't load. Values loaded
+	// before a parse error are counted too, though the info the load
+	// returns then has no SubInfo().
+	///////////////////////////////////////////////////////////////////////////
+	struct LoadSummary
+	{
+		size_t counts[LOAD_STATUS_COUNT]; // indexed by LoadStatus
+		LoadStatus firstError;            // NotYetLoaded if everything loaded
+		std::string firstErrorName;       // name of the value firstError is for
+
+		inline LoadSummary()
+			:
+			firstError(LoadStatus::NotYetLoaded)
+		{
+			std::fill(counts, counts + LOAD_STATUS_COUNT, 0);
+		}
+
+		inline size_t Count(LoadStatus status) const { return counts[size_t(status)]; }
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	// How much a load reports (see SetLoadStatusDetail())
+	///////////////////////////////////////////////////////////////////////////
+	enum class LoadStatusDetail
+	{
+		Full = 0, // status of every member and element
+		Summary   // only the LoadSummary; structs and vectors have no SubInfo()
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	// Problems a load can run into (see LoadDiagnostic)
+	///////////////////////////////////////////////////////////////////////////
+	enum class LoadProblem
+	{
+		NotFound = 0,         // no value for a member
+		WrongType,            // value which doesn't convert to the member (or is out of range)
+		UnknownEnumValue,     // string which names no value of the enum
+		MaxNestDepthExceeded,
+		ParseFailed,          // the document isn't valid (JSON), or can't be read
+		BadData,              // binary data cut off, or not a valid value of the member
+		BadCount,             // binary member or element count which can't be right
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	// A problem with a value during a load, see SetDiagnosticSink()
+	///////////////////////////////////////////////////////////////////////////
+	struct LoadDiagnostic
+	{
+		const char* source;               // serializer which loaded, e.g. "SerializerJSON"
+		LoadProblem problem;
+		LoadStatus status;                // status the value gets
+		std::string path;                 // name of the value (like LoadSummary::firstErrorName)
+		ComplexType expectedType;         // what the member holds (both None for ParseFailed)
+		PrimitiveType expectedPrimitive;
+		std::string detail;               // the enum value not found, or why parsing failed
+		size_t line;                      // where the value is in the document, 0 if that
+		size_t column;                    // isn't known (binary data, loads from a Node tree)
+
+		///////////////////////////////////////////////////////////////////////
+		inline const char* ExpectedName() const
+		{
+			switch (expectedType)
+			{
+			case ComplexType::Enum:   return "enum";
+			case ComplexType::Struct: return "struct";
+			case ComplexType::Vector: return "vector";
+			default: break;
+			}
+
+			switch (expectedPrimitive)
+			{
+			case PrimitiveType::Bool:   return "bool";
+			case PrimitiveType::Char:   return "char";
+			case PrimitiveType::UChar:  return "uchar";
+			case PrimitiveType::Int16:  return "int16_t";
+			case PrimitiveType::UInt16: return "uint16_t";
+			case PrimitiveType::Int32:  return "int32_t";
+			case PrimitiveType::UInt32: return "uint32_t";
+			case PrimitiveType::Int64:  return "int64_t";
+			case PrimitiveType::UInt64: return "uint64_t";
+			case PrimitiveType::Float:  return "float";
+			case PrimitiveType::Double: return "double";
+			case PrimitiveType::String: return "string";
+			default: return "";
+			}
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		// What's wrong with a value of the wrong type, as messages put it
+		// (primitives add the type)
+		///////////////////////////////////////////////////////////////////////
+		inline const char* Complaint() const
+		{
+			switch (expectedType)
+			{
+			case ComplexType::Enum:   return "is not convertable to string for enum lookup";
+			case ComplexType::Struct: return "is not an object for struct loading";
+			case ComplexType::Vector: return "is not an array for vector loading";
+			default: break;
+			}
+
+			switch (expectedPrimitive)
+			{
+			case PrimitiveType::Bool:   return "is not bool";
+			case PrimitiveType::Float:
+			case PrimitiveType::Double: return "is not convertable to number";
+			case PrimitiveType::Char:
+			case PrimitiveType::UChar:
+			case PrimitiveType::String: return "is not convertable to string";
+			default:                    return "is not convertable to integer";
+			}
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		// What BadData and BadCount are about, as messages put it
+		///////////////////////////////////////////////////////////////////////
+		inline const char* BadDataWhat() const
+		{
+			if (problem == LoadProblem::BadData)
+				return (expectedType == ComplexType::Enum ? "Bad or missing data for enum" : "Bad or missing data for");
+
+			return (expectedType == ComplexType::Struct ? "Bad member count for struct" : "Bad element count for vector");
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		// Description (without position) as a message
+		///////////////////////////////////////////////////////////////////////
+		inline std::string ToString() const
+		{
+			if (problem == LoadProblem::MaxNestDepthExceeded)
+				return "Max nested depth exceeded";
+
+			std::string str;
+			str.reserve(64 + path.length() + detail.length());
+
+			if (problem == LoadProblem::BadData || problem == LoadProblem::BadCount)
+			{
+				str += BadDataWhat();
+				str += " '";
+				str += path;
+				str += "'";
+				return str;
+			}
+
+			str += (problem == LoadProblem::ParseFailed ? "Failed to parse '" : "Node '");
+			str += path;
+
+			switch (problem)
+			{
+			case LoadProblem::NotFound:
+				str += "' not found";
+				break;
+			case LoadProblem::UnknownEnumValue:
+				str += "' enum not found for '";
+				str += detail;
+				str += "'";
+				break;
+			case LoadProblem::ParseFailed:
+				str += "': ";
+				str += detail;
+				break;
+			default:
+				str += "' ";
+				str += Complaint();
+
+				if (expectedType == ComplexType::None)
+				{
+					str += " for '";
+					str += ExpectedName();
+					str += "' primitive";
+				}
+				break;
+			}
+
+			return str;
+		}
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	// Receives the problems of loads (see SetDiagnosticSink()). Sinks may be
+	// handed a type derived from LoadDiagnostic, depending on the source
+	// (see SerializerJSON::JSONLoadDiagnostic).
+	///////////////////////////////////////////////////////////////////////////
+	struct LoadDiagnosticSink
+	{
+		virtual ~LoadDiagnosticSink() { }
+		virtual void Report(const LoadDiagnostic& diagnostic) = 0;
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	// Prints every problem as a line to stdout (the default sink)
+	///////////////////////////////////////////////////////////////////////////
+	struct PrintDiagnostics final : public LoadDiagnosticSink
+	{
+		inline void Report(const LoadDiagnostic& d)
+		{
+			auto source = d.source;
+			auto path = d.path.c_str();
+
+			switch (d.problem)
+			{
+			case LoadProblem::NotFound:
+				printf("%s: Node '%s' not found\n", source, path);
+				break;
+			case LoadProblem::UnknownEnumValue:
+				printf("%s: Node '%s' enum not found for '%s'\n", source, path, d.detail.c_str());
+				break;
+			case LoadProblem::MaxNestDepthExceeded:
+				printf("%s: Max nested depth exceeded\n", source);
+				break;
+			case LoadProblem::ParseFailed:
+				printf("%s: Failed to parse '%s': %s\n", source, path, d.detail.c_str());
+				break;
+			case LoadProblem::BadData:
+			case LoadProblem::BadCount:
+				printf("%s: %s '%s'\n", source, d.BadDataWhat(), path);
+				break;
+			default:
+				if (d.expectedType == ComplexType::None)
+					printf("%s: Node '%s' %s for '%s' primitive\n", source, path, d.Complaint(), d.ExpectedName());
+				else
+					printf("%s: Node '%s' %s\n", source, path, d.Complaint());
+				break;
+			}
+		}
+
+		static inline PrintDiagnostics* Instance()
+		{
+			static PrintDiagnostics sink;
+			return &sink;
+		}
+	};
+
+protected:
+	class LoadContext;
+
+public:
+	///////////////////////////////////////////////////////////////////////////
+	// The sub infos of a load all come out of one Arena, which the info the
+	// load returns owns along with the LoadSummary. Sub infos own nothing,
+	// so it doesn't matter the arena never runs their destructors.
+	///////////////////////////////////////////////////////////////////////////
+	class LoadStatusInfo
+	{
+	private:
+		struct Storage
+		{
+			Arena arena;
+			LoadSummary summary;
+		};
+
+		friend class LoadContext;
+
+	public:
+		LoadStatus m_loadStatus;
+		uint32_t m_subInfoSize;    // 32 bits keep an info at 24 bytes
+		LoadStatusInfo* m_subInfo;
+
+	private:
+		Storage* m_storage; // only set in the info a load returns
+
+	public:
+		inline LoadStatusInfo(LoadStatus loadStatus)
+			:
+			m_loadStatus(loadStatus),
+			m_subInfoSize(0),
+			m_subInfo(nullptr),
+			m_storage(nullptr)
+		{ }
+
+		inline LoadStatusInfo()
+			:
+			m_loadStatus(LoadStatus::NotYetLoaded),
+			m_subInfoSize(0),
+			m_subInfo(nullptr),
+			m_storage(nullptr)
+		{ }
+
+		LoadStatusInfo(const LoadStatusInfo& rhs) = delete;
+		LoadStatusInfo& operator=(const LoadStatusInfo& rhs) = delete;
+
+		inline LoadStatusInfo(LoadStatusInfo&& rhs)
+			:
+			m_loadStatus(rhs.m_loadStatus),
+			m_subInfoSize(rhs.m_subInfoSize),
+			m_subInfo(rhs.m_subInfo),
+			m_storage(rhs.m_storage)
+		{
+			rhs.m_loadStatus = LoadStatus::NotYetLoaded;
+			rhs.m_subInfoSize = 0;
+			rhs.m_subInfo = nullptr;
+			rhs.m_storage = nullptr;
+		}
+
+		inline LoadStatusInfo& operator=(LoadStatusInfo&& rhs)
+		{
+			if (this == &rhs)
+				return *this;
+
+			delete m_storage;
+
+			m_loadStatus = rhs.m_loadStatus;
+			m_subInfoSize = rhs.m_subInfoSize;
+			m_subInfo = rhs.m_subInfo;
+			m_storage = rhs.m_storage;
+			rhs.m_loadStatus = LoadStatus::NotYetLoaded;
+			rhs.m_subInfoSize = 0;
+			rhs.m_subInfo = nullptr;
+			rhs.m_storage = nullptr;
+			return *this;
+		}
+
+		inline ~LoadStatusInfo()
+		{
+			delete m_storage;
+		}
+
+		inline LoadStatus Status() const { return m_loadStatus; }
+
+		inline const LoadStatusInfo& SubInfo(size_t i) const
+		{
+			assert(i < m_subInfoSize);
+			return m_subInfo[i];
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		// Only the info a load returns has a summary
+		///////////////////////////////////////////////////////////////////////
+		inline bool HasSummary() const { return (m_storage != nullptr); }
+
+		inline const LoadSummary& Summary() const
+		{
+			assert(m_storage != nullptr);
+			return m_storage->summary;
+		}
+	};
+
+protected:
+	///////////////////////////////////////////////////////////////////////////
+	// Bookkeeping for one load. The loaders get sub info arrays sized for
+	// the members or elements at hand from Loaded(), and hand each status
+	// to Record() (or Count(), if they keep it elsewhere). Finish() gives
+	// the arena and summary to the info of the whole load.
+	//
+	// The loaders also keep track of where they are with PushMember() and
+	// PushElement(), so nothing is spent on names unless one is reported:
+	// Name() puts the name of the current value together from that.
+	///////////////////////////////////////////////////////////////////////////
+	class LoadContext
+	{
+	private:
+		struct PathFrame
+		{
+			const char* name;  // of a struct member, or nullptr for a vector element
+			size_t nameLength;
+			size_t index;      // of the vector element
+		};
+
+		LoadStatusInfo::Storage* m_storage;
+		LoadStatusDetail m_detail;
+		const char* m_rootName;
+		std::vector<PathFrame> m_path;
+		LoadDiagnosticSink* m_sink; // nullptr when silent
+		size_t m_limit;             // problems m_sink gets at most (besides a failed parse)
+		size_t m_reported;          // problems m_sink got so far
+
+	public:
+		///////////////////////////////////////////////////////////////////////
+		inline LoadContext(
+			LoadStatusDetail detail,
+			const char* rootName,
+			LoadDiagnosticSink* sink = nullptr,
+			size_t limit = 0)
+			:
+			m_storage(new LoadStatusInfo::Storage),
+			m_detail(detail),
+			m_rootName(rootName),
+			m_sink(sink),
+			m_limit(limit),
+			m_reported(0)
+		{
+			assert(rootName != nullptr);
+			m_path.reserve(MAX_NESTED_DEPTH + 1);
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		LoadContext(const LoadContext& rhs) = delete;
+		LoadContext& operator=(const LoadContext& rhs) = delete;
+
+		///////////////////////////////////////////////////////////////////////
+		inline ~LoadContext()
+		{
+			delete m_storage;
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		inline LoadStatusDetail Detail() const { return m_detail; }
+		inline bool IsSummary() const          { return (m_detail == LoadStatusDetail::Summary); }
+
+		///////////////////////////////////////////////////////////////////////
+		// The sink to hand a problem with the current value to, which then
+		// counts as reported, or nullptr if it goes unreported (when silent
+		// or past the limit; a failed parse is always reported, since it
+		// explains whatever else went wrong)
+		///////////////////////////////////////////////////////////////////////
+		inline LoadDiagnosticSink* TakeReport(LoadProblem problem)
+		{
+			if (m_sink == nullptr || (m_reported >= m_limit && problem != LoadProblem::ParseFailed))
+				return nullptr;
+
+			++m_reported;
+			return m_sink;
+		}
+
+		inline LoadDiagnosticSink* Sink() const { return m_sink; }
+		inline size_t ReportsLeft() const       { return (m_reported < m_limit ? m_limit - m_reported : 0); }
+
+		///////////////////////////////////////////////////////////////////////
+		inline void PushMember(const char* name, size_t nameLength)
+		{
+			PathFrame frame = { name, nameLength, 0 };
+			m_path.push_back(frame);
+		}
+
+		inline void PushMember(const MemberData& m) { PushMember(m.name, m.nameLength); }
+
+		inline void PushElement(size_t index)
+		{
+			PathFrame frame = { nullptr, 0, index };
+			m_path.push_back(frame);
+		}
+
+		// move on to another element of the same vector
+		inline void SetElement(size_t index)
+		{
+			assert(!m_path.empty() && m_path.back().name == nullptr);
+			m_path.back().index = index;
+		}
+
+		inline void Pop()
+		{
+			assert(!m_path.empty());
+			m_path.pop_back();
+		}
+
+		// back to the root, from wherever a load cut short (by a parse
+		// error) left off
+		inline void Unwind() { m_path.clear(); }
+
+		///////////////////////////////////////////////////////////////////////
+		// Name of the current value as messages give it: the names of the
+		// members down to it joined by '.', with the index of vector
+		// elements in brackets (like "items[42].x")
+		///////////////////////////////////////////////////////////////////////
+		inline void Name(std::string& name) const
+		{
+			name = m_rootName;
+
+			for (auto& frame : m_path)
+			{
+				if (frame.name == nullptr)
+				{
+					name += "[";
+					name += std::to_string(frame.index);
+					name += "]";
+					continue;
+				}
+
+				if (name.length() > 0)
+					name += ".";
+
+				name.append(frame.name, frame.nameLength);
+			}
+		}
+
+		inline std::string Name() const
+		{
+			std::string name;
+			Name(name);
+			return name;
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		// A Loaded status with room for the status of count members or
+		// elements (none with LoadStatusDetail::Summary)
+		///////////////////////////////////////////////////////////////////////
+		inline LoadStatusInfo Loaded(size_t count)
+		{
+			assert(m_storage != nullptr);
+
+			LoadStatusInfo info(LoadStatus::Loaded);
+
+			if (count == 0 || IsSummary())
+				return info;
+
+			assert(count <= UINT32_MAX && "Too many members or elements for LoadStatusDetail::Full");
+
+			info.m_subInfo = m_storage->arena.AllocateArray<LoadStatusInfo>(count);
+			info.m_subInfoSize = uint32_t(count);
+
+			for (size_t i = 0; i < count; ++i)
+				new (&info.m_subInfo[i]) LoadStatusInfo();
+
+			return info;
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		// Count count values with status, the current one if it's only one
+		///////////////////////////////////////////////////////////////////////
+		inline void Count(LoadStatus status, size_t count = 1)
+		{
+			assert(m_storage != nullptr);
+			auto& summary = m_storage->summary;
+
+			summary.counts[size_t(status)] += count;
+
+			if (status != LoadStatus::Loaded && summary.firstError == LoadStatus::NotYetLoaded)
+			{
+				summary.firstError = status;
+				summary.firstErrorName = Name();
+			}
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		// Count info, the status of the current value, and keep it as the
+		// i-th sub info of parent
+		///////////////////////////////////////////////////////////////////////
+		inline void Record(LoadStatusInfo& parent, size_t i, LoadStatusInfo&& info)
+		{
+			Count(info.Status());
+
+			if (parent.m_subInfo != nullptr)
+			{
+				assert(i < parent.m_subInfoSize);
+				parent.m_subInfo[i] = std::move(info);
+			}
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		// Take over what part went through: its counts, its first error if
+		// we have none yet, and the sub infos it allocated. part loads a
+		// slice of our current value (on another thread) with a root name
+		// of Name(), and is merged once it's done, in the order of the
+		// slices. Nothing can be loaded with part afterwards.
+		///////////////////////////////////////////////////////////////////////
+		inline void Merge(LoadContext& part)
+		{
+			assert(m_storage != nullptr && part.m_storage != nullptr);
+			auto& summary = m_storage->summary;
+			auto& partSummary = part.m_storage->summary;
+
+			for (size_t i = 0; i < LOAD_STATUS_COUNT; ++i)
+				summary.counts[i] += partSummary.counts[i];
+
+			if (summary.firstError == LoadStatus::NotYetLoaded && partSummary.firstError != LoadStatus::NotYetLoaded)
+			{
+				summary.firstError = partSummary.firstError;
+				summary.firstErrorName.swap(partSummary.firstErrorName);
+			}
+
+			m_storage->arena.Adopt(part.m_storage->arena);
+			delete part.m_storage;
+			part.m_storage = nullptr;
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		// Count info, the status of the whole load, and give it the arena
+		// and summary. Nothing can be loaded with this context afterwards.
+		///////////////////////////////////////////////////////////////////////
+		inline LoadStatusInfo Finish(LoadStatusInfo&& info)
+		{
+			assert(m_storage != nullptr);
+			assert(info.m_storage == nullptr);
+
+			Unwind();
+			Count(info.Status());
+
+			LoadStatusInfo result = std::move(info);
+			result.m_storage = m_storage;
+			m_storage = nullptr;
+			return result;
+		}
+	};
+
+protected:
+	///////////////////////////////////////////////////////////////////////////
+	// Registered struct or vector type, as it is until CompileSchema()
+	///////////////////////////////////////////////////////////////////////////
+	struct TypeDefData
+	{
+		MemberData type;                 // the type as a whole
+		std::vector<MemberData> members; // its members (the element of a vector)
+		const RTTI::TypeInfo* rtti;      // of the type (IDs alone can collide)
+		bool isTriviallyCopyable;
+		bool registered;                 // false for vector types only members use
+		uint32_t schemaIndex;            // of the type in m_schema
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	std::unordered_map<int, TypeDefData> m_structDefs; // table of defined structures
+	std::unordered_map<int, EnumDefData> m_enumDefs;   // table of defined enums
+	std::unordered_set<std::string> m_names;           // member and type names
+
+	std::vector<MemberData> m_schema; // m_structDefs, compiled
+	bool m_schemaDirty;               // m_structDefs changed since it was compiled
+	bool m_frozen;                    // no more types or members can be registered (see Freeze())
+
+	LoadStatusDetail m_loadStatusDetail;
+	LoadDiagnosticSink* m_diagnosticSink; // nullptr when silent
+	size_t m_diagnosticLimit;             // problems reported per load at most
+
+protected:
+	///////////////////////////////////////////////////////////////////////////
+	// Fill in diagnostic for a problem with the current value of ctx and
+	// return the sink to hand it to, or nullptr (and leave diagnostic be)
+	// if it goes unreported (see LoadContext::TakeReport()). Position is
+	// left to the source to fill in.
+	///////////////////////////////////////////////////////////////////////////
+	static inline LoadDiagnosticSink* PrepareReport(
+		LoadContext& ctx,
+		LoadDiagnostic& diagnostic,
+		const char* source,
+		LoadStatus status,
+		LoadProblem problem,
+		ComplexType expectedType,
+		PrimitiveType expectedPrimitive,
+		const char* detail)
+	{
+		auto sink = ctx.TakeReport(problem);
+
+		if (sink == nullptr)
+			return nullptr;
+
+		diagnostic.source = source;
+		diagnostic.problem = problem;
+		diagnostic.status = status;
+		ctx.Name(diagnostic.path);
+		diagnostic.expectedType = expectedType;
+		diagnostic.expectedPrimitive = expectedPrimitive;
+		diagnostic.detail = detail;
+		diagnostic.line = 0;
+		diagnostic.column = 0;
+		return sink;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Names live in m_names, once each, and MemberData points at them
+	///////////////////////////////////////////////////////////////////////////
+	inline void SetName(MemberData& m, const char* name)
+	{
+		assert(name != nullptr);
+
+		m.name = m_names.insert(name).first->c_str();
+		m.nameLength = strlen(name);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Whether a struct of typeSize bytes with the given members is flat: each
+	// byte belongs to exactly one member, and those are flat themselves
+	///////////////////////////////////////////////////////////////////////////
+	static inline bool IsFlatStruct(const MemberData* members, size_t count, size_t typeSize)
+	{
+		if (count == 0)
+			return false;
+
+		std::vector<std::pair<size_t, size_t>> ranges; // offset, size
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (!members[i].isFlat)
+				return false;
+
+			ranges.push_back(std::make_pair(members[i].byteOffset, members[i].typeSize));
+		}
+
+		std::sort(ranges.begin(), ranges.end());
+		size_t end = 0;
+
+		for (auto& r : ranges)
+		{
+			if (r.first != end)
+				return false;
+
+			end += r.second;
+		}
+
+		return (end == typeSize);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	template <typename T>
+	struct ComplexTypeHelper
+	{
+		///////////////////////////////////////////////////////////////////////
+		static inline bool DefineType(Serializer& sds, const char* name, AttribFlags flags)
+		{
+			auto id = RTTI::Wrapper<T>::RTTI.TypeID;
+			if (sds.TypeIDOwner(id) != nullptr)
+			{
+				assert(false && "A type with the given name or type ID has already been added");
+				return false;
+			}
+
+			auto& def = sds.m_structDefs[id];
+			sds.SetName(def.type, name);
+			def.type.typeID = id;
+			def.type.typeSize = sizeof(T);
+			def.type.complexType = ComplexType::Struct;
+			def.type.attribFlags = flags;
+			def.rtti = &RTTI::Wrapper<T>::RTTI;
+			def.isTriviallyCopyable = std::is_trivially_copyable<T>::value;
+			def.registered = true;
+			def.schemaIndex = 0;
+			return true;
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		static inline bool BuildMember(Serializer& sds, MemberData& m, const char* name, size_t offset, AttribFlags flags)
+		{
+			assert(name != nullptr);
+			assert(name[0] != '\0');
+
+			auto id = RTTI::Wrapper<T>::RTTI.TypeID;
+
+			sds.SetName(m, name);
+			m.byteOffset = offset;
+			m.typeID = id;
+			m.typeSize = sizeof(T);
+			m.vectorDispatcher = nullptr;
+			m.attribFlags = flags;
+
+			// NOTE: we treat strings as primitives, so exclude them here
+			if (std::is_class<T>::value && id != RTTI::Wrapper<std::string>::RTTI.TypeID)
+			{
+				// the members are whichever the struct has when the schema is compiled
+				auto it = sds.m_structDefs.find(id);
+				assert(it != sds.m_structDefs.end());
+				m.complexType = ComplexType::Struct;
+
+				if (it != sds.m_structDefs.end())
+					m.attribFlags |= it->second.type.attribFlags;
+
+				return true;
+			}
+
+			if (std::is_enum<T>::value)
+			{
+				assert(sds.m_enumDefs.find(id) != sds.m_enumDefs.end());
+				m.complexType = ComplexType::Enum;
+				//m.attribFlags |= sds.m_enumDefs[childID].attribFlags;
+				return true;
+			}
+
+			// otherwise it is a primitive child member
+			m.complexType = ComplexType::None;
+			m.primitiveType = GetPrimitiveType((const T*)nullptr);
+			assert(m.primitiveType != PrimitiveType::None && "Unknown primitive type");
+			m.isFlat = (std::is_arithmetic<T>::value && !std::is_same<T, bool>::value);
+			return true;
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		static inline bool BuildChildMember(Serializer& sds, TypeDefData& parent, const char* name, size_t offset, AttribFlags flags)
+		{
+			assert(offset < parent.type.typeSize
+				&& "Byte offset into data structure is beyond the end of known size--data corruption likely!");
+#ifndef NDEBUG
+			// check that the member doesn't already exist
+			assert(name != nullptr);
+			assert(name[0] != '\0');
+
+			for (auto& m : parent.members)
+			{
+				if (strcmp(m.name, name) == 0)
+				{
+					assert(false && "Struct member with given name already exists in registry");
+					return false;
+				}
+			}
+#endif
+			parent.members.push_back(MemberData());
+			return BuildMember(sds, parent.members.back(), name, offset, flags);
+		}
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	/// Specialized for vector<T> types 
+	///////////////////////////////////////////////////////////////////////////
+	template <typename ElementT>
+	struct ComplexTypeHelper< std::vector<ElementT> >
+	{
+		///////////////////////////////////////////////////////////////////////
+		// Definition of vector<ElementT>, made the first time the type is
+		// registered or a member uses it. Members which are vectors of the
+		// same type share it.
+		///////////////////////////////////////////////////////////////////////
+		static inline TypeDefData& VectorDef(Serializer& sds)
+		{
+			auto id = RTTI::Wrapper< std::vector<ElementT> >::RTTI.TypeID;
+			auto it = sds.m_structDefs.find(id);
+
+			if (it != sds.m_structDefs.end())
+				return it->second;
+
+			auto& def = sds.m_structDefs[id];
+			sds.SetName(def.type, "vector<T>");
+			def.type.typeID = id;
+			def.type.typeSize = sizeof(ElementT);
+			def.type.complexType = ComplexType::Vector;
+			def.type.vectorDispatcher = &VectorTypeDispatcher<ElementT>::instance;
+			def.rtti = &RTTI::Wrapper< std::vector<ElementT> >::RTTI;
+			def.isTriviallyCopyable = false;
+			def.registered = false;
+			def.schemaIndex = 0;
+
+			def.members.push_back(MemberData());
+			ComplexTypeHelper< ElementT >::BuildMember(sds, def.members.back(), "vector<T>_subtype", 0, 0);
+			return def;
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		static inline bool DefineType(Serializer& sds, const char* name, AttribFlags flags)
+		{
+			auto& rtti = RTTI::Wrapper< std::vector<ElementT> >::RTTI;
+			auto id = rtti.TypeID;
+			auto it = sds.m_structDefs.find(id);
+
+			// only a definition VectorDef() made for members of this type is
+			// fine to take over
+			if ((it == sds.m_structDefs.end() || it->second.registered || it->second.rtti != &rtti)
+				&& sds.TypeIDOwner(id) != nullptr)
+			{
+				assert(false && "A type with the given name or type ID has already been added");
+				return false;
+			}
+
+			auto& def = VectorDef(sds);
+			sds.SetName(def.type, name);
+			def.type.attribFlags = flags;
+			def.registered = true;
+			return true;
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		static inline bool BuildMember(Serializer& sds, MemberData& m, const char* name, size_t offset, AttribFlags flags)
+		{
+			assert(name != nullptr);
+			assert(name[0] != '\0');
+
+			m = VectorDef(sds).type;
+			sds.SetName(m, name);
+			m.byteOffset = offset;
+			m.attribFlags = flags;
+			return true;
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		static inline bool BuildChildMember(Serializer& sds, TypeDefData& parent, const char* name, size_t offset, AttribFlags flags)
+		{
+			assert(offset < parent.type.typeSize
+				&& "Byte offset into data structure is beyond the end of known size--data corruption likely!");
+
+			parent.members.push_back(MemberData());
+			return BuildMember(sds, parent.members.back(), name, offset, flags);
+		}
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	// Lay m_structDefs out as m_schema, each type followed by its members.
+	// Struct and vector members get the run of their type rather than a copy
+	// of it, so whether those are flat is only known once all types are in.
+	///////////////////////////////////////////////////////////////////////////
+	inline void CompileSchema()
+	{
+		size_t size = 0;
+
+		for (auto& it : m_structDefs)
+			size += (1 + it.second.members.size());
+
+		m_schema.clear();
+		m_schema.reserve(size);
+
+		for (auto& it : m_structDefs)
+		{
+			auto& def = it.second;
+			def.schemaIndex = uint32_t(m_schema.size());
+
+			m_schema.push_back(def.type);
+			m_schema.back().firstMember = uint32_t(m_schema.size());
+			m_schema.back().memberCount = uint32_t(def.members.size());
+			m_schema.insert(m_schema.end(), def.members.begin(), def.members.end());
+		}
+
+		for (auto& m : m_schema)
+		{
+			if (m.complexType != ComplexType::Struct && m.complexType != ComplexType::Vector)
+				continue;
+
+			auto it = m_structDefs.find(m.typeID);
+			assert(it != m_structDefs.end() && "Unknown member type (was the type unregistered?)");
+
+			if (it == m_structDefs.end())
+				continue;
+
+			auto& t = m_schema[it->second.schemaIndex];
+			m.firstMember = t.firstMember;
+			m.memberCount = t.memberCount;
+		}
+
+		std::vector<bool> compiled(m_schema.size(), false);
+
+		for (auto& it : m_structDefs)
+			CompileFlat(it.second, compiled);
+
+		m_schemaDirty = false;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Work out isFlat for the struct members of def, then for def itself.
+	// Returns whether def is flat.
+	///////////////////////////////////////////////////////////////////////////
+	inline bool CompileFlat(const TypeDefData& def, std::vector<bool>& compiled)
+	{
+		auto& t = m_schema[def.schemaIndex];
+
+		if (compiled[def.schemaIndex])
+			return t.isFlat;
+
+		compiled[def.schemaIndex] = true;
+
+		for (uint32_t i = 0; i < t.memberCount; ++i)
+		{
+			auto& m = m_schema[t.firstMember + i];
+
+			if (m.complexType != ComplexType::Struct)
+				continue;
+
+			auto it = m_structDefs.find(m.typeID);
+			m.isFlat = (it != m_structDefs.end() && CompileFlat(it->second, compiled));
+		}
+
+		if (t.complexType == ComplexType::Struct)
+			t.isFlat = (def.isTriviallyCopyable && IsFlatStruct(m_schema.data() + t.firstMember, t.memberCount, t.typeSize));
+
+		return t.isFlat;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Schema entry of a registered struct or vector type, or nullptr
+	///////////////////////////////////////////////////////////////////////////
+	inline const MemberData* FindType(int typeID)
+	{
+		auto it = m_structDefs.find(typeID);
+
+		if (it == m_structDefs.end() || !it->second.registered)
+			return nullptr;
+
+		if (m_schemaDirty)
+		{
+			assert(!m_frozen);
+			CompileSchema();
+		}
+
+		return &m_schema[it->second.schemaIndex];
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Members of the struct m, or the element of the vector m
+	///////////////////////////////////////////////////////////////////////////
+	inline const MemberData* MembersOf(const MemberData& m) const
+	{
+		assert(!m_schemaDirty);
+		assert(m.firstMember + m.memberCount <= m_schema.size());
+		return (m_schema.data() + m.firstMember);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Description of a value of type T as a whole: the schema entry of a
+	// struct or vector type, or one made up for an enum or primitive
+	///////////////////////////////////////////////////////////////////////////
+	template <typename T>
+	inline MemberData DescribeType()
+	{
+		MemberData m;
+		m.typeID = RTTI::Wrapper<T>::RTTI.TypeID;
+		m.typeSize = sizeof(T);
+		m.primitiveType = GetPrimitiveType((const T*)nullptr);
+
+		auto t = FindType(m.typeID);
+
+		if (m_enumDefs.find(m.typeID) != m_enumDefs.end()) // enum type
+			m.complexType = ComplexType::Enum;
+		else if (t != nullptr) // struct or vector type
+			m = *t;
+		else
+			assert(IsPrimitive(m.primitiveType) && "Unknown type (is the type registered?)");
+
+		return m;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// How code generated for SERIALIZER_FIELDS() handles a value of type T
+	// (bool, std::string and vectors have their own overloads)
+	///////////////////////////////////////////////////////////////////////////
+	enum class FieldKind
+	{
+		Number,     // arithmetic type
+		Fields,     // struct with SERIALIZER_FIELDS()
+		Registered, // enum or struct only the registry knows about
+	};
+
+	template <typename T>
+	struct FieldKindOf : std::integral_constant<FieldKind,
+		(std::is_arithmetic<T>::value ? FieldKind::Number
+		  : (SerializerFields<T>::defined ? FieldKind::Fields : FieldKind::Registered))>
+	{ };
+
+	///////////////////////////////////////////////////////////////////////////
+	// MemberData::isFlat for a type known at compile time
+	///////////////////////////////////////////////////////////////////////////
+	template <typename StructT>
+	struct FlatFieldsVisitor
+	{
+		Serializer& serializer;
+		size_t size; // of the members so far
+		bool flat;
+
+		template <typename T>
+		inline void operator()(const char*, T StructT::*, size_t)
+		{
+			flat = (flat && serializer.IsFlatField((const T*)nullptr));
+			size += sizeof(T);
+		}
+	};
+
+	inline bool IsFlatField(const bool*)        { return false; }
+	inline bool IsFlatField(const std::string*) { return false; }
+
+	template <typename T>
+	inline bool IsFlatField(const std::vector<T>*) { return false; }
+
+	template <typename T>
+	inline bool IsFlatField(const T* type) { return IsFlatField(type, FieldKindOf<T>()); }
+
+	template <typename T>
+	inline bool IsFlatField(const T*, std::integral_constant<FieldKind, FieldKind::Number>) { return true; }
+
+	template <typename T>
+	inline bool IsFlatField(const T*, std::integral_constant<FieldKind, FieldKind::Fields>)
+	{
+		FlatFieldsVisitor<T> v = { *this, 0, true };
+		SerializerFields<T>::Visit(v);
+
+		// members which add up to the whole struct can't leave any padding
+		return (std::is_trivially_copyable<T>::value && SerializerFields<T>::count > 0
+			&& v.flat && v.size == sizeof(T));
+	}
+
+	template <typename T>
+	inline bool IsFlatField(const T*, std::integral_constant<FieldKind, FieldKind::Registered>)
+	{
+		if (std::is_enum<T>::value)
+			return false;
+
+		auto t = FindType(RTTI::Wrapper<T>::RTTI.TypeID);
+		assert(t != nullptr && "Unknown type (is the type registered?)");
+		return (t != nullptr && t->isFlat);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	static inline bool IsPrimitive(PrimitiveType primitiveType)
+	{
+		return (primitiveType != PrimitiveType::None);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Write str as a quoted JSON String, escaping where needed
+	///////////////////////////////////////////////////////////////////////////
+	static inline void PrintString(OutputBuffer& out, const char* str, size_t len)
+	{
+		static const char hexDigits[] = "0123456789abcdef";
+
+		auto p = str;
+		auto end = str + len;
+		auto run = p; // start of the characters which need no escaping
+
+		out.Put('\"');
+
+		for (; p != end; ++p)
+		{
+			auto c = static_cast<unsigned char>(*p);
+
+			if (c >= 0x20 && c != '\"' && c != '\\')
+				continue;
+
+			out.Write(run, size_t(p - run));
+			run = p + 1;
+
+			switch (c)
+			{
+			case '\"': out.Write("\\\"", 2); break;
+			case '\\': out.Write("\\\\", 2); break;
+			case '\b': out.Write("\\b", 2); break;
+			case '\f': out.Write("\\f", 2); break;
+			case '\n': out.Write("\\n", 2); break;
+			case '\r': out.Write("\\r", 2); break;
+			case '\t': out.Write("\\t", 2); break;
+			default:
+				out.Write("\\u00", 4);
+				out.Put(hexDigits[c >> 4]);
+				out.Put(hexDigits[c & 0xF]);
+				break;
+			}
+		}
+
+		out.Write(run, size_t(p - run));
+		out.Put('\"');
+	}
+
+	static inline void PrintString(OutputBuffer& out, const std::string& str) { PrintString(out, str.data(), str.size()); }
+
+	///////////////////////////////////////////////////////////////////////////
+	// PrintPrimitive() for values whose type is known at compile time
+	///////////////////////////////////////////////////////////////////////////
+	static inline void PrintValue(OutputBuffer& out, char value)          { PrintString(out, &value, 1); }
+	static inline void PrintValue(OutputBuffer& out, unsigned char value) { PrintString(out, (const char*)&value, 1); }
+	static inline void PrintValue(OutputBuffer& out, int16_t value)       { out.WriteInt(value); }
+	static inline void PrintValue(OutputBuffer& out, uint16_t value)      { out.WriteUInt(value); }
+	static inline void PrintValue(OutputBuffer& out, int32_t value)       { out.WriteInt(value); }
+	static inline void PrintValue(OutputBuffer& out, uint32_t value)      { out.WriteUInt(value); }
+	static inline void PrintValue(OutputBuffer& out, int64_t value)       { out.WriteInt(value); }
+	static inline void PrintValue(OutputBuffer& out, uint64_t value)      { out.WriteUInt(value); }
+	static inline void PrintValue(OutputBuffer& out, float value)         { out.WriteFloat(value); }
+	static inline void PrintValue(OutputBuffer& out, double value)        { out.WriteDouble(value); }
+
+	///////////////////////////////////////////////////////////////////////////
+	inline void PrintPrimitive(OutputBuffer& out, const unsigned char* data, PrimitiveType primitiveType)
+	{
+		assert(data != nullptr);
+
+		switch (primitiveType)
+		{
+		case PrimitiveType::Bool:
+			if (*((const bool*)data))
+				out.Write("true", 4);
+			else
+				out.Write("false", 5);
+			break;
+		case PrimitiveType::Char:   PrintValue(out, *((const char*)data)); break;
+		case PrimitiveType::UChar:  PrintValue(out, *((const unsigned char*)data)); break;
+		case PrimitiveType::Int16:  PrintValue(out, *((const int16_t*)data)); break;
+		case PrimitiveType::UInt16: PrintValue(out, *((const uint16_t*)data)); break;
+		case PrimitiveType::Int32:  PrintValue(out, *((const int32_t*)data)); break;
+		case PrimitiveType::UInt32: PrintValue(out, *((const uint32_t*)data)); break;
+		case PrimitiveType::Int64:  PrintValue(out, *((const int64_t*)data)); break;
+		case PrimitiveType::UInt64: PrintValue(out, *((const uint64_t*)data)); break;
+		case PrimitiveType::Float:  PrintValue(out, *((const float*)data)); break;
+		case PrimitiveType::Double: PrintValue(out, *((const double*)data)); break;
+		case PrimitiveType::String: PrintString(out, *((const std::string*)data)); break;
+		default:
+			assert(false && "Unknown primitive type");
+		}
+	}
+
+public:
+	///////////////////////////////////////////////////////////////////////////
+	inline Serializer()
+		:
+		m_schemaDirty(false),
+		m_frozen(false),
+		m_loadStatusDetail(LoadStatusDetail::Full),
+		m_diagnosticSink(PrintDiagnostics::Instance()),
+		m_diagnosticLimit(SIZE_MAX)
+	{ }
+
+	///////////////////////////////////////////////////////////////////////////
+	Serializer(const Serializer& rhs) = delete;
+	Serializer& operator=(const Serializer& rhs) = delete;
+
+	///////////////////////////////////////////////////////////////////////////
+	inline ~Serializer()
+	{
+		Clear();
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Forget every type, and thaw the serializer if it is frozen
+	///////////////////////////////////////////////////////////////////////////
+	inline void Clear()
+	{
+		m_enumDefs.clear();
+		m_structDefs.clear();
+		m_names.clear();
+		m_schema.clear();
+		m_schemaDirty = false;
+		m_frozen = false;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Make the registered types final. Loads and writes then only look
+	// types up, so any number of threads can share the serializer and load
+	// and write at the same time, as long as nothing changes its settings
+	// meanwhile. Registering or unregistering a type or a member afterwards
+	// is an error and is refused.
+	///////////////////////////////////////////////////////////////////////////
+	inline void Freeze()
+	{
+		if (m_schemaDirty)
+			CompileSchema();
+
+		m_frozen = true;
+	}
+
+	inline bool IsFrozen() const { return m_frozen; }
+
+	///////////////////////////////////////////////////////////////////////////
+	// With LoadStatusDetail::Summary loads only fill in the LoadSummary of
+	// the info they return, which then has no SubInfo(): there is no status
+	// kept for each member and element.
+	///////////////////////////////////////////////////////////////////////////
+	inline void SetLoadStatusDetail(LoadStatusDetail detail) { m_loadStatusDetail = detail; }
+	inline LoadStatusDetail GetLoadStatusDetail() const      { return m_loadStatusDetail; }
+
+	///////////////////////////////////////////////////////////////////////////
+	// Where loads report their problems; by default they are printed (see
+	// PrintDiagnostics). nullptr makes loads silent, so problems only show
+	// in the status they return. sink is called from the thread doing the
+	// load and has to outlive the loads it's set for; if the serializer is
+	// shared between threads (see Freeze()) it is called from several at
+	// once.
+	///////////////////////////////////////////////////////////////////////////
+	inline void SetDiagnosticSink(LoadDiagnosticSink* sink) { m_diagnosticSink = sink; }
+	inline LoadDiagnosticSink* GetDiagnosticSink() const    { return m_diagnosticSink; }
+
+	///////////////////////////////////////////////////////////////////////////
+	// Most problems one load reports (besides a failed parse); the rest are
+	// only counted in its LoadSummary. Unlimited by default.
+	///////////////////////////////////////////////////////////////////////////
+	inline void SetDiagnosticLimit(size_t limit) { m_diagnosticLimit = limit; }
+	inline size_t GetDiagnosticLimit() const     { return m_diagnosticLimit; }
+
+	///////////////////////////////////////////////////////////////////////////
+	// Returns the ID of the type, or -1 if the serializer is frozen or the
+	// ID is taken already: the type is registered twice, or the stable IDs
+	// of two types collide (see SERIALIZER_STABLE_TYPE_ID()). Which names
+	// collide doesn't depend on the build, so the type is refused without
+	// asserts too; TypeIDOwner() tells which type has the ID.
+	///////////////////////////////////////////////////////////////////////////
+	template <typename T>
+	inline int RegisterType(const char* name, AttribFlags flags = 0)
+	{
+		static_assert(std::is_class<T>::value == true
+			|| std::is_enum<T>::value == true,
+			"Type should be a class or enum type (not a primitive)");
+		static_assert(std::is_enum<T>::value == false
+			|| sizeof(T) == sizeof(int),
+			"Non-integer enum types are not supported");
+		static_assert(std::is_pointer<T>::value == false,
+			"Type should not be a pointer type");
+		//static_assert(std::is_standard_layout<T>::value == true
+		//	&& std::is_trivial<StructT>::value == true,
+		//	"Only POD types are supported");
+
+		assert(name != nullptr);
+		assert(name[0] != '\0');
+
+		if (m_frozen)
+		{
+			assert(false && "Can't register a type once the serializer is frozen");
+			return -1;
+		}
+
+		int id = RTTI::Wrapper<T>::RTTI.TypeID;
+
+		if (std::is_enum<T>::value == true)
+		{
+			if (TypeIDOwner(id) != nullptr)
+			{
+				assert(false && "A type with the given name or type ID has already been added");
+				return -1;
+			}
+
+			auto& s = m_enumDefs[id];
+			s.name = name;
+			s.typeID = id;
+			s.rtti = &RTTI::Wrapper<T>::RTTI;
+
+			return id;
+		}
+
+		// otherwise it is struct of vector type
+		if (!ComplexTypeHelper< T >::DefineType(*this, name, flags))
+			return -1;
+
+		m_schemaDirty = true;
+		return id;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Name of the enum, struct or vector type which has the type ID id (as
+	// in RTTI::Wrapper<T>::RTTI.TypeID), or nullptr if no type has it
+	///////////////////////////////////////////////////////////////////////////
+	inline const char* TypeIDOwner(int id) const
+	{
+		auto e = m_enumDefs.find(id);
+
+		if (e != m_enumDefs.end())
+			return e->second.name.c_str();
+
+		auto s = m_structDefs.find(id);
+
+		if (s != m_structDefs.end())
+			return s->second.type.name;
+
+		return nullptr;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	template <typename T>
+	inline void UnregisterType()
+	{
+		static_assert(std::is_class<T>::value == true
+			|| std::is_enum<T>::value == true,
+			"Type should be a class or enum type (not a primitive)");
+		static_assert(std::is_pointer<T>::value == false,
+			"T should not be a pointer type");
+
+		if (m_frozen)
+		{
+			assert(false && "Can't unregister a type once the serializer is frozen");
+			return;
+		}
+
+		int id = RTTI::Wrapper<T>::RTTI.TypeID;
+
+		// handle enums
+		if (std::is_enum<T>::value == true)
+		{
+			assert(m_enumDefs.find(id) != m_enumDefs.end());
+			m_enumDefs.erase(id);
+			return;
+		}
+
+		// otherwise it is a struct or vector type
+		auto it = m_structDefs.find(id);
+		assert(it != m_structDefs.end() && it->second.registered);
+
+		if (it == m_structDefs.end())
+			return;
+
+		// members which are vectors of this type still need it
+		if (it->second.type.complexType == ComplexType::Vector)
+			it->second.registered = false;
+		else
+			m_structDefs.erase(it);
+
+		m_schemaDirty = true;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	inline void UnregisterAllTypes()
+	{
+		if (m_frozen)
+		{
+			assert(false && "Can't unregister types once the serializer is frozen");
+			return;
+		}
+
+		m_enumDefs.clear();
+		m_structDefs.clear();
+		m_names.clear();
+		m_schema.clear();
+		m_schemaDirty = false;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	template <typename EnumT>
+	inline bool RegisterTypeMember(const char* name, EnumT value, AttribFlags flags = 0)
+	{
+		static_assert(std::is_enum<EnumT>::value == true,
+			"Type should be an enum type");
+		static_assert(sizeof(EnumT) == sizeof(int),
+			"Non-integer enum types are not supported");
+
+		int id = RTTI::Wrapper<EnumT>::RTTI.TypeID;
+		assert(m_enumDefs.find(id) != m_enumDefs.end());
+
+		assert(name != nullptr);
+		assert(name[0] != '\0');
+
+		if (m_frozen)
+		{
+			assert(false && "Can't register a member once the serializer is frozen");
+			return false;
+		}
+
+		auto it = m_enumDefs.find(id);
+
+		// couldn't find the enum (or its ID is another's, see RegisterType())
+		if (it == m_enumDefs.end() || it->second.rtti != &RTTI::Wrapper<EnumT>::RTTI)
+		{
+			assert(false && "Couldn't find enum to add member to");
+			return false;
+		}
+
+		auto& e = it->second;
+		e.nameKeyMembers.insert(std::pair<std::string, int>(name, (int)value));
+		e.valueKeyMembers.insert(std::pair<int, std::string>((int)value, name));
+
+		return true;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	template <typename ParentStructT, typename T>
+	inline bool RegisterTypeMember(const char* name, size_t offset, AttribFlags flags = 0)
+	{
+		static_assert(std::is_class<ParentStructT>::value == true,
+			"Parent type should be a struct type");
+
+		if (m_frozen)
+		{
+			assert(false && "Can't register a member once the serializer is frozen");
+			return false;
+		}
+
+		auto& parentRTTI = RTTI::Wrapper<ParentStructT>::RTTI;
+		auto it = m_structDefs.find(parentRTTI.TypeID);
+		assert(it != m_structDefs.end());
+
+		// the parent's ID may be another type's (see RegisterType())
+		if (it == m_structDefs.end() || it->second.rtti != &parentRTTI)
+			return false;
+
+		m_schemaDirty = true;
+		return ComplexTypeHelper< T >::BuildChildMember(*this, it->second, name, offset, flags);
+	}
+
+private:
+	///////////////////////////////////////////////////////////////////////////
+	template <typename StructT>
+	struct RegisterFieldsVisitor
+	{
+		Serializer& serializer;
+		bool ok;
+
+		template <typename T>
+		inline void operator()(const char* name, T StructT::*, size_t offset)
+		{
+			ok = (serializer.RegisterTypeMember<StructT, T>(name, offset) && ok);
+		}
+	};
+
+public:
+	///////////////////////////////////////////////////////////////////////////
+	// Register a struct with SERIALIZER_FIELDS() and its members, for the
+	// cases which go through the registry (e.g. as a member of a struct
+	// which is only registered). Types of its members must be registered
+	// already, as with RegisterTypeMember().
+	///////////////////////////////////////////////////////////////////////////
+	template <typename StructT>
+	inline bool RegisterFields(const char* name, AttribFlags flags = 0)
+	{
+		static_assert(SerializerFields<StructT>::defined,
+			"Type has no SERIALIZER_FIELDS()");
+
+		if (RegisterType<StructT>(name, flags) < 0)
+			return false;
+
+		RegisterFieldsVisitor<StructT> v = { *this, true };
+		SerializerFields<StructT>::Visit(v);
+		return v.ok;
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////
+template <typename T>
+constexpr Serializer::VectorTypeDispatcher<T> Serializer::VectorTypeDispatcher<T>::instance;
+
+///////////////////////////////////////////////////////////////////////////////
+// convenience macros for registering new types
+///////////////////////////////////////////////////////////////////////////////
+#define SERIALIZER_REGISTER_TYPE(collection, structtype, flags) \
+	collection.RegisterType< structtype >(#structtype, flags)
+#define SERIALIZER_REGISTER_ENUM_TYPE_MEMBER(collection, structtype, membername, flags) \
+	collection.RegisterTypeMember< structtype >(#membername, structtype::membername, flags)
+#define SERIALIZER_REGISTER_TYPE_MEMBER(collection, structtype, membername, flags) \
+	collection.RegisterTypeMember< structtype, decltype(structtype::membername) >(#membername, offsetof(structtype, membername), flags)
+
+///////////////////////////////////////////////////////////////////////////////
+// Describe the members of a struct at compile time, e.g.
+//
+//   SERIALIZER_FIELDS(Vec3, x, y, z);
+//
+// Use it at global scope, after the struct (and any SERIALIZER_FIELDS() of
+// its member types). Writing and loading follow the order given here, as
+// they do registration order; nothing needs registering except enums and
+// member structs without SERIALIZER_FIELDS(). Members described this way
+// have no attribute flags. Up to 32 members.
+///////////////////////////////////////////////////////////////////////////////
+#define SERIALIZER_FIELDS(structtype, ...) \
+	template <> struct SerializerFields< structtype > \
+	{ \
+		static const bool defined = true; \
+		static const size_t count = (0 SERIALIZER_FIELDS_FOR_EACH(SERIALIZER_FIELDS_COUNT, structtype, __VA_ARGS__)); \
+		template <typename V> static inline void Visit(V& v) \
+		{ \
+			SERIALIZER_FIELDS_FOR_EACH(SERIALIZER_FIELDS_VISIT, structtype, __VA_ARGS__) \
+		} \
+	}
+#define SERIALIZER_REGISTER_FIELDS(collection, structtype, flags) \
+	collection.RegisterFields< structtype >(#structtype, flags)
+
+///////////////////////////////////////////////////////////////////////////////
+// Give a struct or enum a type ID hashed from its name, e.g.
+//
+//   SERIALIZER_STABLE_TYPE_ID(game::Player);
+//
+// rather than one depending on the order of static initialization, so the
+// ID is the same in every build and process (vectors of it get stable IDs
+// too). Use it at global scope, before anything uses the ID of the type.
+// The ID is hashed from the name exactly as spelled, so Player and
+// game::Player get different IDs: spell it the same way everywhere. A type
+// whose ID collides with one registered already is refused (see
+// RegisterType()), in release builds as well.
+///////////////////////////////////////////////////////////////////////////////
+#define SERIALIZER_STABLE_TYPE_ID(type) \
+	template <> struct RTTI::StableID< RTTI::Wrapper< type > > \
+	{ \
+		static const bool defined = true; \
+		static const int value = RTTI::StableTypeID(RTTI::HashTypeName(#type)); \
+	}
+
+#define SERIALIZER_FIELDS_COUNT(structtype, membername) + 1
+#define SERIALIZER_FIELDS_VISIT(structtype, membername) \
+	v(#membername, &structtype::membername, offsetof(structtype, membername));
+
+#define SERIALIZER_FIELDS_EXPAND(x) x
+#define SERIALIZER_FIELDS_1(f, t, m) f(t, m)
+#define SERIALIZER_FIELDS_2(f, t, m, ...) f(t, m) SERIALIZER_FIELDS_EXPAND(SERIALIZER_FIELDS_1(f, t, __VA_ARGS__))
+#define SERIALIZER_FIELDS_3(f, t, m, ...) f(t, m) SERIALIZER_FIELDS_EXPAND(SERIALIZER_FIELDS_2(f, t, __VA_ARGS__))
+#define SERIALIZER_FIELDS_4(f, t, m, ...) f(t, m) SERIALIZER_FIELDS_EXPAND(SERIALIZER_FIELDS_3(f, t, __VA_ARGS__))
+#define SERIALIZER_FIELDS_5(f, t, m, ...) f(t, m) SERIALIZER_FIELDS_EXPAND(SERIALIZER_FIELDS_4(f, t, __VA_ARGS__))
+#define SERIALIZER_FIELDS_6(f, t, m, ...) f(t, m) SERIALIZER_FIELDS_EXPAND(SERIALIZER_FIELDS_5(f, t, __VA_ARGS__))
+#define SERIALIZER_FIELDS_7(f, t, m, ...) f(t, m) SERIALIZER_FIELDS_EXPAND(SERIALIZER_FIELDS_6(f, t, __VA_ARGS__))
+#define SERIALIZER_FIELDS_8(f, t, m, ...) f(t, m) SERIALIZER_FIELDS_EXPAND(SERIALIZER_FIELDS_7(f, t, __VA_ARGS__))
+#define SERIALIZER_FIELDS_9(f, t, m, ...) f(t, m) SERIALIZER_FIELDS_EXPAND(SERIALIZER_FIELDS_8(f, t, __VA_ARGS__))
+#define SERIALIZER_FIELDS_10(f, t, m, ...) f(t, m) SERIALIZER_FIELDS_EXPAND(SERIALIZER_FIELDS_9(f, t, __VA_ARGS__))
+#define SERIALIZER_FIELDS_11(f, t, m, ...) f(t, m) SERIALIZER_FIELDS_EXPAND(SERIALIZER_FIELDS_10(f, t, __VA_ARGS__))
+#define SERIALIZER_FIELDS_12(f, t, m, ...) f(t, m) SERIALIZER_FIELDS_EXPAND(SERIALIZER_FIELDS_11(f, t, __VA_ARGS__))
+#define SERIALIZER_FIELDS_13(f, t, m, ...) f(t, m) SERIALIZER_FIELDS_EXPAND(SERIALIZER_FIELDS_12(f, t, __VA_ARGS__))
+#define SERIALIZER_FIELDS_14(f, t, m, ...) f(t, m) SERIALIZER_FIELDS_EXPAND(SERIALIZER_FIELDS_13(f, t, __VA_ARGS__))
+#define SERIALIZER_FIELDS_15(f, t, m, ...) f(t, m) SERIALIZER_FIELDS_EXPAND(SERIALIZER_FIELDS_14(f, t, __VA_ARGS__))
+#define SERIALIZER_FIELDS_16(f, t, m, ...) f(t, m) SERIALIZER_FIELDS_EXPAND(SERIALIZER_FIELDS_15(f, t, __VA_ARGS__))
+#define SERIALIZER_FIELDS_17(f, t, m, ...) f(t, m) SERIALIZER_FIELDS_EXPAND(SERIALIZER_FIELDS_16(f, t, __VA_ARGS__))
+#define SERIALIZER_FIELDS_18(f, t, m, ...) f(t, m) SERIALIZER_FIELDS_EXPAND(SERIALIZER_FIELDS_17(f, t, __VA_ARGS__))
+#define SERIALIZER_FIELDS_19(f, t, m, ...) f(t, m) SERIALIZER_FIELDS_EXPAND(SERIALIZER_FIELDS_18(f, t, __VA_ARGS__))
+#define SERIALIZER_FIELDS_20(f, t, m, ...) f(t, m) SERIALIZER_FIELDS_EXPAND(SERIALIZER_FIELDS_19(f, t, __VA_ARGS__))
+#define SERIALIZER_FIELDS_21(f, t, m, ...) f(t, m) SERIALIZER_FIELDS_EXPAND(SERIALIZER_FIELDS_20(f, t, __VA_ARGS__))
+#define SERIALIZER_FIELDS_22(f, t, m, ...) f(t, m) SERIALIZER_FIELDS_EXPAND(SERIALIZER_FIELDS_21(f, t, __VA_ARGS__))
+#define SERIALIZER_FIELDS_23(f, t, m, ...) f(t, m) SERIALIZER_FIELDS_EXPAND(SERIALIZER_FIELDS_22(f, t, __VA_ARGS__))
+#define SERIALIZER_FIELDS_24(f, t, m, ...) f(t, m) SERIALIZER_FIELDS_EXPAND(SERIALIZER_FIELDS_23(f, t, __VA_ARGS__))
+#define SERIALIZER_FIELDS_25(f, t, m, ...) f(t, m) SERIALIZER_FIELDS_EXPAND(SERIALIZER_FIELDS_24(f, t, __VA_ARGS__))
+#define SERIALIZER_FIELDS_26(f, t, m, ...) f(t, m) SERIALIZER_FIELDS_EXPAND(SERIALIZER_FIELDS_25(f, t, __VA_ARGS__))
+#define SERIALIZER_FIELDS_27(f, t, m, ...) f(t, m) SERIALIZER_FIELDS_EXPAND(SERIALIZER_FIELDS_26(f, t, __VA_ARGS__))
+#define SERIALIZER_FIELDS_28(f, t, m, ...) f(t, m) SERIALIZER_FIELDS_EXPAND(SERIALIZER_FIELDS_27(f, t, __VA_ARGS__))
+#define SERIALIZER_FIELDS_29(f, t, m, ...) f(t, m) SERIALIZER_FIELDS_EXPAND(SERIALIZER_FIELDS_28(f, t, __VA_ARGS__))
+#define SERIALIZER_FIELDS_30(f, t, m, ...) f(t, m) SERIALIZER_FIELDS_EXPAND(SERIALIZER_FIELDS_29(f, t, __VA_ARGS__))
+#define SERIALIZER_FIELDS_31(f, t, m, ...) f(t, m) SERIALIZER_FIELDS_EXPAND(SERIALIZER_FIELDS_30(f, t, __VA_ARGS__))
+#define SERIALIZER_FIELDS_32(f, t, m, ...) f(t, m) SERIALIZER_FIELDS_EXPAND(SERIALIZER_FIELDS_31(f, t, __VA_ARGS__))
+#define SERIALIZER_FIELDS_PICK(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, _17, _18, _19, _20, _21, _22, _23, _24, _25, _26, _27, _28, _29, _30, _31, _32, name, ...) name
+#define SERIALIZER_FIELDS_FOR_EACH(f, t, ...) \
+	SERIALIZER_FIELDS_EXPAND(SERIALIZER_FIELDS_PICK(__VA_ARGS__, \
+		SERIALIZER_FIELDS_32, SERIALIZER_FIELDS_31, SERIALIZER_FIELDS_30, SERIALIZER_FIELDS_29, \
+		SERIALIZER_FIELDS_28, SERIALIZER_FIELDS_27, SERIALIZER_FIELDS_26, SERIALIZER_FIELDS_25, \
+		SERIALIZER_FIELDS_24, SERIALIZER_FIELDS_23, SERIALIZER_FIELDS_22, SERIALIZER_FIELDS_21, \
+		SERIALIZER_FIELDS_20, SERIALIZER_FIELDS_19, SERIALIZER_FIELDS_18, SERIALIZER_FIELDS_17, \
+		SERIALIZER_FIELDS_16, SERIALIZER_FIELDS_15, SERIALIZER_FIELDS_14, SERIALIZER_FIELDS_13, \
+		SERIALIZER_FIELDS_12, SERIALIZER_FIELDS_11, SERIALIZER_FIELDS_10, SERIALIZER_FIELDS_9, \
+		SERIALIZER_FIELDS_8, SERIALIZER_FIELDS_7, SERIALIZER_FIELDS_6, SERIALIZER_FIELDS_5, \
+		SERIALIZER_FIELDS_4, SERIALIZER_FIELDS_3, SERIALIZER_FIELDS_2, SERIALIZER_FIELDS_1)(f, t, __VA_ARGS__))
@@ -0,0 +1,1073 @@
+/*
+ * SerializerCpp
+ * Copyright (c) 2015-2016 Christopher D. Granz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "Serializer.hpp"
+#include "MappedFile.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+
+///////////////////////////////////////////////////////////////////////////////
+/// Compact binary counterpart to SerializerJSON, for when the data doesn't
+/// need to be read by people. Everything is little endian:
+///
+///   integers  varint (7 bits per byte, low bits first), signed ones zigzag
+///             encoded so small negative numbers stay small
+///   enums     as a signed integer
+///   bool/char one byte
+///   float     4 bytes (IEEE 754)
+///   double    8 bytes (IEEE 754)
+///   string    varint length, then the bytes
+///   vector    varint element count, then the elements; if they are flat
+///             (see MemberData::isFlat) just their bytes as they are in
+///             memory, with each number little endian
+///   struct    varint member count, then the members in registration order
+///
+/// Nothing is tagged, so data only loads into the types it was written
+/// from. Members added to the end of a struct after writing are Missing
+/// when loading, the others still load.
+///////////////////////////////////////////////////////////////////////////////
+class SerializerBinary : public Serializer
+{
+private:
+	///////////////////////////////////////////////////////////////////////////
+	// Input being loaded. Once anything has gone wrong all further reads
+	// fail too, since there's no telling where the next value starts.
+	///////////////////////////////////////////////////////////////////////////
+	struct BinaryReader
+	{
+		const unsigned char* p;
+		const unsigned char* end;
+		bool failed;
+
+		inline BinaryReader(const void* data, size_t size)
+			:
+			p(static_cast<const unsigned char*>(data)),
+			end(static_cast<const unsigned char*>(data) + size),
+			failed(false)
+		{ }
+
+		inline size_t Remaining() const { return size_t(end - p); }
+
+		inline bool Read(void* dest, size_t len)
+		{
+			if (failed || Remaining() < len)
+			{
+				failed = true;
+				return false;
+			}
+
+			memcpy(dest, p, len);
+			p += len;
+			return true;
+		}
+
+		inline bool ReadVarint(uint64_t& value)
+		{
+			value = 0;
+
+			for (unsigned int shift = 0; !failed && p != end && shift < 64; shift += 7)
+			{
+				auto byte = *p++;
+				value |= (uint64_t(byte & 0x7F) << shift);
+
+				if ((byte & 0x80) == 0)
+					return true;
+			}
+
+			failed = true; // cut off or longer than 10 bytes
+			return false;
+		}
+
+		template <typename T>
+		inline bool ReadLittleEndian(T& value)
+		{
+			unsigned char bytes[sizeof(T)];
+
+			if (!Read(bytes, sizeof(T)))
+				return false;
+
+			value = 0;
+
+			for (size_t i = 0; i < sizeof(T); ++i)
+				value |= (T(bytes[i]) << (8 * i));
+
+			return true;
+		}
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	static inline uint64_t ZigZag(int64_t value)    { return ((uint64_t(value) << 1) ^ uint64_t(value >> 63)); }
+	static inline int64_t UnZigZag(uint64_t value)  { return int64_t((value >> 1) ^ (0 - (value & 1))); }
+
+	///////////////////////////////////////////////////////////////////////////
+	static inline void WriteVarint(OutputBuffer& out, uint64_t value)
+	{
+		unsigned char bytes[10];
+		size_t len = 0;
+
+		while (value >= 0x80)
+		{
+			bytes[len++] = static_cast<unsigned char>(value | 0x80);
+			value >>= 7;
+		}
+
+		bytes[len++] = static_cast<unsigned char>(value);
+		out.Write((const char*)bytes, len);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	template <typename T>
+	static inline void WriteLittleEndian(OutputBuffer& out, T value)
+	{
+		unsigned char bytes[sizeof(T)];
+
+		for (size_t i = 0; i < sizeof(T); ++i)
+			bytes[i] = static_cast<unsigned char>(value >> (8 * i));
+
+		out.Write((const char*)bytes, sizeof(T));
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	static inline bool IsLittleEndian()
+	{
+		const uint16_t one = 1;
+		unsigned char firstByte;
+		memcpy(&firstByte, &one, 1);
+		return (firstByte == 1);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Reverse the bytes of each number in the flat value at data (which turns
+	// memory order into the little endian order of the format and back again
+	// on big endian machines)
+	///////////////////////////////////////////////////////////////////////////
+	inline void SwapFlat(unsigned char* data, const MemberData& m)
+	{
+		assert(m.isFlat);
+
+		if (m.complexType == ComplexType::None)
+		{
+			std::reverse(data, data + m.typeSize);
+			return;
+		}
+
+		auto members = MembersOf(m);
+
+		for (uint32_t i = 0; i < m.memberCount; ++i)
+			SwapFlat(data + members[i].byteOffset, members[i]);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Read a varint into an integer of type T, which it must fit in
+	///////////////////////////////////////////////////////////////////////////
+	template <typename T>
+	static inline bool ReadInteger(BinaryReader& in, T& value)
+	{
+		uint64_t raw;
+
+		if (!in.ReadVarint(raw))
+			return false;
+
+		if (std::is_signed<T>::value)
+		{
+			auto v = UnZigZag(raw);
+
+			if (v < int64_t(std::numeric_limits<T>::min()) || v > int64_t(std::numeric_limits<T>::max()))
+				return false;
+
+			value = T(v);
+		}
+		else
+		{
+			if (raw > uint64_t(std::numeric_limits<T>::max()))
+				return false;
+
+			value = T(raw);
+		}
+
+		return true;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Hand a problem with the current value of ctx to the sink (if it's to
+	// get it), and return the status the value gets
+	///////////////////////////////////////////////////////////////////////////
+	inline LoadStatusInfo Report(
+		LoadContext& ctx,
+		LoadStatus status,
+		LoadProblem problem,
+		ComplexType expectedType,
+		PrimitiveType expectedPrimitive,
+		const char* detail = "")
+	{
+		LoadDiagnostic diagnostic;
+		auto sink = PrepareReport(ctx, diagnostic, "SerializerBinary", status, problem, expectedType, expectedPrimitive, detail);
+
+		if (sink != nullptr)
+			sink->Report(diagnostic);
+
+		return LoadStatusInfo(status);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	inline LoadStatusInfo BinaryLoadPrimitive(
+		LoadContext& ctx,
+		unsigned char* data,
+		PrimitiveType primitiveType,
+		BinaryReader& in)
+	{
+		assert(data != nullptr);
+
+		bool ok = false;
+
+		switch (primitiveType)
+		{
+		case PrimitiveType::Bool:
+		{
+			unsigned char byte;
+
+			if ((ok = (in.Read(&byte, 1) && byte <= 1)))
+				*((bool*)data) = (byte != 0);
+			break;
+		}
+		case PrimitiveType::Char:
+		case PrimitiveType::UChar:  ok = in.Read(data, 1); break;
+		case PrimitiveType::Int16:  ok = ReadInteger(in, *((int16_t*)data)); break;
+		case PrimitiveType::UInt16: ok = ReadInteger(in, *((uint16_t*)data)); break;
+		case PrimitiveType::Int32:  ok = ReadInteger(in, *((int32_t*)data)); break;
+		case PrimitiveType::UInt32: ok = ReadInteger(in, *((uint32_t*)data)); break;
+		case PrimitiveType::Int64:  ok = ReadInteger(in, *((int64_t*)data)); break;
+		case PrimitiveType::UInt64: ok = ReadInteger(in, *((uint64_t*)data)); break;
+		case PrimitiveType::Float:  ok = ReadNumber(in, *((float*)data)); break;
+		case PrimitiveType::Double: ok = ReadNumber(in, *((double*)data)); break;
+		case PrimitiveType::String:
+		{
+			uint64_t len;
+
+			if ((ok = (in.ReadVarint(len) && len <= in.Remaining())))
+			{
+				((std::string*)data)->assign((const char*)in.p, size_t(len));
+				in.p += len;
+			}
+			break;
+		}
+		default: // unknown type
+			assert(false && "Unknown primitive type");
+			return LoadStatusInfo(LoadStatus::BadFormat);
+		}
+
+		if (!ok)
+		{
+			in.failed = true;
+			return Report(ctx, LoadStatus::BadFormat, LoadProblem::BadData, ComplexType::None, primitiveType);
+		}
+
+		return LoadStatusInfo(LoadStatus::Loaded);
+	}
+	///////////////////////////////////////////////////////////////////////////
+	inline LoadStatusInfo BinaryLoadHelper(
+		LoadContext& ctx,
+		unsigned char* data,
+		const MemberData& m,
+		BinaryReader& in,
+		unsigned int nestedDepth)
+	{
+		assert(data != nullptr);
+
+		// the data ended or went bad earlier on (which was reported then)
+		if (in.failed)
+			return LoadStatusInfo(LoadStatus::BadFormat);
+
+		if (nestedDepth > MAX_NESTED_DEPTH)
+		{
+			in.failed = true;
+			return Report(ctx, LoadStatus::MaxNestDepthExceeded, LoadProblem::MaxNestDepthExceeded, m.complexType, m.primitiveType);
+		}
+
+		// check for complexType types first
+		if (m.complexType == ComplexType::Enum)
+			return BinaryLoadEnum(ctx, data, m.typeID, in);
+		else if (m.complexType == ComplexType::Struct)
+			return BinaryLoadStruct(ctx, data, m, in, nestedDepth);
+		else if (m.complexType == ComplexType::Vector)
+			return BinaryLoadVector(ctx, data, m, in, nestedDepth);
+
+		// otherwise it is a primitive type
+		assert(m.complexType == ComplexType::None);
+		return BinaryLoadPrimitive(ctx, data, m.primitiveType, in);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	inline LoadStatusInfo BinaryLoadEnum(
+		LoadContext& ctx,
+		unsigned char* data,
+		int typeID,
+		BinaryReader& in)
+	{
+		assert(data != nullptr);
+
+		auto it = m_enumDefs.find(typeID);
+		assert(it != m_enumDefs.end());
+		auto& subEnum = it->second;
+
+		int value;
+
+		if (!ReadInteger(in, value))
+		{
+			in.failed = true;
+			return Report(ctx, LoadStatus::BadFormat, LoadProblem::BadData, ComplexType::Enum, PrimitiveType::None);
+		}
+
+		if (subEnum.valueKeyMembers.find(value) == subEnum.valueKeyMembers.end())
+		{
+			return Report(ctx, LoadStatus::Missing, LoadProblem::UnknownEnumValue, ComplexType::Enum, PrimitiveType::None,
+				std::to_string(value).c_str());
+		}
+
+		*((int*)data) = value;
+		return LoadStatusInfo(LoadStatus::Loaded);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	inline LoadStatusInfo BinaryLoadStruct(
+		LoadContext& ctx,
+		unsigned char* data,
+		const MemberData& s,
+		BinaryReader& in,
+		unsigned int nestedDepth)
+	{
+		assert(data != nullptr);
+
+		assert(s.complexType == ComplexType::Struct);
+
+		uint64_t count;
+
+		if (!in.ReadVarint(count) || count > s.memberCount)
+		{
+			in.failed = true;
+			return Report(ctx, LoadStatus::BadFormat, LoadProblem::BadCount, ComplexType::Struct, PrimitiveType::None);
+		}
+
+		auto loadStatusInfo = ctx.Loaded(s.memberCount);
+		auto members = MembersOf(s);
+
+		for (size_t i = 0; i < s.memberCount; ++i)
+		{
+			auto& m = members[i];
+
+			ctx.PushMember(m);
+
+			// written before this member was added
+			if (i >= count)
+			{
+				ctx.Record(loadStatusInfo, i, Report(ctx, LoadStatus::Missing, LoadProblem::NotFound, m.complexType, m.primitiveType));
+				ctx.Pop();
+				continue;
+			}
+
+			auto info = BinaryLoadHelper(
+				ctx,
+				&data[m.byteOffset],
+				m,
+				in,
+				(nestedDepth + 1));
+
+			ctx.Record(loadStatusInfo, i, std::move(info));
+			ctx.Pop();
+		}
+
+		return loadStatusInfo;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	inline LoadStatusInfo BinaryLoadVector(
+		LoadContext& ctx,
+		unsigned char* data,
+		const MemberData& v,
+		BinaryReader& in,
+		unsigned int nestedDepth)
+	{
+		uint64_t count;
+
+		// every element takes at least one byte, which stops a bad count from
+		// allocating more than the input could ever fill
+		if (!in.ReadVarint(count) || count > in.Remaining())
+		{
+			in.failed = true;
+			return Report(ctx, LoadStatus::BadFormat, LoadProblem::BadCount, ComplexType::Vector, PrimitiveType::None);
+		}
+
+		auto stride = v.typeSize;
+
+		// pull out the info about the type inside the vector
+		assert(v.memberCount == 1);
+		auto m = MembersOf(v);
+
+		if (m->isFlat && count > in.Remaining() / stride)
+		{
+			in.failed = true;
+			return Report(ctx, LoadStatus::BadFormat, LoadProblem::BadCount, ComplexType::Vector, PrimitiveType::None);
+		}
+
+		auto loadStatusInfo = ctx.Loaded(size_t(count));
+
+		assert(v.vectorDispatcher != nullptr);
+
+		auto base = v.vectorDispatcher->resize(data, size_t(count));
+
+		if (m->isFlat) // one copy for the lot
+		{
+			assert(m->typeSize == stride);
+
+			if (count > 0)
+				in.Read(base, size_t(count) * stride);
+
+			if (!IsLittleEndian())
+			{
+				for (size_t i = 0; i < count; ++i)
+					SwapFlat(&base[i * stride], *m);
+			}
+
+			for (size_t i = 0; i < loadStatusInfo.m_subInfoSize; ++i)
+				loadStatusInfo.m_subInfo[i].m_loadStatus = LoadStatus::Loaded;
+
+			ctx.Count(LoadStatus::Loaded, size_t(count));
+			return loadStatusInfo;
+		}
+
+		// elements go by the name of the vector
+		for (size_t i = 0; i < count; ++i)
+		{
+			auto info = BinaryLoadHelper(
+				ctx,
+				&base[m->byteOffset],
+				*m,
+				in,
+				(nestedDepth + 1));
+
+			ctx.Record(loadStatusInfo, i, std::move(info));
+			base += stride;
+		}
+
+		return loadStatusInfo;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	inline void BinaryWritePrimitive(OutputBuffer& out, const unsigned char* data, PrimitiveType primitiveType)
+	{
+		assert(data != nullptr);
+
+		switch (primitiveType)
+		{
+		case PrimitiveType::Bool:   out.Put(*((const bool*)data) ? 1 : 0); break;
+		case PrimitiveType::Char:   WriteNumber(out, *((const char*)data)); break;
+		case PrimitiveType::UChar:  WriteNumber(out, *((const unsigned char*)data)); break;
+		case PrimitiveType::Int16:  WriteNumber(out, *((const int16_t*)data)); break;
+		case PrimitiveType::UInt16: WriteNumber(out, *((const uint16_t*)data)); break;
+		case PrimitiveType::Int32:  WriteNumber(out, *((const int32_t*)data)); break;
+		case PrimitiveType::UInt32: WriteNumber(out, *((const uint32_t*)data)); break;
+		case PrimitiveType::Int64:  WriteNumber(out, *((const int64_t*)data)); break;
+		case PrimitiveType::UInt64: WriteNumber(out, *((const uint64_t*)data)); break;
+		case PrimitiveType::Float:  WriteNumber(out, *((const float*)data)); break;
+		case PrimitiveType::Double: WriteNumber(out, *((const double*)data)); break;
+		case PrimitiveType::String:
+		{
+			auto& str = *((const std::string*)data);
+			WriteVarint(out, str.size());
+			out.Write(str);
+			break;
+		}
+		default:
+			assert(false && "Unknown primitive type");
+		}
+	}
+	///////////////////////////////////////////////////////////////////////////
+	inline void BinaryWriteHelper(
+		OutputBuffer& out,
+		const unsigned char* data,
+		const MemberData& type,
+		unsigned int nestedDepth = 1)
+	{
+		assert(data != nullptr);
+		assert(nestedDepth <= MAX_NESTED_DEPTH && "Too many levels of embedded structs");
+
+		if (type.complexType == ComplexType::Enum)
+			WriteVarint(out, ZigZag(*((const int*)data)));
+		else if (type.complexType == ComplexType::Struct)
+		{
+			WriteVarint(out, type.memberCount);
+
+			auto members = MembersOf(type);
+
+			for (uint32_t i = 0; i < type.memberCount; ++i)
+				BinaryWriteHelper(out, &data[members[i].byteOffset], members[i], (nestedDepth + 1));
+		}
+		else if (type.complexType == ComplexType::Vector)
+		{
+			assert(type.vectorDispatcher != nullptr);
+
+			auto count = type.vectorDispatcher->size(data);
+			auto typeSize = type.typeSize;
+			WriteVarint(out, count);
+
+			if (count > 0)
+			{
+				// pull out the info about the type inside the vector
+				assert(type.memberCount == 1);
+				auto m = MembersOf(type);
+
+				auto base = type.vectorDispatcher->base(data);
+
+				if (m->isFlat) // one copy for the lot
+				{
+					assert(m->typeSize == typeSize);
+
+					if (IsLittleEndian())
+					{
+						out.Write((const char*)base, count * typeSize);
+						return;
+					}
+
+					std::vector<unsigned char> element(typeSize);
+
+					for (size_t i = 0; i < count; i++, base += typeSize)
+					{
+						memcpy(element.data(), base, typeSize);
+						SwapFlat(element.data(), *m);
+						out.Write((const char*)element.data(), typeSize);
+					}
+
+					return;
+				}
+
+				for (size_t i = 0; i < count; i++)
+				{
+					BinaryWriteHelper(
+						out,
+						&base[m->byteOffset],
+						*m,
+						(nestedDepth + 1));
+
+					base += typeSize;
+				}
+			}
+		}
+		else if (IsPrimitive(type.primitiveType)) // primitive
+			BinaryWritePrimitive(out, data, type.primitiveType);
+		else
+			assert(false && "Unknown type");
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Numbers of a type known at compile time, as BinaryWritePrimitive()
+	// and BinaryLoadPrimitive() do them
+	///////////////////////////////////////////////////////////////////////////
+	template <typename T>
+	static inline void WriteNumber(OutputBuffer& out, T value)
+	{
+		if (std::is_signed<T>::value)
+			WriteVarint(out, ZigZag(int64_t(value)));
+		else
+			WriteVarint(out, uint64_t(value));
+	}
+
+	static inline void WriteNumber(OutputBuffer& out, char value)          { out.Put(value); }
+	static inline void WriteNumber(OutputBuffer& out, unsigned char value) { out.Put(char(value)); }
+
+	static inline void WriteNumber(OutputBuffer& out, float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(float));
+		WriteLittleEndian(out, bits);
+	}
+
+	static inline void WriteNumber(OutputBuffer& out, double value)
+	{
+		uint64_t bits;
+		memcpy(&bits, &value, sizeof(double));
+		WriteLittleEndian(out, bits);
+	}
+
+	template <typename T>
+	static inline bool ReadNumber(BinaryReader& in, T& value) { return ReadInteger(in, value); }
+
+	static inline bool ReadNumber(BinaryReader& in, char& value)          { return in.Read(&value, 1); }
+	static inline bool ReadNumber(BinaryReader& in, unsigned char& value) { return in.Read(&value, 1); }
+
+	static inline bool ReadNumber(BinaryReader& in, float& value)
+	{
+		uint32_t bits;
+
+		if (!in.ReadLittleEndian(bits))
+			return false;
+
+		memcpy(&value, &bits, sizeof(float));
+		return true;
+	}
+
+	static inline bool ReadNumber(BinaryReader& in, double& value)
+	{
+		uint64_t bits;
+
+		if (!in.ReadLittleEndian(bits))
+			return false;
+
+		memcpy(&value, &bits, sizeof(double));
+		return true;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// SwapFlat() for a flat type known at compile time
+	///////////////////////////////////////////////////////////////////////////
+	template <typename StructT>
+	struct SwapFieldsVisitor
+	{
+		SerializerBinary& serializer;
+		StructT& data;
+
+		template <typename T>
+		inline void operator()(const char*, T StructT::* member, size_t)
+		{
+			serializer.SwapField(data.*member, FieldKindOf<T>());
+		}
+	};
+
+	template <typename T>
+	inline void SwapField(T& value, std::integral_constant<FieldKind, FieldKind::Number>)
+	{
+		std::reverse((unsigned char*)&value, (unsigned char*)&value + sizeof(T));
+	}
+
+	template <typename T>
+	inline void SwapField(T& value, std::integral_constant<FieldKind, FieldKind::Fields>)
+	{
+		SwapFieldsVisitor<T> v = { *this, value };
+		SerializerFields<T>::Visit(v);
+	}
+
+	template <typename T>
+	inline void SwapField(T& value, std::integral_constant<FieldKind, FieldKind::Registered>)
+	{
+		auto t = FindType(RTTI::Wrapper<T>::RTTI.TypeID);
+		assert(t != nullptr && t->isFlat);
+		SwapFlat((unsigned char*)&value, *t);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// BinaryWriteHelper() for a value of a type known at compile time, which
+	// comes out exactly the same. Structs with SERIALIZER_FIELDS() and the
+	// primitives need no registry.
+	///////////////////////////////////////////////////////////////////////////
+	inline void BinaryWriteField(OutputBuffer& out, const bool& value)
+	{
+		out.Put(value ? 1 : 0);
+	}
+
+	inline void BinaryWriteField(OutputBuffer& out, const std::string& value)
+	{
+		WriteVarint(out, value.size());
+		out.Write(value);
+	}
+
+	template <typename T>
+	inline void BinaryWriteField(OutputBuffer& out, const std::vector<T>& value)
+	{
+		WriteVarint(out, value.size());
+
+		if (value.empty())
+			return;
+
+		if (IsFlatField((const T*)nullptr)) // one copy for the lot
+		{
+			if (IsLittleEndian())
+			{
+				out.Write((const char*)value.data(), value.size() * sizeof(T));
+				return;
+			}
+
+			for (auto element : value)
+			{
+				SwapField(element, FieldKindOf<T>());
+				out.Write((const char*)&element, sizeof(T));
+			}
+
+			return;
+		}
+
+		for (auto& element : value)
+			BinaryWriteField(out, element);
+	}
+
+	template <typename T>
+	inline void BinaryWriteField(OutputBuffer& out, const T& value)
+	{
+		BinaryWriteField(out, value, FieldKindOf<T>());
+	}
+
+	template <typename T>
+	inline void BinaryWriteField(OutputBuffer& out, const T& value, std::integral_constant<FieldKind, FieldKind::Number>)
+	{
+		WriteNumber(out, value);
+	}
+
+	template <typename T>
+	inline void BinaryWriteField(OutputBuffer& out, const T& value, std::integral_constant<FieldKind, FieldKind::Registered>)
+	{
+		BinaryWriteHelper(out, (const unsigned char*)&value, DescribeType<T>());
+	}
+
+	template <typename StructT>
+	struct BinaryFieldsWriter
+	{
+		SerializerBinary& serializer;
+		OutputBuffer& out;
+		const StructT& data;
+
+		template <typename T>
+		inline void operator()(const char*, T StructT::* member, size_t)
+		{
+			serializer.BinaryWriteField(out, data.*member);
+		}
+	};
+
+	template <typename T>
+	inline void BinaryWriteField(OutputBuffer& out, const T& value, std::integral_constant<FieldKind, FieldKind::Fields>)
+	{
+		WriteVarint(out, SerializerFields<T>::count);
+
+		BinaryFieldsWriter<T> v = { *this, out, value };
+		SerializerFields<T>::Visit(v);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// BinaryLoadHelper() for a value of a type known at compile time, with
+	// the same results and messages
+	///////////////////////////////////////////////////////////////////////////
+	template <typename T>
+	inline LoadStatusInfo BinaryLoadField(LoadContext& ctx, T& data, BinaryReader& in, unsigned int nestedDepth)
+	{
+		// the data ended or went bad earlier on (which was reported then)
+		if (in.failed)
+			return LoadStatusInfo(LoadStatus::BadFormat);
+
+		if (nestedDepth > MAX_NESTED_DEPTH)
+		{
+			in.failed = true;
+			return Report(ctx, LoadStatus::MaxNestDepthExceeded, LoadProblem::MaxNestDepthExceeded, ComplexType::None, PrimitiveType::None);
+		}
+
+		return BinaryLoadValue(ctx, data, in, nestedDepth);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	inline LoadStatusInfo BinaryLoadBadData(LoadContext& ctx, BinaryReader& in)
+	{
+		in.failed = true;
+		return Report(ctx, LoadStatus::BadFormat, LoadProblem::BadData, ComplexType::None, PrimitiveType::None);
+	}
+
+	inline LoadStatusInfo BinaryLoadValue(LoadContext& ctx, bool& data, BinaryReader& in, unsigned int)
+	{
+		unsigned char byte;
+
+		if (!in.Read(&byte, 1) || byte > 1)
+			return BinaryLoadBadData(ctx, in);
+
+		data = (byte != 0);
+		return LoadStatusInfo(LoadStatus::Loaded);
+	}
+
+	inline LoadStatusInfo BinaryLoadValue(LoadContext& ctx, std::string& data, BinaryReader& in, unsigned int)
+	{
+		uint64_t len;
+
+		if (!in.ReadVarint(len) || len > in.Remaining())
+			return BinaryLoadBadData(ctx, in);
+
+		data.assign((const char*)in.p, size_t(len));
+		in.p += len;
+		return LoadStatusInfo(LoadStatus::Loaded);
+	}
+
+	template <typename T>
+	inline LoadStatusInfo BinaryLoadValue(LoadContext& ctx, std::vector<T>& data, BinaryReader& in, unsigned int nestedDepth)
+	{
+		uint64_t count;
+		auto flat = IsFlatField((const T*)nullptr);
+
+		// see BinaryLoadVector()
+		if (!in.ReadVarint(count) || count > in.Remaining()
+		  || (flat && count > in.Remaining() / sizeof(T)))
+		{
+			in.failed = true;
+			return Report(ctx, LoadStatus::BadFormat, LoadProblem::BadCount, ComplexType::Vector, PrimitiveType::None);
+		}
+
+		auto loadStatusInfo = ctx.Loaded(size_t(count));
+
+		data.resize(size_t(count));
+
+		if (flat) // one copy for the lot
+		{
+			if (count > 0)
+				in.Read(data.data(), size_t(count) * sizeof(T));
+
+			if (!IsLittleEndian())
+			{
+				for (size_t i = 0; i < count; ++i)
+					SwapField(data[i], FieldKindOf<T>());
+			}
+
+			for (size_t i = 0; i < loadStatusInfo.m_subInfoSize; ++i)
+				loadStatusInfo.m_subInfo[i].m_loadStatus = LoadStatus::Loaded;
+
+			ctx.Count(LoadStatus::Loaded, size_t(count));
+			return loadStatusInfo;
+		}
+
+		// elements go by the name of the vector (see BinaryLoadVector())
+		for (size_t i = 0; i < count; ++i)
+			ctx.Record(loadStatusInfo, i, BinaryLoadField(ctx, data[i], in, (nestedDepth + 1)));
+
+		return loadStatusInfo;
+	}
+
+	template <typename T>
+	inline LoadStatusInfo BinaryLoadValue(LoadContext& ctx, T& data, BinaryReader& in, unsigned int nestedDepth)
+	{
+		return BinaryLoadValue(ctx, data, in, nestedDepth, FieldKindOf<T>());
+	}
+
+	template <typename T>
+	inline LoadStatusInfo BinaryLoadValue(LoadContext& ctx, T& data, BinaryReader& in, unsigned int,
+		std::integral_constant<FieldKind, FieldKind::Number>)
+	{
+		if (!ReadNumber(in, data))
+			return BinaryLoadBadData(ctx, in);
+
+		return LoadStatusInfo(LoadStatus::Loaded);
+	}
+
+	template <typename T>
+	inline LoadStatusInfo BinaryLoadValue(LoadContext& ctx, T& data, BinaryReader& in, unsigned int nestedDepth,
+		std::integral_constant<FieldKind, FieldKind::Registered>)
+	{
+		return BinaryLoadHelper(ctx, (unsigned char*)&data, DescribeType<T>(), in, nestedDepth);
+	}
+
+	template <typename StructT>
+	struct BinaryFieldsLoader
+	{
+		SerializerBinary& serializer;
+		LoadContext& ctx;
+		BinaryReader& in;
+		StructT& data;
+		unsigned int nestedDepth;
+		size_t count;                   // members which were written
+		LoadStatusInfo& loadStatusInfo;
+		size_t i;
+
+		template <typename T>
+		inline void operator()(const char* name, T StructT::* member, size_t)
+		{
+			ctx.PushMember(name, strlen(name));
+
+			// written before this member was added
+			if (i >= count)
+			{
+				ctx.Record(loadStatusInfo, i++,
+					serializer.Report(ctx, LoadStatus::Missing, LoadProblem::NotFound, ComplexType::None, PrimitiveType::None));
+			}
+			else
+				ctx.Record(loadStatusInfo, i++, serializer.BinaryLoadField(ctx, data.*member, in, (nestedDepth + 1)));
+
+			ctx.Pop();
+		}
+	};
+
+	template <typename T>
+	inline LoadStatusInfo BinaryLoadValue(LoadContext& ctx, T& data, BinaryReader& in, unsigned int nestedDepth,
+		std::integral_constant<FieldKind, FieldKind::Fields>)
+	{
+		uint64_t count;
+
+		if (!in.ReadVarint(count) || count > SerializerFields<T>::count)
+		{
+			in.failed = true;
+			return Report(ctx, LoadStatus::BadFormat, LoadProblem::BadCount, ComplexType::Struct, PrimitiveType::None);
+		}
+
+		auto loadStatusInfo = ctx.Loaded(SerializerFields<T>::count);
+
+		BinaryFieldsLoader<T> v = { *this, ctx, in, data, nestedDepth, size_t(count), loadStatusInfo, 0 };
+		SerializerFields<T>::Visit(v);
+
+		return loadStatusInfo;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	template <typename T>
+	inline LoadStatusInfo BinaryLoad(LoadContext& ctx, T* data, BinaryReader& in, std::false_type)
+	{
+		return BinaryLoadHelper(ctx, (unsigned char*)data, DescribeType<T>(), in, 1);
+	}
+
+	template <typename T>
+	inline LoadStatusInfo BinaryLoad(LoadContext& ctx, T* data, BinaryReader& in, std::true_type)
+	{
+		return BinaryLoadField(ctx, *data, in, 1);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	template <typename T>
+	inline void BinaryWrite(OutputBuffer& out, T* data, std::false_type)
+	{
+		BinaryWriteHelper(out, (const unsigned char*)data, DescribeType<T>());
+	}
+
+	template <typename T>
+	inline void BinaryWrite(OutputBuffer& out, T* data, std::true_type)
+	{
+		BinaryWriteField(out, *data);
+	}
+
+public:
+	///////////////////////////////////////////////////////////////////////////
+	inline SerializerBinary() { }
+
+	///////////////////////////////////////////////////////////////////////////
+	SerializerBinary(const SerializerBinary& rhs) = delete;
+	SerializerBinary& operator=(const SerializerBinary& rhs) = delete;
+
+	///////////////////////////////////////////////////////////////////////////
+	inline ~SerializerBinary() { }
+
+	///////////////////////////////////////////////////////////////////////////
+	// Load from size bytes at data. Bytes past the end of the value are
+	// ignored. name is only used in messages.
+	///////////////////////////////////////////////////////////////////////////
+	template <typename T>
+	inline LoadStatusInfo BinaryLoad(T* data, const void* bytes, size_t size, const char* name = "")
+	{
+		assert(data != nullptr);
+		assert(bytes != nullptr || size == 0);
+		assert(name != nullptr);
+
+		LoadContext ctx(m_loadStatusDetail, name, m_diagnosticSink, m_diagnosticLimit);
+		BinaryReader in(bytes, size);
+		return ctx.Finish(BinaryLoad(ctx, data, in, SerializerHasFields<T>()));
+	}
+
+	template <typename T>
+	inline LoadStatusInfo BinaryLoad(T* data, const std::string& bytes, const char* name = "")
+	{
+		return BinaryLoad(data, bytes.data(), bytes.size(), name);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// BinaryLoad() from the file at path (mapped into memory where possible).
+	// Unreadable files are Missing.
+	///////////////////////////////////////////////////////////////////////////
+	template <typename T>
+	inline LoadStatusInfo BinaryLoadFile(T* data, const char* path, const char* name = "")
+	{
+		assert(path != nullptr);
+
+		MappedFile file;
+
+		if (!file.Open(path))
+		{
+			auto detail = std::string("Unable to read file '") + path + "': " + strerror(errno);
+
+			LoadContext ctx(m_loadStatusDetail, name, m_diagnosticSink, m_diagnosticLimit);
+			return ctx.Finish(Report(ctx, LoadStatus::Missing, LoadProblem::ParseFailed, ComplexType::None, PrimitiveType::None, detail.c_str()));
+		}
+
+		return BinaryLoad(data, file.Data(), file.Size(), name);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	template <typename T>
+	inline void BinaryWrite(OutputBuffer& out, T* data)
+	{
+		assert(data != nullptr);
+
+		BinaryWrite(out, data, SerializerHasFields<T>());
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	template <typename T>
+	inline bool BinaryWrite(FILE* fp, T* data)
+	{
+		assert(fp != nullptr);
+
+		OutputBuffer out(fp);
+		BinaryWrite(out, data);
+		return out.Flush();
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Unlike JSONWrite() this replaces the file rather than appending to it
+	///////////////////////////////////////////////////////////////////////////
+	template <typename T>
+	inline bool BinaryWrite(const char* filename, T* data)
+	{
+		assert(filename != nullptr);
+		assert(filename[0] != '\0');
+
+		auto fp = fopen(filename, "wb");
+
+		if (fp == nullptr)
+			return false;
+
+		auto ok = BinaryWrite(fp, data);
+
+		if (fclose(fp) != 0)
+			ok = false;
+
+		return ok;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// BinaryWrite() into memory. The first form appends to bytes.
+	///////////////////////////////////////////////////////////////////////////
+	template <typename T>
+	inline void BinaryWriteString(std::string& bytes, T* data)
+	{
+		OutputBuffer out(bytes);
+		BinaryWrite(out, data);
+	}
+
+	template <typename T>
+	inline std::string BinaryWriteString(T* data)
+	{
+		std::string bytes;
+		BinaryWriteString(bytes, data);
+		return bytes;
+	}
+};
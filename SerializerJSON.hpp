@@ -1,699 +1,1765 @@
-/*
- * SerializerCpp
- * Copyright (c) 2015-2016 Christopher D. Granz
- *
- * Permission is hereby granted, free of charge, to any person obtaining a
- * copy of this software and associated documentation files (the "Software"),
- * to deal in the Software without restriction, including without limitation
- * the rights to use, copy, modify, merge, publish, distribute, sublicense,
- * and/or sell copies of the Software, and to permit persons to whom the
- * Software is furnished to do so, subject to the following conditions:
- *
- * The above copyright notice and this permission notice shall be included in
- * all copies or substantial portions of the Software.
- *
- * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
- * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
- * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
- * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
- * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
- * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
- * IN THE SOFTWARE.
- */
-
-#pragma once
-
-#include "Serializer.hpp"
-#include "ParserJSON.hpp"
-
-class SerializerJSON : public Serializer
-{
-private:
-	///////////////////////////////////////////////////////////////////////////
-	inline LoadStatusInfo JSONLoadPrimitive(
-		unsigned char* data,
-		const char* name,
-		int typeID,
-		const ParserJSON::Node* node)
-	{
-		assert(data != nullptr);
-		assert(name != nullptr);
-		assert(node != nullptr);
-
-		/*
-		if (typeID == RTTI::Wrapper<char>::RTTI.TypeID)
-		{
-			if (!obj.IsConvertibleToString())
-			{
-				printf("SerializerJSON: Node '%s' is not convertable to string for 'char' primitive", name);
-				return LoadStatusInfo(LoadStatus::BadFormat);
-			}
-
-			*((char*)data) = obj.ToString()[0];
-		}
-		else if (typeID == RTTI::Wrapper<unsigned char>::RTTI.TypeID)
-		{
-			if (!obj.IsConvertibleToString())
-			{
-				printf("SerializerJSON: Node '%s' is not convertable to string for 'uchar' primitive", name);
-				return LoadStatusInfo(LoadStatus::BadFormat);
-			}
-
-			*((uchar*)data) = (unsigned char)obj.ToString()[0];
-		}
-		else if (typeID == RTTI::Wrapper<int16_t>::RTTI.TypeID)
-		{
-			if (!obj.IsConvertibleToInteger())
-			{
-				printf("SerializerJSON: Node '%s' is not convertable to integer for 'int16_t' primitive", name);
-				return LoadStatusInfo(LoadStatus::BadFormat);
-			}
-
-			*((int16_t*)data) = (int16_t)obj.ToInteger();
-		}
-		else if (typeID == RTTI::Wrapper<uint16_t>::RTTI.TypeID)
-		{
-			if (!obj.IsConvertibleToInteger())
-			{
-				printf("SerializerJSON: Node '%s' is not convertable to integer for 'uint16_t' primitive", name);
-				return LoadStatusInfo(LoadStatus::BadFormat);
-			}
-
-			*((uint16_t*)data) = (uint16_t)obj.ToInteger();
-		}
-		else if (typeID == RTTI::Wrapper<int32_t>::RTTI.TypeID)
-		{
-			if (!obj.IsConvertibleToInteger())
-			{
-				printf("SerializerJSON: Node '%s' is not convertable to integer for 'int32_t' primitive", name);
-				return LoadStatusInfo(LoadStatus::BadFormat);
-			}
-
-			*((int32_t*)data) = (int32_t)obj.ToInteger();
-		}
-		else if (typeID == RTTI::Wrapper<uint32_t>::RTTI.TypeID)
-		{
-			if (!obj.IsConvertibleToInteger())
-			{
-				printf("SerializerJSON: Node '%s' is not convertable to integer for 'uint32_t' primitive", name);
-				return LoadStatusInfo(LoadStatus::BadFormat);
-			}
-
-			*((uint32_t*)data) = (uint32_t)obj.ToInteger();
-		}
-		else if (typeID == RTTI::Wrapper<int64_t>::RTTI.TypeID)
-		{
-			if (!obj.IsConvertibleToInteger())
-			{
-				printf("SerializerJSON: Node '%s' is not convertable to integer for 'int64_t' primitive", name);
-				return LoadStatusInfo(LoadStatus::BadFormat);
-			}
-
-			*((int64_t*)data) = (int64_t)obj.ToInteger();
-		}
-		else if (typeID == RTTI::Wrapper<uint64_t>::RTTI.TypeID)
-		{
-			if (!obj.IsConvertibleToInteger())
-			{
-				printf("SerializerJSON: Node '%s' is not convertable to integer for 'uint64_t' primitive", name);
-				return LoadStatusInfo(LoadStatus::BadFormat);
-			}
-
-			*((int64_t*)data) = (int64_t)obj.ToInteger();
-		}
-		else if (typeID == RTTI::Wrapper<float>::RTTI.TypeID)
-		{
-			if (!obj.IsConvertibleToNumber())
-			{
-				printf("SerializerJSON: Node '%s' is not convertable to number for 'float' primitive", name);
-				return LoadStatusInfo(LoadStatus::BadFormat);
-			}
-
-			*((float*)data) = (float)obj.ToNumber();
-		}
-		else if (typeID == RTTI::Wrapper<double>::RTTI.TypeID)
-		{
-			if (!obj.IsConvertibleToNumber())
-			{
-				printf("SerializerJSON: Node '%s' is not convertable to number for 'double' primitive", name);
-				return LoadStatusInfo(LoadStatus::BadFormat);
-			}
-
-			*((double*)data) = (double)obj.ToNumber();
-		}
-		else if (typeID == RTTI::Wrapper<bool>::RTTI.TypeID)
-		{
-			if (!obj.IsBoolean())
-			{
-				printf("SerializerJSON: Node '%s' is not bool for 'bool' primitive", name);
-				return LoadStatusInfo(LoadStatus::BadFormat);
-			}
-
-			*((bool*)data) = obj.GetBoolean();
-		}
-		else if (typeID == RTTI::Wrapper<string>::RTTI.TypeID)
-		{
-			if (!obj.IsConvertibleToString())
-			{
-				printf("SerializerJSON: Node '%s' is not convertable to string for 'string' primitive", name);
-				return LoadStatusInfo(LoadStatus::BadFormat);
-			}
-
-			*((std::string*)data) = obj.ToString();
-		}
-		else // unknown type
-		{
-			assert(false & "Unknown primitive type");
-			return LoadStatusInfo(LoadStatus::BadFormat);
-		}
-*/
-
-		return LoadStatusInfo(LoadStatus::Loaded);
-	}
-
-	///////////////////////////////////////////////////////////////////////////
-	inline LoadStatusInfo JSONLoadHelper(
-		unsigned char* data,
-		const char* name,
-		int typeID,
-		ComplexType complexType,
-		const VectorTypeDispatcherBase* vectorDispatcher,
-		const std::vector<MemberData*>* members,
-		size_t typeSize,
-		const ParserJSON::Node* node,
-		unsigned int nestedDepth)
-	{
-		assert(data != nullptr);
-		//assert(node != nullptr);
-
-		if (node == nullptr)
-		{
-			printf("SerializerJSON: Node '%s' not found", name);
-			return LoadStatusInfo(LoadStatus::Missing);
-		}
-
-		if (nestedDepth > MAX_NESTED_DEPTH)
-		{
-			printf("SerializerJSON: Max nested depth exceeded");
-			return LoadStatusInfo(LoadStatus::MaxNestDepthExceeded);
-		}
-
-		// check for complexType types first
-		if (complexType == ComplexType::Enum)
-			return JSONLoadEnum(data, name, typeID, node);
-		else if (complexType == ComplexType::Struct)
-			return JSONLoadStruct(data, name, typeID, node, nestedDepth);
-		else if (complexType == ComplexType::Vector)
-			return JSONLoadVector(data, name, typeID, vectorDispatcher, members, typeSize, node, nestedDepth);
-
-		// otherwise it is a primitive type
-		assert(complexType == ComplexType::None);
-		return JSONLoadPrimitive(data, name, typeID, node);
-	}
-
-	///////////////////////////////////////////////////////////////////////////
-	inline LoadStatusInfo JSONLoadEnum(
-		unsigned char* data,
-		const char* name,
-		int typeID,
-		const ParserJSON::Node* node)
-	{
-		assert(data != nullptr);
-		assert(name != nullptr);
-		assert(node != nullptr);
-
-		assert(m_enumDefs.find(typeID) != m_enumDefs.end());
-		auto& subEnum = m_enumDefs[typeID];
-
-		if (node->type != ParserJSON::DataType::String)
-		{
-			printf("SerializerJSON: Node '%s' is not convertable to string for enum lookup", name);
-			return LoadStatusInfo(LoadStatus::BadFormat);
-		}
-
-		auto key = node->data.c_str();
-		auto it = subEnum.nameKeyMembers.find(key);
-
-		if (it == subEnum.nameKeyMembers.end())
-		{
-			printf("SerializerJSON: Node '%s' enum not found for '%s'", name, key);
-			return LoadStatusInfo(LoadStatus::Missing);
-		}
-
-		*((int*)data) = it->second;
-		return LoadStatusInfo(LoadStatus::Loaded);
-	}
-
-	///////////////////////////////////////////////////////////////////////////
-	inline LoadStatusInfo JSONLoadStruct(
-		unsigned char* data,
-		const char* name,
-		int typeID,
-		const ParserJSON::Node* node,
-		unsigned int nestedDepth)
-	{
-		assert(data != nullptr);
-		assert(name != nullptr);
-
-		if (node == nullptr)
-		{
-			printf("SerializerJSON: Node '%s' is not an object for struct loading", name);
-			return LoadStatusInfo(LoadStatus::BadFormat);
-		}
-
-		assert(m_structDefs.find(typeID) != m_structDefs.end());
-		auto& s = m_structDefs[typeID];
-
-		assert(s.complexType == ComplexType::Struct);
-
-		LoadStatusInfo loadStatusInfo;
-		loadStatusInfo.m_loadStatus = LoadStatus::Loaded;
-		loadStatusInfo.m_subInfo = new LoadStatusInfo[s.members.size()];
-		loadStatusInfo.m_subInfoSize = s.members.size();
-
-		bool allMembersMissing = true;
-		size_t i = 0;
-
-		for (auto& m : s.members)
-		{
-			assert(m != nullptr);
-			auto subNode = node->GetChild(m->name.c_str());
-
-			std::string compositeName = name;
-
-			if (compositeName.length() > 0)
-				compositeName += ".";
-
-			compositeName += m->name.c_str();
-
-			loadStatusInfo.m_subInfo[i] = JSONLoadHelper(
-				&data[m->byteOffset],
-				compositeName.c_str(),
-				m->typeID,
-				m->complexType,
-				m->vectorDispatcher,
-				&m->members,
-				m->typeSize,
-				subNode,
-				(nestedDepth + 1));
-
-			if (loadStatusInfo.m_subInfo[i].Status() == LoadStatus::Loaded)
-				allMembersMissing = false;
-
-			++i;
-		}
-
-		// if there were no tags, let's try loading this struct in sequence (like a vector) instead
-		if (allMembersMissing)
-		{
-			i = 0;
-			// FIXME: not yet implemented
-		}
-
-		return loadStatusInfo;
-	}
-
-	///////////////////////////////////////////////////////////////////////////
-	inline LoadStatusInfo JSONLoadVector(
-		unsigned char* data,
-		const char* name,
-		int typeID,
-		const VectorTypeDispatcherBase* vectorDispatcher,
-		const std::vector<MemberData*>* members,
-		size_t typeSize,
-		const ParserJSON::Node* node,
-		unsigned int nestedDepth)
-	{
-		if (node->type != ParserJSON::DataType::Array)
-		{
-			printf("SerializerJSON: Node '%s' is not an array for vector loading", name);
-			return LoadStatusInfo(LoadStatus::BadFormat);
-		}
-
-		auto count = node->children.size();
-		auto stride = typeSize;
-
-		LoadStatusInfo loadStatusInfo;
-		loadStatusInfo.m_loadStatus = LoadStatus::Loaded;
-		loadStatusInfo.m_subInfo = new LoadStatusInfo[100]; // 100 seems reasonable to start with
-		loadStatusInfo.m_subInfoSize = 100;
-		size_t i = 0;
-
-		assert(vectorDispatcher != nullptr);
-
-		vectorDispatcher->resize(data, count);
-		auto base = vectorDispatcher->base(data);
-
-		// pull out the info about the type inside the vector
-		assert(members != nullptr);
-		auto m = (*members)[0];
-		assert(m != nullptr);
-
-		for (auto subNode : node->children)
-		{
-			// need to resize loaded status info?
-			if (i == loadStatusInfo.m_subInfoSize)
-			{
-				auto subInfo = new LoadStatusInfo[loadStatusInfo.m_subInfoSize + 100];
-				delete[] loadStatusInfo.m_subInfo;
-				loadStatusInfo.m_subInfo = subInfo;
-				loadStatusInfo.m_subInfoSize += 100;
-			}
-
-			std::string subName = name;
-
-			if (subName.length() > 0)
-				subName += ".";
-
-			//subName += indexName;
-			subName += subNode->name;
-
-			loadStatusInfo.m_subInfo[i++] = JSONLoadHelper(
-				&base[m->byteOffset],
-				subName.c_str(),
-				m->typeID,
-				m->complexType,
-				m->vectorDispatcher,
-				&m->members,
-				m->typeSize,
-				subNode,
-				(nestedDepth + 1));
-
-			base += stride;
-		}
-
-		return loadStatusInfo;
-	}
-
-	///////////////////////////////////////////////////////////////////////////
-	inline void JSONWriteHelper(
-		FILE* fp,
-		const unsigned char* data,
-		const char* name,
-		int typeID,
-		ComplexType complexType,
-		const VectorTypeDispatcherBase* vectorDispatcher,
-		const std::vector<MemberData*>* members,
-		size_t typeSize,
-		AttribFlags flags = 0,
-		unsigned int indent = 0)
-	{
-		assert(fp != nullptr);
-		assert(data != nullptr);
-
-		assert(indent < 20 && "Too many levels of embedded structs");
-
-		for (unsigned int i = 0; i < indent; i++)
-			fprintf(fp, "\t");
-
-		//if (!(flags & TEXT_EXPORT_NO_NAMES))
-		{
-			if (name != nullptr && name[0] != '\0')
-			{
-				if (flags & TEXT_EXPORT_MINIMAL)
-					fprintf(fp, "\"%s\":", name);
-				else
-					fprintf(fp, "\"%s\" : ", name);
-			}
-		}
-
-		//flags |= m->attribFlags;
-
-		if (complexType == ComplexType::Enum)
-		{
-			assert(m_enumDefs.find(typeID) != m_enumDefs.end());
-			auto& e = m_enumDefs[typeID];
-
-			auto val = *((int*)data);
-			auto it = e.valueKeyMembers.find(val);
-
-			if (it != e.valueKeyMembers.end())
-				fprintf(fp, "\"%s\"", it->second.c_str());
-			else
-				fprintf(fp, "\"INVALID_ENUM\"");
-		}
-		else if (complexType == ComplexType::Struct)
-		{
-			int newIndent = indent;
-
-			if (flags & TEXT_EXPORT_MINIMAL)
-			{
-				fprintf(fp, "{");
-				newIndent = 0;
-			}
-			else if (flags & TEXT_EXPORT_SINGLE_LINE)
-			{
-				fprintf(fp, "{ ");
-				newIndent = 0;
-			}
-			else
-			{
-				fprintf(fp, "\n");
-
-				for (uint i = 0; i < indent; i++)
-					fprintf(fp, "\t");
-
-				fprintf(fp, "{\n");
-				++newIndent;
-			}
-
-			assert(m_structDefs.find(typeID) != m_structDefs.end());
-			auto& s = m_structDefs[typeID];
-
-			assert(s.complexType == ComplexType::Struct);
-
-			for (size_t i = 0; i < s.members.size(); i++)
-			{
-				auto& m = s.members[i];
-
-				JSONWriteHelper(
-					fp,
-					&data[m->byteOffset],
-					m->name.c_str(),
-					m->typeID,
-					m->complexType,
-					m->vectorDispatcher,
-					&m->members,
-					m->typeSize,
-					m->attribFlags | flags,
-					newIndent);
-
-				// don't add comma for last element
-				if (i < (s.members.size() - 1))
-				{
-					if (flags & TEXT_EXPORT_MINIMAL)
-						fprintf(fp, ",");
-					else if (flags & TEXT_EXPORT_SINGLE_LINE)
-						fprintf(fp, ", ");
-					else
-						fprintf(fp, ",\n");
-				}
-			}
-
-			if (flags & TEXT_EXPORT_MINIMAL)
-				fprintf(fp, "}");
-			else if (flags & TEXT_EXPORT_SINGLE_LINE)
-				fprintf(fp, " }");
-			else
-			{
-				fprintf(fp, "\n");
-
-				for (uint i = 0; i < indent; i++)
-					fprintf(fp, "\t");
-
-				fprintf(fp, "}");
-			}
-		}
-		else if (complexType == ComplexType::Vector)
-		{
-			assert(vectorDispatcher != nullptr);
-
-			const unsigned char* base = nullptr;
-			size_t count = 0;
-			size_t stride = typeSize;
-
-			base = vectorDispatcher->base(data);
-			count = vectorDispatcher->size(data);
-
-			int newIndent = indent;
-
-			if (flags & TEXT_EXPORT_MINIMAL)
-			{
-				fprintf(fp, "[");
-				newIndent = 0;
-			}
-			else if (flags & TEXT_EXPORT_SINGLE_LINE)
-			{
-				fprintf(fp, "[ ");
-				newIndent = 0;
-			}
-			else
-			{
-				fprintf(fp, "\n");
-
-				for (uint i = 0; i < indent; i++)
-					fprintf(fp, "\t");
-
-				fprintf(fp, "[\n");
-				++newIndent;
-			}
-
-			if (count > 0)
-			{
-				// pull out the info about the type inside the vector
-				assert(members != nullptr);
-				auto m = (*members)[0];
-				assert(m != nullptr);
-
-				for (size_t i = 0; i < count; i++)
-				{
-					JSONWriteHelper(
-						fp,
-						&base[m->byteOffset],
-						"",
-						m->typeID,
-						m->complexType,
-						m->vectorDispatcher,
-						&m->members,
-						m->typeSize,
-						m->attribFlags | flags,
-						newIndent);
-
-					// don't add comma for last element
-					if (i < (count - 1))
-					{
-						if (flags & TEXT_EXPORT_MINIMAL)
-							fprintf(fp, ",");
-						else if (flags & TEXT_EXPORT_SINGLE_LINE)
-							fprintf(fp, ", ");
-						else
-							fprintf(fp, ",\n");
-					}
-
-					base += stride;
-				}
-			}
-
-			if (flags & TEXT_EXPORT_MINIMAL)
-				fprintf(fp, "]");
-			else if (flags & TEXT_EXPORT_SINGLE_LINE)
-				fprintf(fp, " ]");
-			else
-			{
-				fprintf(fp, "\n");
-
-				for (uint i = 0; i < indent; i++)
-					fprintf(fp, "\t");
-
-				fprintf(fp, "]");
-			}
-		}
-		else if (IsPrimitive(typeID)) // primitive
-			PrintPrimitive(fp, data, typeID);
-		else
-			assert(false && "Unknown type");
-	}
-
-public:
-	///////////////////////////////////////////////////////////////////////////
-	inline SerializerJSON() { }
-
-	///////////////////////////////////////////////////////////////////////////
-	SerializerJSON(const SerializerJSON& rhs) = delete;
-	SerializerJSON& operator=(const SerializerJSON& rhs) = delete;
-
-	///////////////////////////////////////////////////////////////////////////
-	inline ~SerializerJSON() { }
-
-	///////////////////////////////////////////////////////////////////////////
-	template <typename T>
-	inline LoadStatusInfo JSONLoad(T* data, const ParserJSON::Node* node, const char* name = "")
-	{
-		assert(data != nullptr);
-		assert(name != nullptr);
-		assert(node != nullptr);
-
-		auto typeID = RTTI::Wrapper<T>::RTTI.TypeID;
-		auto typeSize = sizeof(T);
-		auto complexType = ComplexType::None;
-		VectorTypeDispatcherBase* vectorDispatcher = nullptr;
-		std::vector<MemberData*>* members = nullptr;
-
-		if (m_enumDefs.find(typeID) != m_enumDefs.end()) // enum type
-			complexType = ComplexType::Enum;
-		else if (m_structDefs.find(typeID) != m_structDefs.end()) // struct or vector type
-		{
-			auto& s = m_structDefs[typeID];
-			typeSize = s.typeSize;
-			complexType = s.complexType;
-			vectorDispatcher = s.vectorDispatcher;
-			members = &s.members;
-		}
-		else if (IsPrimitive(typeID))
-			complexType = ComplexType::None;
-		else
-			assert(false && "Unknown type for loading (is the type registered?)");
-
-		return JSONLoadHelper((unsigned char*)data, name, typeID, complexType, vectorDispatcher, members, typeSize, node, 1);
-	}
-
-	///////////////////////////////////////////////////////////////////////////
-	template <typename T>
-	inline void JSONWrite(FILE* fp, T* data, const char* name = "", AttribFlags flags = 0)
-	{
-		assert(fp != nullptr);
-		assert(data != nullptr);
-		//assert(name != nullptr);
-		//assert(name[0] != '\0');
-
-		auto typeID = RTTI::Wrapper<T>::RTTI.TypeID;
-		auto typeSize = sizeof(T);
-		auto complexType = ComplexType::None;
-		VectorTypeDispatcherBase* vectorDispatcher = nullptr;
-		std::vector<MemberData*>* members = nullptr;
-
-		if (m_enumDefs.find(typeID) != m_enumDefs.end()) // enum type
-			complexType = ComplexType::Enum;
-		else if (m_structDefs.find(typeID) != m_structDefs.end()) // struct or vector type
-		{
-			auto& s = m_structDefs[typeID];
-			typeSize = s.typeSize;
-			complexType = s.complexType;
-			vectorDispatcher = s.vectorDispatcher;
-			members = &s.members;
-			flags |= s.attribFlags;
-		}
-		else if (IsPrimitive(typeID))
-			complexType = ComplexType::None;
-		else
-			assert(false && "Unknown type for writing");
-
-		JSONWriteHelper(fp, (unsigned char*)data, name, typeID, complexType, vectorDispatcher, members, typeSize, flags);
-	}
-
-	///////////////////////////////////////////////////////////////////////////
-	template <typename T>
-	inline bool JSONWrite(const char* filename, T* data, const char* name = "", AttribFlags flags = 0)
-	{
-		assert(filename != nullptr);
-		assert(filename[0] != '\0');
-
-		auto fp = fopen(filename, "a");
-
-		if (fp == nullptr)
-			return false;
-
-		JSONWrite(fp, data, name, flags);
-
-		fclose(fp);
-		return true;
-	}
-
-	///////////////////////////////////////////////////////////////////////////
-	template <typename T>
-	inline bool JSONWrite(const std::string filename, T* data, const char* name = "", AttribFlags flags = 0)
-	{
-		JSONWrite(filename.c_str(), data, name, flags);
-	}
-};
-
+/*
+ * SerializerCpp
+ * Copyright (c) 2015-2016 Christopher D. Granz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "Serializer.hpp"
+#include "FloatFormat.hpp"
+#include "ParserJSON.hpp"
+#include "ThreadPool.hpp"
+
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <memory>
+
+class SerializerJSON : public Serializer
+{
+public:
+	///////////////////////////////////////////////////////////////////////////
+	// How often struct members were found where the schema order expected
+	// them (see FindMemberNode())
+	///////////////////////////////////////////////////////////////////////////
+	struct LookupStats
+	{
+		size_t cursorHits;   // member was the next key in the document
+		size_t cursorMisses; // member needed a full lookup (or was missing)
+
+		inline LookupStats() : cursorHits(0), cursorMisses(0) { }
+
+		inline void Add(const LookupStats& rhs)
+		{
+			cursorHits += rhs.cursorHits;
+			cursorMisses += rhs.cursorMisses;
+		}
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	// What the sink gets for the problems of JSON loads (source
+	// "SerializerJSON"): a LoadDiagnostic plus what the document has there
+	///////////////////////////////////////////////////////////////////////////
+	struct JSONLoadDiagnostic : public LoadDiagnostic
+	{
+		ParserJSON::DataType nodeType; // Undefined if nothing
+	};
+
+private:
+	///////////////////////////////////////////////////////////////////////////
+	std::atomic<size_t> m_cursorHits;   // LookupStats of every load so far, kept
+	std::atomic<size_t> m_cursorMisses; // atomic as loads may run at the same time
+	Executor* m_executor;                 // nullptr to load on the calling thread only
+	size_t m_parallelThreshold;           // elements a vector needs to be loaded in parallel
+
+	static const size_t DEFAULT_PARALLEL_THRESHOLD = 16384;
+	static const size_t MIN_PARALLEL_SLICE = 1024;    // elements one task loads at least
+	static const size_t PARALLEL_WRITE_SLICE = 4096;  // elements one task writes
+
+	///////////////////////////////////////////////////////////////////////////
+	// Keeps the problems of a slice loaded in parallel, to be reported in
+	// order once all slices are done
+	///////////////////////////////////////////////////////////////////////////
+	struct BufferDiagnostics final : public LoadDiagnosticSink
+	{
+		std::vector<JSONLoadDiagnostic> diagnostics;
+
+		inline virtual void Report(const LoadDiagnostic& diagnostic)
+		{
+			diagnostics.push_back(static_cast<const JSONLoadDiagnostic&>(diagnostic));
+		}
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	// LoadContext of a JSON load, which knows where to report problems and
+	// (while a parser is going through the document) where they are
+	///////////////////////////////////////////////////////////////////////////
+	struct JSONLoadContext : public LoadContext
+	{
+		const ParserJSON* parser;      // or nullptr for a Node tree
+		JSONLoadDiagnostic diagnostic; // the last one reported (reused for its buffers)
+		Executor* executor;        // for vectors of parallelThreshold elements or more
+		size_t parallelThreshold;
+		LookupStats lookupStats;   // added to the serializer's once the load is done
+
+		inline JSONLoadContext(const SerializerJSON& serializer, const char* rootName, const ParserJSON* parser = nullptr)
+			:
+			LoadContext(serializer.m_loadStatusDetail, rootName, serializer.m_diagnosticSink, serializer.m_diagnosticLimit),
+			parser(parser),
+			executor(serializer.m_executor),
+			parallelThreshold(serializer.m_parallelThreshold)
+		{ }
+
+		// for a slice of the current value of parent (see LoadContext::Merge()),
+		// which reports to sink and loads no further slices in parallel
+		inline JSONLoadContext(const JSONLoadContext& parent, const char* rootName, LoadDiagnosticSink* sink)
+			:
+			LoadContext(parent.Detail(), rootName, sink, parent.ReportsLeft()),
+			parser(nullptr),
+			executor(nullptr),
+			parallelThreshold(parent.parallelThreshold)
+		{
+			assert(parent.parser == nullptr);
+		}
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	// Hand a problem with the current value of ctx to the sink, and return
+	// the status the value gets. Nothing is put together for problems past
+	// the limit (or when silent), so a flood of them costs no more than
+	// counting their status.
+	///////////////////////////////////////////////////////////////////////////
+	inline LoadStatusInfo Report(
+		JSONLoadContext& ctx,
+		LoadStatus status,
+		LoadProblem problem,
+		ComplexType expectedType,
+		PrimitiveType expectedPrimitive,
+		ParserJSON::DataType nodeType,
+		const char* detail = "")
+	{
+		auto& diagnostic = ctx.diagnostic;
+		auto sink = PrepareReport(ctx, diagnostic, "SerializerJSON", status, problem, expectedType, expectedPrimitive, detail);
+
+		if (sink == nullptr)
+			return LoadStatusInfo(status);
+
+		diagnostic.nodeType = nodeType;
+
+		if (ctx.parser != nullptr)
+		{
+			if (problem != LoadProblem::ParseFailed)
+				ctx.parser->GetTokenPosition(diagnostic.line, diagnostic.column);
+			else if (ctx.parser->GetLastError() != ParserJSON::ParseError::FileError)
+			{
+				diagnostic.line = ctx.parser->GetLastErrorLineNo();
+				diagnostic.column = ctx.parser->GetLastErrorCharNo();
+			}
+		}
+
+		sink->Report(diagnostic);
+		return LoadStatusInfo(status);
+	}
+
+	inline LoadStatusInfo Report(
+		JSONLoadContext& ctx,
+		LoadStatus status,
+		LoadProblem problem,
+		const MemberData& m,
+		ParserJSON::DataType nodeType)
+	{
+		return Report(ctx, status, problem, m.complexType, m.primitiveType, nodeType);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Documents written by JSONWrite() list the keys in member order, so the
+	// key after the previously loaded member is checked first. On a miss we
+	// fall back to a full lookup and continue from wherever the key was.
+	///////////////////////////////////////////////////////////////////////////
+	static inline const ParserJSON::Node* FindMemberNode(
+		LookupStats& stats,
+		const ParserJSON::Node* node,
+		const MemberData& m,
+		size_t& cursor)
+	{
+		assert(node != nullptr);
+		auto& children = node->children;
+
+		if (node->type == ParserJSON::DataType::Object && cursor < children.size()
+		  && children[cursor]->name.Equals(m.name, m.nameLength))
+		{
+			++stats.cursorHits;
+			return children[cursor++];
+		}
+
+		++stats.cursorMisses;
+		auto i = node->FindChildIndex(m.name, m.nameLength);
+
+		if (i == ParserJSON::Node::NOT_FOUND)
+			return nullptr;
+
+		cursor = (i + 1);
+		return children[i];
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// The same for keys arriving one by one (see LoadHandler): the member
+	// after the previously found one is checked first. Returns the index of
+	// the member named key or NO_MEMBER.
+	///////////////////////////////////////////////////////////////////////////
+	static const size_t NO_MEMBER = size_t(-1);
+
+	static inline size_t FindMember(
+		LookupStats& stats,
+		const MemberData* members,
+		size_t count,
+		const char* key,
+		size_t len,
+		size_t& cursor)
+	{
+		if (cursor < count && members[cursor].nameLength == len
+		  && memcmp(members[cursor].name, key, len) == 0)
+		{
+			++stats.cursorHits;
+			return cursor++;
+		}
+
+		++stats.cursorMisses;
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (members[i].nameLength == len && memcmp(members[i].name, key, len) == 0)
+			{
+				cursor = (i + 1);
+				return i;
+			}
+		}
+
+		return NO_MEMBER;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// A scalar JSON value as both loaders see it: a Node, or the arguments
+	// of a ParserJSON::Handler event
+	///////////////////////////////////////////////////////////////////////////
+	struct JSONValue
+	{
+		ParserJSON::DataType type;
+		const char* text;          // raw text (String contents still escaped)
+		size_t len;
+		bool escaped;              // text contains backslash escapes
+		ParserJSON::Number number; // value of a Number (converted by the parser)
+
+		inline JSONValue(ParserJSON::DataType type, const char* text, size_t len, bool escaped = false)
+			: type(type), text(text), len(len), escaped(escaped)
+		{ }
+
+		inline explicit JSONValue(const ParserJSON::Node* node)
+			:
+			type(node->type),
+			text(node->data.data()),
+			len(node->data.size()),
+			escaped((node->flags & ParserJSON::Node::DATA_ESCAPED) != 0)
+		{
+			if (type == ParserJSON::DataType::Number)
+				number = node->GetNumber();
+		}
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	// Rounding a Number to a double and then to a float goes wrong when the
+	// double lands exactly halfway between two floats, so those are read
+	// from the text again straight into a float
+	///////////////////////////////////////////////////////////////////////////
+	static inline float ToFloat(const JSONValue& value)
+	{
+		auto d = value.number.ToDouble();
+		auto f = float(d);
+
+		if (double(f) == d || std::isinf(f))
+			return f;
+
+		auto neighbour = std::nextafter(f, (d > f ? 1 : -1) * std::numeric_limits<float>::infinity());
+
+		if (d != (double(f) + double(neighbour)) / 2)
+			return f;
+
+		std::string str(value.text, value.len);
+		return FloatFormat::ParseFloat(str.c_str());
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Store a Number in a number primitive of a type known ahead of time.
+	// Returns false if it doesn't fit (JSONLoadPrimitive() says why).
+	///////////////////////////////////////////////////////////////////////////
+	typedef bool (*NumberStore)(unsigned char* data, const JSONValue& value);
+
+	template <typename T>
+	static inline bool StoreNumber(T& data, const JSONValue& value) { return value.number.ToInteger(data); }
+	static inline bool StoreNumber(float& data, const JSONValue& value)  { data = ToFloat(value); return true; }
+	static inline bool StoreNumber(double& data, const JSONValue& value) { data = value.number.ToDouble(); return true; }
+
+	template <typename T>
+	static inline bool StoreNumberAt(unsigned char* data, const JSONValue& value)
+	{
+		return StoreNumber(*((T*)data), value);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Returns nullptr for types which don't load from a Number (or not only)
+	///////////////////////////////////////////////////////////////////////////
+	static inline NumberStore GetNumberStore(PrimitiveType primitiveType)
+	{
+		switch (primitiveType)
+		{
+		case PrimitiveType::Int16:  return &StoreNumberAt<int16_t>;
+		case PrimitiveType::UInt16: return &StoreNumberAt<uint16_t>;
+		case PrimitiveType::Int32:  return &StoreNumberAt<int32_t>;
+		case PrimitiveType::UInt32: return &StoreNumberAt<uint32_t>;
+		case PrimitiveType::Int64:  return &StoreNumberAt<int64_t>;
+		case PrimitiveType::UInt64: return &StoreNumberAt<uint64_t>;
+		case PrimitiveType::Float:  return &StoreNumberAt<float>;
+		case PrimitiveType::Double: return &StoreNumberAt<double>;
+		default:                    return nullptr;
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Where the elements of a vector are numbers, the NumberStore for them
+	///////////////////////////////////////////////////////////////////////////
+	static inline NumberStore GetElementStore(const MemberData* m, unsigned int nestedDepth)
+	{
+		if (!m->isFlat || m->complexType != ComplexType::None || nestedDepth > MAX_NESTED_DEPTH)
+			return nullptr;
+
+		return GetNumberStore(m->primitiveType);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Load a primitive from a JSON value. Numbers use the value the parser
+	// already converted; integer members only take integers in their range.
+	// Numbers and Booleans convert to strings; nothing else converts.
+	///////////////////////////////////////////////////////////////////////////
+	inline LoadStatusInfo JSONLoadPrimitive(
+		JSONLoadContext& ctx,
+		unsigned char* data,
+		PrimitiveType primitiveType,
+		const JSONValue& value)
+	{
+		assert(data != nullptr);
+
+		using DataType = ParserJSON::DataType;
+
+		auto isNumber = (value.type == DataType::Number);
+		auto isConvertibleToString = (value.type == DataType::String || isNumber || value.type == DataType::Boolean);
+
+		switch (primitiveType)
+		{
+		case PrimitiveType::Char:
+		case PrimitiveType::UChar:
+		{
+			if (!isConvertibleToString)
+				return Report(ctx, LoadStatus::BadFormat, LoadProblem::WrongType, ComplexType::None, primitiveType, value.type);
+
+			std::string str;
+
+			if (value.escaped)
+				ParserJSON::Unescape(value.text, value.len, str);
+			else
+				str.assign(value.text, value.len);
+
+			*((char*)data) = str[0];
+			break;
+		}
+		case PrimitiveType::Int16:
+			if (!isNumber || !value.number.ToInteger(*((int16_t*)data)))
+				return Report(ctx, LoadStatus::BadFormat, LoadProblem::WrongType, ComplexType::None, primitiveType, value.type);
+			break;
+		case PrimitiveType::UInt16:
+			if (!isNumber || !value.number.ToInteger(*((uint16_t*)data)))
+				return Report(ctx, LoadStatus::BadFormat, LoadProblem::WrongType, ComplexType::None, primitiveType, value.type);
+			break;
+		case PrimitiveType::Int32:
+			if (!isNumber || !value.number.ToInteger(*((int32_t*)data)))
+				return Report(ctx, LoadStatus::BadFormat, LoadProblem::WrongType, ComplexType::None, primitiveType, value.type);
+			break;
+		case PrimitiveType::UInt32:
+			if (!isNumber || !value.number.ToInteger(*((uint32_t*)data)))
+				return Report(ctx, LoadStatus::BadFormat, LoadProblem::WrongType, ComplexType::None, primitiveType, value.type);
+			break;
+		case PrimitiveType::Int64:
+			if (!isNumber || !value.number.ToInteger(*((int64_t*)data)))
+				return Report(ctx, LoadStatus::BadFormat, LoadProblem::WrongType, ComplexType::None, primitiveType, value.type);
+			break;
+		case PrimitiveType::UInt64:
+			if (!isNumber || !value.number.ToInteger(*((uint64_t*)data)))
+				return Report(ctx, LoadStatus::BadFormat, LoadProblem::WrongType, ComplexType::None, primitiveType, value.type);
+			break;
+		case PrimitiveType::Float:
+			if (!isNumber)
+				return Report(ctx, LoadStatus::BadFormat, LoadProblem::WrongType, ComplexType::None, primitiveType, value.type);
+
+			*((float*)data) = ToFloat(value);
+			break;
+		case PrimitiveType::Double:
+			if (!isNumber)
+				return Report(ctx, LoadStatus::BadFormat, LoadProblem::WrongType, ComplexType::None, primitiveType, value.type);
+
+			*((double*)data) = value.number.ToDouble();
+			break;
+		case PrimitiveType::Bool:
+			if (value.type != DataType::Boolean)
+				return Report(ctx, LoadStatus::BadFormat, LoadProblem::WrongType, ComplexType::None, primitiveType, value.type);
+
+			*((bool*)data) = (value.len == 4); // "true"
+			break;
+		case PrimitiveType::String:
+			if (!isConvertibleToString)
+				return Report(ctx, LoadStatus::BadFormat, LoadProblem::WrongType, ComplexType::None, primitiveType, value.type);
+
+			if (value.escaped)
+				ParserJSON::Unescape(value.text, value.len, *((std::string*)data));
+			else
+				((std::string*)data)->assign(value.text, value.len);
+			break;
+		default: // unknown type
+			assert(false && "Unknown primitive type");
+			return LoadStatusInfo(LoadStatus::BadFormat);
+		}
+
+		return LoadStatusInfo(LoadStatus::Loaded);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	inline LoadStatusInfo JSONLoadPrimitive(
+		JSONLoadContext& ctx,
+		unsigned char* data,
+		PrimitiveType primitiveType,
+		const ParserJSON::Node* node)
+	{
+		assert(node != nullptr);
+		return JSONLoadPrimitive(ctx, data, primitiveType, JSONValue(node));
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	inline LoadStatusInfo JSONLoadHelper(
+		JSONLoadContext& ctx,
+		unsigned char* data,
+		const MemberData& m,
+		const ParserJSON::Node* node,
+		unsigned int nestedDepth)
+	{
+		assert(data != nullptr);
+		//assert(node != nullptr);
+
+		if (node == nullptr)
+			return Report(ctx, LoadStatus::Missing, LoadProblem::NotFound, m, ParserJSON::DataType::Undefined);
+
+		if (nestedDepth > MAX_NESTED_DEPTH)
+			return Report(ctx, LoadStatus::MaxNestDepthExceeded, LoadProblem::MaxNestDepthExceeded, m, node->type);
+
+		// check for complexType types first
+		if (m.complexType == ComplexType::Enum)
+			return JSONLoadEnum(ctx, data, m.typeID, node);
+		else if (m.complexType == ComplexType::Struct)
+			return JSONLoadStruct(ctx, data, m, node, nestedDepth);
+		else if (m.complexType == ComplexType::Vector)
+			return JSONLoadVector(ctx, data, m, node, nestedDepth);
+
+		// otherwise it is a primitive type
+		assert(m.complexType == ComplexType::None);
+		return JSONLoadPrimitive(ctx, data, m.primitiveType, node);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	inline LoadStatusInfo JSONLoadEnum(
+		JSONLoadContext& ctx,
+		unsigned char* data,
+		int typeID,
+		const JSONValue& value)
+	{
+		assert(data != nullptr);
+
+		auto enumDef = m_enumDefs.find(typeID);
+		assert(enumDef != m_enumDefs.end());
+		auto& subEnum = enumDef->second;
+
+		if (value.type != ParserJSON::DataType::String)
+			return Report(ctx, LoadStatus::BadFormat, LoadProblem::WrongType, ComplexType::Enum, PrimitiveType::None, value.type);
+
+		std::string key;
+
+		if (value.escaped)
+			ParserJSON::Unescape(value.text, value.len, key);
+		else
+			key.assign(value.text, value.len);
+
+		auto it = subEnum.nameKeyMembers.find(key);
+
+		if (it == subEnum.nameKeyMembers.end())
+		{
+			return Report(ctx, LoadStatus::Missing, LoadProblem::UnknownEnumValue, ComplexType::Enum, PrimitiveType::None,
+				value.type, key.c_str());
+		}
+
+		*((int*)data) = it->second;
+		return LoadStatusInfo(LoadStatus::Loaded);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	inline LoadStatusInfo JSONLoadEnum(
+		JSONLoadContext& ctx,
+		unsigned char* data,
+		int typeID,
+		const ParserJSON::Node* node)
+	{
+		assert(node != nullptr);
+		return JSONLoadEnum(ctx, data, typeID, JSONValue(node));
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	inline LoadStatusInfo JSONLoadStruct(
+		JSONLoadContext& ctx,
+		unsigned char* data,
+		const MemberData& s,
+		const ParserJSON::Node* node,
+		unsigned int nestedDepth)
+	{
+		assert(data != nullptr);
+
+		if (node == nullptr)
+			return Report(ctx, LoadStatus::BadFormat, LoadProblem::WrongType, s, ParserJSON::DataType::Undefined);
+
+		assert(s.complexType == ComplexType::Struct);
+
+		auto loadStatusInfo = ctx.Loaded(s.memberCount);
+
+		bool allMembersMissing = true;
+		size_t i = 0;
+		size_t cursor = 0;
+		auto members = MembersOf(s);
+
+		for (; i < s.memberCount; ++i)
+		{
+			auto& m = members[i];
+			auto subNode = FindMemberNode(ctx.lookupStats, node, m, cursor);
+
+			ctx.PushMember(m);
+
+			auto info = JSONLoadHelper(
+				ctx,
+				&data[m.byteOffset],
+				m,
+				subNode,
+				(nestedDepth + 1));
+
+			if (info.Status() == LoadStatus::Loaded)
+				allMembersMissing = false;
+
+			ctx.Record(loadStatusInfo, i, std::move(info));
+			ctx.Pop();
+		}
+
+		// if there were no tags, let's try loading this struct in sequence (like a vector) instead
+		if (allMembersMissing)
+		{
+			i = 0;
+			// FIXME: not yet implemented
+		}
+
+		return loadStatusInfo;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	inline LoadStatusInfo JSONLoadVector(
+		JSONLoadContext& ctx,
+		unsigned char* data,
+		const MemberData& v,
+		const ParserJSON::Node* node,
+		unsigned int nestedDepth)
+	{
+		if (node->type != ParserJSON::DataType::Array)
+			return Report(ctx, LoadStatus::BadFormat, LoadProblem::WrongType, v, node->type);
+
+		auto count = node->children.size();
+
+		auto loadStatusInfo = ctx.Loaded(count);
+
+		assert(v.vectorDispatcher != nullptr);
+
+		auto base = v.vectorDispatcher->resize(data, count);
+
+		if (ctx.executor != nullptr && count >= ctx.parallelThreshold && count > MIN_PARALLEL_SLICE)
+		{
+			JSONLoadElementsParallel(ctx, loadStatusInfo, base, v, node, nestedDepth);
+			return loadStatusInfo;
+		}
+
+		ctx.PushElement(0);
+		JSONLoadElements(ctx, loadStatusInfo, base, v, node, 0, count, nestedDepth);
+		ctx.Pop();
+		return loadStatusInfo;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Load elements [begin, end) of the vector v from node into base (the
+	// vector, resized to match node) and record them in loadStatusInfo.
+	// ctx is at an element of the vector.
+	///////////////////////////////////////////////////////////////////////////
+	inline void JSONLoadElements(
+		JSONLoadContext& ctx,
+		LoadStatusInfo& loadStatusInfo,
+		unsigned char* base,
+		const MemberData& v,
+		const ParserJSON::Node* node,
+		size_t begin,
+		size_t end,
+		unsigned int nestedDepth)
+	{
+		auto stride = v.typeSize;
+		size_t numbersLoaded = 0;
+
+		// pull out the info about the type inside the vector
+		assert(v.memberCount == 1);
+		auto m = MembersOf(v);
+
+		auto store = GetElementStore(m, (nestedDepth + 1));
+
+		base += (begin * stride);
+
+		for (size_t i = begin; i < end; ++i, base += stride)
+		{
+			auto subNode = node->children[i];
+
+			// numbers go straight in, without JSONLoadHelper()
+			if (store != nullptr && subNode->type == ParserJSON::DataType::Number
+			  && store(&base[m->byteOffset], JSONValue(subNode)))
+			{
+				if (loadStatusInfo.m_subInfo != nullptr)
+					loadStatusInfo.m_subInfo[i].m_loadStatus = LoadStatus::Loaded;
+
+				++numbersLoaded;
+				continue;
+			}
+
+			ctx.SetElement(i);
+
+			auto info = JSONLoadHelper(
+				ctx,
+				&base[m->byteOffset],
+				*m,
+				subNode,
+				(nestedDepth + 1));
+
+			ctx.Record(loadStatusInfo, i, std::move(info));
+		}
+
+		ctx.Count(LoadStatus::Loaded, numbersLoaded);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// JSONLoadElements() for all of a large vector, in slices which the
+	// executor loads at the same time. Every slice has a context of its own
+	// and fills its own part of the vector and of loadStatusInfo; afterwards
+	// the contexts are merged and their problems reported in order, so the
+	// result is the same as that of loading the elements one by one.
+	///////////////////////////////////////////////////////////////////////////
+	struct VectorSlice
+	{
+		BufferDiagnostics diagnostics;
+		JSONLoadContext ctx;
+
+		inline VectorSlice(const JSONLoadContext& parent, const char* rootName)
+			:
+			ctx(parent, rootName, (parent.Sink() != nullptr ? &diagnostics : nullptr))
+		{ }
+	};
+
+	inline void JSONLoadElementsParallel(
+		JSONLoadContext& ctx,
+		LoadStatusInfo& loadStatusInfo,
+		unsigned char* base,
+		const MemberData& v,
+		const ParserJSON::Node* node,
+		unsigned int nestedDepth)
+	{
+		auto count = node->children.size();
+		auto sliceSize = count / (ctx.executor->Concurrency() * 4);
+
+		if (sliceSize < MIN_PARALLEL_SLICE)
+			sliceSize = MIN_PARALLEL_SLICE;
+
+		auto sliceCount = (count + sliceSize - 1) / sliceSize;
+		auto name = ctx.Name();
+
+		std::vector<std::unique_ptr<VectorSlice>> slices(sliceCount);
+
+		ctx.executor->ForEach(sliceCount, [&](size_t s)
+		{
+			slices[s].reset(new VectorSlice(ctx, name.c_str()));
+			auto& sliceCtx = slices[s]->ctx;
+			auto end = std::min(count, (s + 1) * sliceSize);
+
+			sliceCtx.PushElement(s * sliceSize);
+			JSONLoadElements(sliceCtx, loadStatusInfo, base, v, node, (s * sliceSize), end, nestedDepth);
+			sliceCtx.Pop();
+		});
+
+		for (auto& slice : slices)
+		{
+			ctx.Merge(slice->ctx);
+			ctx.lookupStats.Add(slice->ctx.lookupStats);
+
+			for (auto& diagnostic : slice->diagnostics.diagnostics)
+			{
+				auto sink = ctx.TakeReport(diagnostic.problem);
+
+				if (sink == nullptr)
+					break;
+
+				sink->Report(diagnostic);
+			}
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Everything JSONLoadHelper() needs to know about where a value goes
+	///////////////////////////////////////////////////////////////////////////
+	struct LoadTarget
+	{
+		unsigned char* data;
+		const MemberData* member; // what goes there
+		unsigned int nestedDepth;
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	// Status of a struct loaded from something other than an Object: like
+	// JSONLoadStruct() with a node which has no members at all.
+	///////////////////////////////////////////////////////////////////////////
+	inline LoadStatusInfo JSONLoadMissingStruct(JSONLoadContext& ctx, const MemberData& s)
+	{
+		assert(s.complexType == ComplexType::Struct);
+
+		auto loadStatusInfo = ctx.Loaded(s.memberCount);
+
+		auto members = MembersOf(s);
+
+		for (size_t i = 0; i < s.memberCount; ++i)
+		{
+			ctx.PushMember(members[i]);
+			ctx.Record(loadStatusInfo, i, Report(ctx, LoadStatus::Missing, LoadProblem::NotFound, members[i], ParserJSON::DataType::Undefined));
+			ctx.Pop();
+		}
+
+		return loadStatusInfo;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Loads straight from the events of ParserJSON::ParseSAX() using the same
+	// rules JSONLoadHelper() applies to a Node tree, so there's no tree and no
+	// second pass. Only the structs and vectors currently open are tracked;
+	// memory use doesn't grow with the document (apart from the status kept
+	// with LoadStatusDetail::Full). Keys which aren't members
+	// are skipped along with their values, and of duplicate keys the first
+	// one is loaded.
+	///////////////////////////////////////////////////////////////////////////
+	class LoadHandler : public ParserJSON::Handler
+	{
+	private:
+		///////////////////////////////////////////////////////////////////////
+		// A struct or vector which is being loaded
+		///////////////////////////////////////////////////////////////////////
+		struct Frame
+		{
+			LoadTarget target;
+			size_t first;         // status of its first member or element in m_pending
+			size_t elementCount;  // vector elements loaded so far
+			size_t member;        // member the last key selected (or NO_MEMBER)
+			size_t cursor;        // member expected to come next
+			NumberStore store;    // for vector elements which are numbers
+			unsigned char* base;  // vector elements (valid up to size)
+			size_t size;          // current size of the vector
+		};
+
+		SerializerJSON& m_serializer;
+		JSONLoadContext& m_ctx;
+		MemberData m_rootType;
+		LoadTarget m_root;
+		LoadStatusInfo m_result;
+		std::vector<Frame> m_frames;
+		std::vector<LoadStatusInfo> m_pending; // status so far of what m_frames contain (see Deliver())
+		unsigned int m_skipDepth;              // containers open inside a value we don't load
+		std::string m_key;                     // unescaped key
+
+		///////////////////////////////////////////////////////////////////////
+		// Where the next element of the vector f goes. Elements already there
+		// are loaded over (like JSONLoadVector() does), past those the vector
+		// grows in steps (see VectorTypeDispatcher::grow()) and the elements
+		// it grew by which weren't loaded are dropped at the end. Earlier
+		// elements are done with, so it doesn't matter if they move.
+		///////////////////////////////////////////////////////////////////////
+		inline unsigned char* NextElement(Frame& f)
+		{
+			auto count = f.elementCount;
+			auto& v = *f.target.member;
+
+			if (count == f.size)
+				f.base = v.vectorDispatcher->grow(f.target.data, count + 1, f.size);
+
+			return &f.base[count * v.typeSize + m_serializer.MembersOf(v)->byteOffset];
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		// Find where the value about to be loaded goes, and enter it in the
+		// path of m_ctx unless it's the root. Returns false if it should be
+		// skipped.
+		///////////////////////////////////////////////////////////////////////
+		inline bool NextTarget(LoadTarget& t)
+		{
+			if (m_frames.empty())
+			{
+				t = m_root;
+				return true;
+			}
+
+			auto& f = m_frames.back();
+			auto members = m_serializer.MembersOf(*f.target.member);
+
+			if (f.target.member->complexType == ComplexType::Struct)
+			{
+				if (f.member == NO_MEMBER)
+					return false;
+
+				t.member = &members[f.member];
+				t.data = &f.target.data[t.member->byteOffset];
+				m_ctx.PushMember(*t.member);
+			}
+			else
+			{
+				t.member = members;
+				t.data = NextElement(f);
+				m_ctx.PushElement(f.elementCount);
+			}
+
+			t.nestedDepth = (f.target.nestedDepth + 1);
+
+			return true;
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		// Hand the status of the value just finished to whatever contains it
+		// (which leaves the value in the path of m_ctx). Each open struct has
+		// a slot for every member in m_pending, open vectors add their
+		// elements after it (except with a summary only).
+		///////////////////////////////////////////////////////////////////////
+		inline void Deliver(LoadStatusInfo&& info)
+		{
+			if (m_frames.empty())
+			{
+				m_result = std::move(info);
+				return;
+			}
+
+			m_ctx.Count(info.Status());
+			auto& f = m_frames.back();
+
+			if (f.target.member->complexType == ComplexType::Struct)
+				m_pending[f.first + f.member] = std::move(info);
+			else
+			{
+				++f.elementCount;
+
+				if (!m_ctx.IsSummary())
+					m_pending.push_back(std::move(info));
+			}
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		// Deliver() the status of a value and leave it
+		///////////////////////////////////////////////////////////////////////
+		inline void Leave(LoadStatusInfo&& info)
+		{
+			Deliver(std::move(info));
+
+			if (!m_frames.empty())
+				m_ctx.Pop();
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		// Load a value into t which can't hold containers of its type (or
+		// any containers, for scalar types)
+		///////////////////////////////////////////////////////////////////////
+		inline LoadStatusInfo Load(const LoadTarget& t, const JSONValue& value)
+		{
+			auto& m = *t.member;
+
+			if (t.nestedDepth > MAX_NESTED_DEPTH)
+				return m_serializer.Report(m_ctx, LoadStatus::MaxNestDepthExceeded, LoadProblem::MaxNestDepthExceeded, m, value.type);
+
+			if (m.complexType == ComplexType::Enum)
+				return m_serializer.JSONLoadEnum(m_ctx, t.data, m.typeID, value);
+			else if (m.complexType == ComplexType::Struct)
+				return m_serializer.JSONLoadMissingStruct(m_ctx, m);
+			else if (m.complexType == ComplexType::Vector)
+				return m_serializer.Report(m_ctx, LoadStatus::BadFormat, LoadProblem::WrongType, m, value.type);
+
+			assert(m.complexType == ComplexType::None);
+			return m_serializer.JSONLoadPrimitive(m_ctx, t.data, m.primitiveType, value);
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		inline void OnScalar(const JSONValue& value)
+		{
+			if (m_skipDepth > 0)
+				return;
+
+			LoadTarget t;
+
+			if (NextTarget(t))
+				Leave(Load(t, value));
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		inline void OnContainerBegin(ParserJSON::DataType type, ComplexType loadsInto)
+		{
+			if (m_skipDepth > 0)
+			{
+				++m_skipDepth;
+				return;
+			}
+
+			LoadTarget t;
+
+			if (!NextTarget(t))
+			{
+				m_skipDepth = 1;
+				return;
+			}
+
+			if (t.member->complexType != loadsInto || t.nestedDepth > MAX_NESTED_DEPTH)
+			{
+				Leave(Load(t, JSONValue(type, nullptr, 0)));
+				m_skipDepth = 1;
+				return;
+			}
+
+			m_frames.push_back(Frame());
+			auto& f = m_frames.back();
+			f.first = m_pending.size();
+			f.elementCount = 0;
+			f.member = NO_MEMBER;
+			f.cursor = 0;
+			f.store = nullptr;
+			f.base = nullptr;
+			f.size = 0;
+
+			if (loadsInto == ComplexType::Struct)
+				m_pending.resize(f.first + t.member->memberCount);
+			else
+			{
+				assert(t.member->vectorDispatcher != nullptr);
+				assert(t.member->memberCount == 1);
+				f.store = GetElementStore(m_serializer.MembersOf(*t.member), (t.nestedDepth + 1));
+				f.base = t.member->vectorDispatcher->base(t.data);
+				f.size = t.member->vectorDispatcher->size(t.data);
+			}
+
+			f.target = std::move(t);
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		inline void OnContainerEnd()
+		{
+			if (m_skipDepth > 0)
+			{
+				--m_skipDepth;
+				return;
+			}
+
+			assert(!m_frames.empty());
+			auto& f = m_frames.back();
+			auto pending = (m_pending.data() + f.first);
+			auto count = (m_pending.size() - f.first);
+
+			if (f.target.member->complexType == ComplexType::Struct)
+			{
+				auto members = m_serializer.MembersOf(*f.target.member);
+
+				for (size_t i = 0; i < count; ++i)
+				{
+					if (pending[i].Status() != LoadStatus::NotYetLoaded)
+						continue;
+
+					m_ctx.PushMember(members[i]);
+					pending[i] = m_serializer.Report(m_ctx, LoadStatus::Missing, LoadProblem::NotFound, members[i], ParserJSON::DataType::Undefined);
+					m_ctx.Count(LoadStatus::Missing);
+					m_ctx.Pop();
+				}
+			}
+			else
+			{
+				// drop elements left over from before or grown by but not loaded
+				f.target.member->vectorDispatcher->resize(f.target.data, f.elementCount);
+			}
+
+			auto info = m_ctx.Loaded(count);
+
+			for (size_t i = 0; i < info.m_subInfoSize; ++i)
+				info.m_subInfo[i] = std::move(pending[i]);
+
+			m_pending.resize(f.first);
+
+			m_frames.pop_back();
+			Leave(std::move(info));
+		}
+
+	public:
+		///////////////////////////////////////////////////////////////////////
+		inline LoadHandler(SerializerJSON& serializer, JSONLoadContext& ctx, unsigned char* data, const MemberData& type)
+			:
+			m_serializer(serializer),
+			m_ctx(ctx),
+			m_rootType(type),
+			m_skipDepth(0)
+		{
+			m_root.data = data;
+			m_root.member = &m_rootType;
+			m_root.nestedDepth = 1;
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		LoadHandler(const LoadHandler& rhs) = delete;
+		LoadHandler& operator=(const LoadHandler& rhs) = delete;
+
+		///////////////////////////////////////////////////////////////////////
+		inline LoadStatusInfo TakeResult() { return std::move(m_result); }
+
+		///////////////////////////////////////////////////////////////////////
+		// Close what a truncated document the parser let through left open,
+		// the way ParserJSON::FinishDocument() does for the Node tree, so
+		// the status follows the tree loader's
+		///////////////////////////////////////////////////////////////////////
+		inline void CloseOpenContainers()
+		{
+			while (m_skipDepth > 0 || !m_frames.empty())
+				OnContainerEnd();
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		// When parsing fails part-way, drop what the vectors still open grew
+		// by but didn't load. Innermost first, as each lies in an element of
+		// the one before it.
+		///////////////////////////////////////////////////////////////////////
+		inline void TrimOpenVectors()
+		{
+			for (auto f = m_frames.rbegin(); f != m_frames.rend(); ++f)
+			{
+				if (f->target.member->complexType == ComplexType::Vector)
+					f->target.member->vectorDispatcher->resize(f->target.data, f->elementCount);
+			}
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		inline void OnObjectBegin() { OnContainerBegin(ParserJSON::DataType::Object, ComplexType::Struct); }
+		inline void OnArrayBegin()  { OnContainerBegin(ParserJSON::DataType::Array, ComplexType::Vector); }
+		inline void OnObjectEnd()   { OnContainerEnd(); }
+		inline void OnArrayEnd()    { OnContainerEnd(); }
+
+		inline void OnKey(const char* p, size_t len, bool escaped)
+		{
+			if (m_skipDepth > 0)
+				return;
+
+			assert(!m_frames.empty());
+			auto& f = m_frames.back();
+			assert(f.target.member->complexType == ComplexType::Struct);
+
+			if (escaped)
+			{
+				ParserJSON::Unescape(p, len, m_key);
+				p = m_key.data();
+				len = m_key.length();
+			}
+
+			f.member = FindMember(m_ctx.lookupStats, m_serializer.MembersOf(*f.target.member), f.target.member->memberCount, p, len, f.cursor);
+
+			// a duplicate key; the first one was loaded already
+			if (f.member != NO_MEMBER && m_pending[f.first + f.member].Status() != LoadStatus::NotYetLoaded)
+				f.member = NO_MEMBER;
+		}
+
+		inline void OnString(const char* p, size_t len, bool escaped) { OnScalar(JSONValue(ParserJSON::DataType::String, p, len, escaped)); }
+		inline void OnBoolean(bool value)                             { OnScalar(JSONValue(ParserJSON::DataType::Boolean, (value ? "true" : "false"), (value ? 4 : 5))); }
+		inline void OnNull()                                          { OnScalar(JSONValue(ParserJSON::DataType::Null, "null", 4)); }
+
+		inline void OnNumber(const char* p, size_t len, const ParserJSON::Number& number)
+		{
+			JSONValue value(ParserJSON::DataType::Number, p, len);
+			value.number = number;
+
+			// numbers go straight into vectors of numbers, without a target
+			if (m_skipDepth == 0 && !m_frames.empty() && m_frames.back().store != nullptr)
+			{
+				auto& f = m_frames.back();
+
+				if (f.store(NextElement(f), value))
+				{
+					Deliver(LoadStatusInfo(LoadStatus::Loaded));
+					return;
+				}
+			}
+
+			OnScalar(value);
+		}
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	inline void AddLookupStats(const LookupStats& stats)
+	{
+		m_cursorHits.fetch_add(stats.cursorHits, std::memory_order_relaxed);
+		m_cursorMisses.fetch_add(stats.cursorMisses, std::memory_order_relaxed);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Status of a load driven by the parser of ctx, which failing to parse
+	// overrides
+	///////////////////////////////////////////////////////////////////////////
+	inline LoadStatusInfo JSONLoadResult(LoadHandler& handler, JSONLoadContext& ctx)
+	{
+		assert(ctx.parser != nullptr);
+		auto error = ctx.parser->GetLastError();
+
+		AddLookupStats(ctx.lookupStats);
+
+		if (error == ParserJSON::ParseError::None)
+		{
+			handler.CloseOpenContainers();
+			return ctx.Finish(handler.TakeResult());
+		}
+
+		handler.TrimOpenVectors();
+		ctx.Unwind();
+
+		return ctx.Finish(Report(
+			ctx,
+			(error == ParserJSON::ParseError::FileError ? LoadStatus::Missing : LoadStatus::BadFormat),
+			LoadProblem::ParseFailed,
+			ComplexType::None,
+			PrimitiveType::None,
+			ParserJSON::DataType::Undefined,
+			ctx.parser->GetLastErrorDesc().c_str()));
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Indentation and name (if any) which come before every value
+	///////////////////////////////////////////////////////////////////////////
+	inline void JSONWriteName(OutputBuffer& out, const char* name, AttribFlags flags, unsigned int indent)
+	{
+		assert(indent < 20 && "Too many levels of embedded structs");
+
+		out.Fill('\t', indent);
+
+		//if (!(flags & TEXT_EXPORT_NO_NAMES))
+		{
+			if (name != nullptr && name[0] != '\0')
+			{
+				PrintString(out, name, strlen(name));
+
+				if (flags & TEXT_EXPORT_MINIMAL)
+					out.Put(':');
+				else
+					out.Write(" : ");
+			}
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Open a struct ('{') or vector ('['); returns the indent of its contents
+	///////////////////////////////////////////////////////////////////////////
+	inline unsigned int JSONWriteOpen(OutputBuffer& out, char bracket, AttribFlags flags, unsigned int indent)
+	{
+		if (flags & TEXT_EXPORT_MINIMAL)
+		{
+			out.Put(bracket);
+			return 0;
+		}
+		else if (flags & TEXT_EXPORT_SINGLE_LINE)
+		{
+			out.Put(bracket);
+			out.Put(' ');
+			return 0;
+		}
+
+		out.Put('\n');
+
+		out.Fill('\t', indent);
+
+		out.Put(bracket);
+		out.Put('\n');
+		return (indent + 1);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	inline void JSONWriteClose(OutputBuffer& out, char bracket, AttribFlags flags, unsigned int indent)
+	{
+		if (flags & TEXT_EXPORT_MINIMAL)
+			out.Put(bracket);
+		else if (flags & TEXT_EXPORT_SINGLE_LINE)
+		{
+			out.Put(' ');
+			out.Put(bracket);
+		}
+		else
+		{
+			out.Put('\n');
+
+			out.Fill('\t', indent);
+
+			out.Put(bracket);
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	inline void JSONWriteSeparator(OutputBuffer& out, AttribFlags flags)
+	{
+		if (flags & TEXT_EXPORT_MINIMAL)
+			out.Put(',');
+		else if (flags & TEXT_EXPORT_SINGLE_LINE)
+			out.Write(", ", 2);
+		else
+			out.Write(",\n", 2);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	template <typename T>
+	inline void JSONWriteValues(
+		OutputBuffer& out,
+		const T* values,
+		size_t count,
+		const char* separator,
+		size_t separatorLength,
+		unsigned int indent)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			if (i > 0)
+				out.Write(separator, separatorLength);
+
+			out.Fill('\t', indent);
+			PrintValue(out, values[i]);
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Writes the elements of a vector of numbers the same way JSONWriteHelper()
+	// would one by one. Returns false if primitiveType isn't a number.
+	///////////////////////////////////////////////////////////////////////////
+	inline bool JSONWriteValues(
+		OutputBuffer& out,
+		const unsigned char* base,
+		size_t count,
+		PrimitiveType primitiveType,
+		AttribFlags flags,
+		unsigned int indent)
+	{
+		const char* separator = ",\n";
+
+		if (flags & TEXT_EXPORT_MINIMAL)
+			separator = ",";
+		else if (flags & TEXT_EXPORT_SINGLE_LINE)
+			separator = ", ";
+
+		auto len = strlen(separator);
+
+		switch (primitiveType)
+		{
+		case PrimitiveType::Char:   JSONWriteValues(out, (const char*)base, count, separator, len, indent); break;
+		case PrimitiveType::UChar:  JSONWriteValues(out, (const unsigned char*)base, count, separator, len, indent); break;
+		case PrimitiveType::Int16:  JSONWriteValues(out, (const int16_t*)base, count, separator, len, indent); break;
+		case PrimitiveType::UInt16: JSONWriteValues(out, (const uint16_t*)base, count, separator, len, indent); break;
+		case PrimitiveType::Int32:  JSONWriteValues(out, (const int32_t*)base, count, separator, len, indent); break;
+		case PrimitiveType::UInt32: JSONWriteValues(out, (const uint32_t*)base, count, separator, len, indent); break;
+		case PrimitiveType::Int64:  JSONWriteValues(out, (const int64_t*)base, count, separator, len, indent); break;
+		case PrimitiveType::UInt64: JSONWriteValues(out, (const uint64_t*)base, count, separator, len, indent); break;
+		case PrimitiveType::Float:  JSONWriteValues(out, (const float*)base, count, separator, len, indent); break;
+		case PrimitiveType::Double: JSONWriteValues(out, (const double*)base, count, separator, len, indent); break;
+		default:
+			return false;
+		}
+
+		return true;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Write the value at data, with large vectors split up among executor
+	// (see SetExecutor()) unless it's nullptr
+	///////////////////////////////////////////////////////////////////////////
+	inline void JSONWriteHelper(
+		OutputBuffer& out,
+		const unsigned char* data,
+		const char* name,
+		const MemberData& type,
+		AttribFlags flags,
+		unsigned int indent,
+		Executor* executor)
+	{
+		assert(data != nullptr);
+
+		JSONWriteName(out, name, flags, indent);
+
+		//flags |= m->attribFlags;
+
+		if (type.complexType == ComplexType::Enum)
+		{
+			auto enumDef = m_enumDefs.find(type.typeID);
+			assert(enumDef != m_enumDefs.end());
+			auto& e = enumDef->second;
+
+			auto val = *((int*)data);
+			auto it = e.valueKeyMembers.find(val);
+
+			if (it != e.valueKeyMembers.end())
+				PrintString(out, it->second);
+			else
+				out.Write("\"INVALID_ENUM\"");
+		}
+		else if (type.complexType == ComplexType::Struct)
+		{
+			auto newIndent = JSONWriteOpen(out, '{', flags, indent);
+			auto members = MembersOf(type);
+			auto count = type.memberCount;
+
+			for (size_t i = 0; i < count; i++)
+			{
+				auto& m = members[i];
+
+				JSONWriteHelper(
+					out,
+					&data[m.byteOffset],
+					m.name,
+					m,
+					m.attribFlags | flags,
+					newIndent,
+					executor);
+
+				// don't add comma for last element
+				if (i < (count - 1))
+					JSONWriteSeparator(out, flags);
+			}
+
+			JSONWriteClose(out, '}', flags, indent);
+		}
+		else if (type.complexType == ComplexType::Vector)
+		{
+			assert(type.vectorDispatcher != nullptr);
+
+			auto base = type.vectorDispatcher->base(data);
+			auto count = type.vectorDispatcher->size(data);
+
+			auto newIndent = JSONWriteOpen(out, '[', flags, indent);
+
+			if (executor != nullptr && count >= m_parallelThreshold && count > PARALLEL_WRITE_SLICE)
+				JSONWriteElementsParallel(out, base, type, count, flags, newIndent, *executor);
+			else
+				JSONWriteElements(out, base, type, 0, count, flags, newIndent, executor);
+
+			JSONWriteClose(out, ']', flags, indent);
+		}
+		else if (IsPrimitive(type.primitiveType)) // primitive
+			PrintPrimitive(out, data, type.primitiveType);
+		else
+			assert(false && "Unknown type");
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Write elements [begin, end) of the vector type at base, separated
+	// but without the brackets
+	///////////////////////////////////////////////////////////////////////////
+	inline void JSONWriteElements(
+		OutputBuffer& out,
+		const unsigned char* base,
+		const MemberData& type,
+		size_t begin,
+		size_t end,
+		AttribFlags flags,
+		unsigned int indent,
+		Executor* executor)
+	{
+		if (begin >= end)
+			return;
+
+		auto stride = type.typeSize;
+
+		// pull out the info about the type inside the vector
+		assert(type.memberCount == 1);
+		auto m = MembersOf(type);
+
+		base += (begin * stride);
+
+		// vectors of numbers skip the per element dispatch
+		if (m->isFlat && m->complexType == ComplexType::None
+		  && JSONWriteValues(out, base, (end - begin), m->primitiveType, flags, indent))
+			return;
+
+		for (size_t i = begin; i < end; i++)
+		{
+			JSONWriteHelper(
+				out,
+				&base[m->byteOffset],
+				"",
+				*m,
+				m->attribFlags | flags,
+				indent,
+				executor);
+
+			// don't add comma for last element
+			if (i < (end - 1))
+				JSONWriteSeparator(out, flags);
+
+			base += stride;
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// JSONWriteElements() for all of a large vector: the executor formats
+	// slices of it into buffers of their own at the same time, and the
+	// buffers are written in order with a separator in between, which
+	// makes the same output. A few slices per thread are formatted at a
+	// time, so the buffers don't grow with the vector. Vectors inside the
+	// elements are written by the thread at hand.
+	///////////////////////////////////////////////////////////////////////////
+	inline void JSONWriteElementsParallel(
+		OutputBuffer& out,
+		const unsigned char* base,
+		const MemberData& type,
+		size_t count,
+		AttribFlags flags,
+		unsigned int indent,
+		Executor& executor)
+	{
+		std::vector<std::string> slices(executor.Concurrency() * 4);
+
+		for (size_t first = 0; first < count; first += (slices.size() * PARALLEL_WRITE_SLICE))
+		{
+			auto sliceCount = std::min(slices.size(), (count - first + PARALLEL_WRITE_SLICE - 1) / PARALLEL_WRITE_SLICE);
+
+			executor.ForEach(sliceCount, [&](size_t s)
+			{
+				auto begin = first + (s * PARALLEL_WRITE_SLICE);
+
+				slices[s].clear();
+				OutputBuffer sliceOut(slices[s]);
+				JSONWriteElements(sliceOut, base, type, begin, std::min(count, begin + PARALLEL_WRITE_SLICE), flags, indent, nullptr);
+			});
+
+			for (size_t s = 0; s < sliceCount; ++s)
+			{
+				if (first > 0 || s > 0)
+					JSONWriteSeparator(out, flags);
+
+				out.Write(slices[s]);
+			}
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Write a value of type T with the registry (all JSONWrite() does for
+	// types without SERIALIZER_FIELDS())
+	///////////////////////////////////////////////////////////////////////////
+	template <typename T>
+	inline void JSONWriteRegistered(OutputBuffer& out, const T* data, const char* name, AttribFlags flags, unsigned int indent)
+	{
+		assert(data != nullptr);
+		//assert(name != nullptr);
+		//assert(name[0] != '\0');
+
+		auto type = DescribeType<T>();
+		JSONWriteHelper(out, (const unsigned char*)data, name, type, (flags | type.attribFlags), indent, m_executor);
+	}
+
+
+	///////////////////////////////////////////////////////////////////////////
+	template <typename T>
+	inline void JSONWrite(OutputBuffer& out, T* data, const char* name, AttribFlags flags, std::false_type)
+	{
+		JSONWriteRegistered(out, data, name, flags, 0);
+	}
+
+	template <typename T>
+	inline void JSONWrite(OutputBuffer& out, T* data, const char* name, AttribFlags flags, std::true_type)
+	{
+		JSONWriteField(out, *data, name, flags, 0);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// JSONWriteHelper() for a value of a type known at compile time, which
+	// comes out exactly the same. Structs with SERIALIZER_FIELDS() and the
+	// primitives need no registry.
+	///////////////////////////////////////////////////////////////////////////
+	inline void JSONWriteField(OutputBuffer& out, const bool& value, const char* name, AttribFlags flags, unsigned int indent)
+	{
+		JSONWriteName(out, name, flags, indent);
+
+		if (value)
+			out.Write("true", 4);
+		else
+			out.Write("false", 5);
+	}
+
+	inline void JSONWriteField(OutputBuffer& out, const std::string& value, const char* name, AttribFlags flags, unsigned int indent)
+	{
+		JSONWriteName(out, name, flags, indent);
+		PrintString(out, value);
+	}
+
+	template <typename T>
+	inline void JSONWriteField(OutputBuffer& out, const std::vector<T>& value, const char* name, AttribFlags flags, unsigned int indent)
+	{
+		JSONWriteName(out, name, flags, indent);
+		auto newIndent = JSONWriteOpen(out, '[', flags, indent);
+
+		for (size_t i = 0; i < value.size(); i++)
+		{
+			if (i > 0)
+				JSONWriteSeparator(out, flags);
+
+			JSONWriteField(out, value[i], "", flags, newIndent);
+		}
+
+		JSONWriteClose(out, ']', flags, indent);
+	}
+
+	template <typename T>
+	inline void JSONWriteField(OutputBuffer& out, const T& value, const char* name, AttribFlags flags, unsigned int indent)
+	{
+		JSONWriteField(out, value, name, flags, indent, FieldKindOf<T>());
+	}
+
+	template <typename T>
+	inline void JSONWriteField(OutputBuffer& out, const T& value, const char* name, AttribFlags flags, unsigned int indent,
+		std::integral_constant<FieldKind, FieldKind::Number>)
+	{
+		JSONWriteName(out, name, flags, indent);
+		PrintValue(out, value);
+	}
+
+	template <typename T>
+	inline void JSONWriteField(OutputBuffer& out, const T& value, const char* name, AttribFlags flags, unsigned int indent,
+		std::integral_constant<FieldKind, FieldKind::Registered>)
+	{
+		JSONWriteRegistered(out, &value, name, flags, indent);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	template <typename StructT>
+	struct JSONFieldsWriter
+	{
+		SerializerJSON& serializer;
+		OutputBuffer& out;
+		const StructT& data;
+		AttribFlags flags;
+		unsigned int indent;
+		bool first;
+
+		template <typename T>
+		inline void operator()(const char* name, T StructT::* member, size_t)
+		{
+			if (!first)
+				serializer.JSONWriteSeparator(out, flags);
+
+			first = false;
+			serializer.JSONWriteField(out, data.*member, name, flags, indent);
+		}
+	};
+
+	template <typename T>
+	inline void JSONWriteField(OutputBuffer& out, const T& value, const char* name, AttribFlags flags, unsigned int indent,
+		std::integral_constant<FieldKind, FieldKind::Fields>)
+	{
+		JSONWriteName(out, name, flags, indent);
+
+		JSONFieldsWriter<T> v = { *this, out, value, flags, JSONWriteOpen(out, '{', flags, indent), true };
+		SerializerFields<T>::Visit(v);
+
+		JSONWriteClose(out, '}', flags, indent);
+	}
+
+public:
+	///////////////////////////////////////////////////////////////////////////
+	inline SerializerJSON()
+		:
+		m_cursorHits(0),
+		m_cursorMisses(0),
+		m_executor(nullptr),
+		m_parallelThreshold(DEFAULT_PARALLEL_THRESHOLD)
+	{ }
+
+	///////////////////////////////////////////////////////////////////////////
+	SerializerJSON(const SerializerJSON& rhs) = delete;
+	SerializerJSON& operator=(const SerializerJSON& rhs) = delete;
+
+	///////////////////////////////////////////////////////////////////////////
+	inline ~SerializerJSON() { }
+
+	///////////////////////////////////////////////////////////////////////////
+	inline LookupStats GetLookupStats() const
+	{
+		LookupStats stats;
+		stats.cursorHits = m_cursorHits.load(std::memory_order_relaxed);
+		stats.cursorMisses = m_cursorMisses.load(std::memory_order_relaxed);
+		return stats;
+	}
+
+	inline void ResetLookupStats()
+	{
+		m_cursorHits.store(0, std::memory_order_relaxed);
+		m_cursorMisses.store(0, std::memory_order_relaxed);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Executor which loads and writes vectors of at least threshold
+	// elements in slices at the same time (see ThreadPool); nullptr, the
+	// default, does everything on the calling thread. Neither the result of
+	// a load, nor what the diagnostic sink gets, nor the JSON written
+	// changes. Only loads from a Node tree are split up, and only writes of
+	// registered types (not those with SERIALIZER_FIELDS()).
+	///////////////////////////////////////////////////////////////////////////
+	inline void SetExecutor(Executor* executor, size_t threshold = DEFAULT_PARALLEL_THRESHOLD)
+	{
+		m_executor = executor;
+		m_parallelThreshold = threshold;
+	}
+
+	inline Executor* GetExecutor() const         { return m_executor; }
+	inline size_t GetParallelThreshold() const   { return m_parallelThreshold; }
+
+	///////////////////////////////////////////////////////////////////////////
+	template <typename T>
+	inline LoadStatusInfo JSONLoad(T* data, const ParserJSON::Node* node, const char* name = "")
+	{
+		assert(data != nullptr);
+		assert(name != nullptr);
+		assert(node != nullptr);
+
+		auto type = DescribeType<T>();
+		JSONLoadContext ctx(*this, name);
+		auto info = ctx.Finish(JSONLoadHelper(ctx, (unsigned char*)data, type, node, 1));
+		AddLookupStats(ctx.lookupStats);
+		return info;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Load straight from JSON text without building a Node tree first (see
+	// LoadHandler). The parser is only used for its buffers, so reusing one
+	// saves allocations when loading many documents.
+	///////////////////////////////////////////////////////////////////////////
+	template <typename T>
+	inline LoadStatusInfo JSONLoad(T* data, ParserJSON& parser, const char* str, const char* name = "")
+	{
+		assert(data != nullptr);
+		assert(str != nullptr);
+		assert(name != nullptr);
+
+		JSONLoadContext ctx(*this, name, &parser);
+		LoadHandler handler(*this, ctx, (unsigned char*)data, DescribeType<T>());
+		parser.ParseSAX(str, handler);
+		return JSONLoadResult(handler, ctx);
+	}
+
+	template <typename T>
+	inline LoadStatusInfo JSONLoad(T* data, const char* str, const char* name = "")
+	{
+		ParserJSON parser;
+		return JSONLoad(data, parser, str, name);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// JSONLoad() from the file at path, which is mapped into memory rather
+	// than read (see ParserJSON::ParseFile()). Unreadable files are Missing.
+	///////////////////////////////////////////////////////////////////////////
+	template <typename T>
+	inline LoadStatusInfo JSONLoadFile(T* data, ParserJSON& parser, const char* path, const char* name = "")
+	{
+		assert(data != nullptr);
+		assert(path != nullptr);
+		assert(name != nullptr);
+
+		JSONLoadContext ctx(*this, name, &parser);
+		LoadHandler handler(*this, ctx, (unsigned char*)data, DescribeType<T>());
+		parser.ParseFileSAX(path, handler);
+		return JSONLoadResult(handler, ctx);
+	}
+
+	template <typename T>
+	inline LoadStatusInfo JSONLoadFile(T* data, const char* path, const char* name = "")
+	{
+		ParserJSON parser;
+		return JSONLoadFile(data, parser, path, name);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	template <typename T>
+	inline void JSONWrite(OutputBuffer& out, T* data, const char* name = "", AttribFlags flags = 0)
+	{
+		assert(data != nullptr);
+
+		JSONWrite(out, data, name, flags, SerializerHasFields<T>());
+	}
+	///////////////////////////////////////////////////////////////////////////
+	template <typename T>
+	inline bool JSONWrite(FILE* fp, T* data, const char* name = "", AttribFlags flags = 0)
+	{
+		assert(fp != nullptr);
+
+		OutputBuffer out(fp);
+		JSONWrite(out, data, name, flags);
+		return out.Flush();
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	template <typename T>
+	inline bool JSONWrite(const char* filename, T* data, const char* name = "", AttribFlags flags = 0)
+	{
+		assert(filename != nullptr);
+		assert(filename[0] != '\0');
+
+		auto fp = fopen(filename, "a");
+
+		if (fp == nullptr)
+			return false;
+
+		auto ok = JSONWrite(fp, data, name, flags);
+
+		if (fclose(fp) != 0)
+			ok = false;
+
+		return ok;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	template <typename T>
+	inline bool JSONWrite(const std::string filename, T* data, const char* name = "", AttribFlags flags = 0)
+	{
+		return JSONWrite(filename.c_str(), data, name, flags);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// JSONWrite() into memory (JSONWrite() with a std::string already takes
+	// a filename). The first form appends to str.
+	///////////////////////////////////////////////////////////////////////////
+	template <typename T>
+	inline void JSONWriteString(std::string& str, T* data, const char* name = "", AttribFlags flags = 0)
+	{
+		OutputBuffer out(str);
+		JSONWrite(out, data, name, flags);
+	}
+
+	template <typename T>
+	inline std::string JSONWriteString(T* data, const char* name = "", AttribFlags flags = 0)
+	{
+		std::string str;
+		JSONWriteString(str, data, name, flags);
+		return str;
+	}
+};
+
@@ -0,0 +1,225 @@
+/*
+ * SerializerCpp
+ * Copyright (c) 2015-2016 Christopher D. Granz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+/// Runs independent tasks in parallel for the serializers (see
+/// SerializerJSON::SetExecutor()). Implement this to hand the work to a
+/// scheduler of your own, or use ThreadPool.
+///////////////////////////////////////////////////////////////////////////////
+class Executor
+{
+public:
+	///////////////////////////////////////////////////////////////////////////
+	virtual ~Executor() { }
+
+	///////////////////////////////////////////////////////////////////////////
+	/// How many tasks run at the same time at most (callers size their work
+	/// by it)
+	///////////////////////////////////////////////////////////////////////////
+	virtual size_t Concurrency() const = 0;
+
+	///////////////////////////////////////////////////////////////////////////
+	/// Call task(0) to task(count - 1), in any order and on any thread, and
+	/// return once all of them have. If tasks throw, the rest still run and
+	/// the first exception is rethrown afterwards. Tasks don't call
+	/// ForEach() themselves.
+	///////////////////////////////////////////////////////////////////////////
+	virtual void ForEach(size_t count, const std::function<void(size_t)>& task) = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/// Executor with a fixed set of worker threads. The thread calling ForEach()
+/// works on the tasks too, so a pool of n threads starts n - 1 of them.
+/// ForEach() may be called from several threads; the calls take turns.
+/// (Remember to link with -pthread.)
+///////////////////////////////////////////////////////////////////////////////
+class ThreadPool final : public Executor
+{
+private:
+	///////////////////////////////////////////////////////////////////////////
+	struct Job
+	{
+		const std::function<void(size_t)>* task;
+		size_t count;
+		std::atomic<size_t> next; // next task to claim
+		std::exception_ptr error; // first one thrown (guarded by m_mutex)
+	};
+
+	std::vector<std::thread> m_workers;
+	std::mutex m_forEachMutex;          // one ForEach() at a time
+	std::mutex m_mutex;                 // guards everything below
+	std::condition_variable m_wake;     // a job was posted, or the pool stops
+	std::condition_variable m_idle;     // a worker left the job
+	Job* m_job;                         // job being worked on, or nullptr
+	size_t m_generation;                // jobs posted so far
+	size_t m_active;                    // workers in m_job
+	bool m_stopping;
+
+	///////////////////////////////////////////////////////////////////////////
+	inline void Work(Job& job)
+	{
+		for (;;)
+		{
+			auto i = job.next.fetch_add(1);
+
+			if (i >= job.count)
+				return;
+
+			try
+			{
+				(*job.task)(i);
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+
+				if (!job.error)
+					job.error = std::current_exception();
+			}
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	inline void WorkerMain()
+	{
+		size_t seen = 0;
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		for (;;)
+		{
+			m_wake.wait(lock, [&] { return (m_stopping || m_generation != seen); });
+
+			if (m_stopping)
+				return;
+
+			seen = m_generation;
+
+			// woken too late, the job is already done
+			if (m_job == nullptr)
+				continue;
+
+			auto job = m_job;
+			++m_active;
+			lock.unlock();
+
+			Work(*job);
+
+			lock.lock();
+			--m_active;
+			m_idle.notify_all();
+		}
+	}
+
+public:
+	///////////////////////////////////////////////////////////////////////////
+	/// threads counts the caller of ForEach(); 0 is one per hardware thread
+	///////////////////////////////////////////////////////////////////////////
+	inline explicit ThreadPool(size_t threads = 0)
+		:
+		m_job(nullptr),
+		m_generation(0),
+		m_active(0),
+		m_stopping(false)
+	{
+		if (threads == 0)
+			threads = std::thread::hardware_concurrency();
+
+		if (threads == 0)
+			threads = 1;
+
+		m_workers.reserve(threads - 1);
+
+		for (size_t i = 1; i < threads; ++i)
+			m_workers.emplace_back(&ThreadPool::WorkerMain, this);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	ThreadPool(const ThreadPool& rhs) = delete;
+	ThreadPool& operator=(const ThreadPool& rhs) = delete;
+
+	///////////////////////////////////////////////////////////////////////////
+	inline ~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stopping = true;
+		}
+
+		m_wake.notify_all();
+
+		for (auto& worker : m_workers)
+			worker.join();
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	inline virtual size_t Concurrency() const
+	{
+		return (m_workers.size() + 1);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	inline virtual void ForEach(size_t count, const std::function<void(size_t)>& task)
+	{
+		if (count == 0)
+			return;
+
+		std::lock_guard<std::mutex> turn(m_forEachMutex);
+
+		Job job;
+		job.task = &task;
+		job.count = count;
+		job.next = 0;
+
+		if (count > 1 && !m_workers.empty())
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_job = &job;
+			++m_generation;
+			m_wake.notify_all();
+		}
+
+		Work(job);
+
+		{
+			// every task is claimed; wait for the workers still on theirs
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_idle.wait(lock, [&] { return (m_active == 0); });
+			m_job = nullptr;
+		}
+
+		if (job.error)
+			std::rethrow_exception(job.error);
+	}
+};